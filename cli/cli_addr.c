@@ -170,6 +170,58 @@ static int cmd_addr_read_wm(struct nvm_cli *cli)
 	return _read(cli, 1) ? 1 : 0;
 }
 
+/**
+ * Copy all sectors of the block given by args->addrs[0] to the block given by
+ * args->addrs[1], the destination is expected to be erased
+ */
+static int cmd_addr_copy(struct nvm_cli *cli)
+{
+	struct nvm_cli_cmd_args *args = &cli->args;
+	const struct nvm_geo *geo = args->geo;
+	const int naddrs = geo->npages * geo->nplanes * geo->nsectors;
+	struct nvm_addr *src, *dst;
+	struct nvm_ret ret = {0,0};
+	ssize_t err = 0;
+
+	src = malloc(sizeof(*src) * naddrs);
+	dst = malloc(sizeof(*dst) * naddrs);
+	if (!src || !dst) {
+		nvm_cli_perror("malloc");
+		free(src);
+		free(dst);
+		return 1;
+	}
+
+	for (int i = 0; i < naddrs; ++i) {
+		src[i] = args->addrs[0];
+		src[i].g.pg = i / (geo->nplanes * geo->nsectors);
+		src[i].g.pl = (i / geo->nsectors) % geo->nplanes;
+		src[i].g.sec = i % geo->nsectors;
+
+		dst[i] = args->addrs[1];
+		dst[i].g.pg = src[i].g.pg;
+		dst[i].g.pl = src[i].g.pl;
+		dst[i].g.sec = src[i].g.sec;
+	}
+
+	nvm_cli_info_pr("nvm_addr_copy: {naddrs: %d, vcopy: %d}", naddrs,
+			nvm_dev_get_vcopy(args->dev));
+	nvm_addr_pr(args->addrs[0]);
+	nvm_addr_pr(args->addrs[1]);
+
+	err = nvm_addr_copy(args->dev, src, dst, naddrs, NVM_FLAG_PMODE_SNGL,
+			    &ret);
+	if (err) {
+		nvm_cli_perror("nvm_addr_copy");
+		nvm_ret_pr(&ret);
+	}
+
+	free(src);
+	free(dst);
+
+	return err ? 1 : 0;
+}
+
 static int cmd_fmt(struct nvm_cli *cli)
 {
 	for (int i = 0; i < cli->args.naddrs; ++i)
@@ -261,6 +313,7 @@ static struct nvm_cli_cmd cmds[] = {
 	{"write_wm",	cmd_addr_write_wm,	NVM_CLI_ARG_ADDR_LIST, NVM_CLI_OPT_DEFAULT | NVM_CLI_OPT_FILE_INPUT},
 	{"read",	cmd_addr_read,		NVM_CLI_ARG_ADDR_LIST, NVM_CLI_OPT_DEFAULT | NVM_CLI_OPT_FILE_OUTPUT},
 	{"read_wm",	cmd_addr_read_wm,	NVM_CLI_ARG_ADDR_LIST, NVM_CLI_OPT_DEFAULT | NVM_CLI_OPT_FILE_OUTPUT},
+	{"copy",	cmd_addr_copy,		NVM_CLI_ARG_VCOPY, NVM_CLI_OPT_DEFAULT},
 	{"from_geo",	cmd_fmt,	NVM_CLI_ARG_ADDR_SEC, NVM_CLI_OPT_DEFAULT},
 	{"from_hex",	cmd_fmt,	NVM_CLI_ARG_ADDR_LIST, NVM_CLI_OPT_DEFAULT},
 	{"gen2dev",	cmd_gen2dev,	NVM_CLI_ARG_ADDR_LIST, NVM_CLI_OPT_DEFAULT},
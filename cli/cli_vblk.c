@@ -164,6 +164,24 @@ static ssize_t _vblk_pad(struct nvm_cli *NVM_UNUSED(cli), struct nvm_vblk *vblk)
 	return res;
 }
 
+static ssize_t _vblk_recover(struct nvm_cli *NVM_UNUSED(cli),
+			     struct nvm_vblk *vblk)
+{
+	ssize_t res = 0;
+
+	nvm_cli_timer_start();
+	res = nvm_vblk_recover_pos(vblk);
+	nvm_cli_timer_stop();
+	nvm_cli_timer_pr("nvm_vblk_recover_pos");
+
+	if (res < 0)
+		nvm_cli_perror("nvm_vblk_recover_pos");
+
+	nvm_vblk_pr(vblk);
+
+	return res;
+}
+
 /**
  * Construct plane-spanning block
  */
@@ -344,6 +362,27 @@ static int cmd_vblk_line_pad(struct nvm_cli *cli)
 	return res < 0 ? -1 : 0;
 }
 
+static int cmd_vblk_line_recover(struct nvm_cli *cli)
+{
+	struct nvm_addr bgn = cli->args.addrs[0],
+			end = cli->args.addrs[1];
+	struct nvm_vblk *vblk = NULL;
+	ssize_t res = 0;
+	
+	vblk = nvm_vblk_alloc_line(cli->args.dev, bgn.g.ch, end.g.ch, bgn.g.lun,
+				   end.g.lun, bgn.g.blk);
+	if (!vblk) {
+		nvm_cli_perror("nvm_vblk_alloc");
+		return -1;
+	}
+
+	res = _vblk_recover(cli, vblk);
+	
+	nvm_vblk_free(vblk);
+
+	return res < 0 ? -1 : 0;
+}
+
 static int cmd_vblk_set_erase(struct nvm_cli *cli)
 {
 	struct nvm_vblk *vblk = NULL;
@@ -435,6 +474,7 @@ static struct nvm_cli_cmd cmds[] = {
 	{"line_read",	cmd_vblk_line_read,	NVM_CLI_ARG_VBLK_LINE,	NVM_CLI_OPT_DEFAULT | NVM_CLI_OPT_FILE_OUTPUT},
 	{"line_pread",	cmd_vblk_line_pread,	NVM_CLI_ARG_VBLK_LINE_POS,	NVM_CLI_OPT_DEFAULT | NVM_CLI_OPT_FILE_OUTPUT},
 	{"line_pad",	cmd_vblk_line_pad,	NVM_CLI_ARG_VBLK_LINE,	NVM_CLI_OPT_DEFAULT},
+	{"line_recover",	cmd_vblk_line_recover,	NVM_CLI_ARG_VBLK_LINE,	NVM_CLI_OPT_DEFAULT},
 };
 
 /* Define the CLI */
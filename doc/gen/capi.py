@@ -31,6 +31,7 @@ def gen_capi(args):
         "nvm_buf": "Buffer Allocation",
         "nvm_dev": "Device Management",
         "nvm_bbt": "Bad-Block-Table",
+        "nvm_chunk": "Chunk Information",
         "nvm_cmd": "Raw Commands",
         "nvm_addr": "Addressing",
         "nvm_vblk": "Virtual Block",
@@ -45,10 +45,13 @@ extern "C" {
 
 #define NVM_NADDR_MAX 64
 
+struct iovec;	///< See `<sys/uio.h>`
+
 #define NVM_DEV_NAME_LEN 32
 #define NVM_DEV_PATH_LEN (NVM_DEV_NAME_LEN + 5)
 
 #define NVM_FLAG_SCRBL 0x200	///< Scrambler ON/OFF: Context sensitive
+#define NVM_FLAG_SUSPEND 0x80	///< Program/erase suspendable by reads
 
 /**
  * Enumeration of cmd back-ends used by liblightnvm
@@ -104,6 +107,52 @@ struct nvm_dev;
  */
 struct nvm_vblk;
 
+/**
+ * Opaque erase-ahead pool of virtual blocks
+ *
+ * A background thread erases the virtual blocks handed to the pool and keeps
+ * them ready for writers, taking the erase latency out of the write path
+ *
+ * @see nvm_vblk_eahead_create
+ *
+ * @struct nvm_vblk_eahead
+ */
+struct nvm_vblk_eahead;
+
+/**
+ * Enumeration of virtual block striping layouts
+ *
+ * @see nvm_vblk_alloc_layout and nvm_vblk_alloc_line_layout
+ */
+enum nvm_vblk_layout {
+	NVM_VBLK_LAYOUT_PAGE = 0x0,	///< Page-interleaved over stripe width
+	NVM_VBLK_LAYOUT_BLOCK = 0x1,	///< Block-sequential, stripe width one
+	NVM_VBLK_LAYOUT_LUN_FIRST = 0x10 ///< Line members ordered LUN-first
+};
+
+/**
+ * Enumeration of I/O classes, each class has its own per-LUN limits
+ *
+ * @see nvm_dev_set_io_class, nvm_vblk_set_io_class, nvm_dev_set_io_limit
+ */
+enum nvm_io_class {
+	NVM_IO_CLASS_LATENCY = 0x0,	///< Latency-critical, the default
+	NVM_IO_CLASS_THROUGHPUT = 0x1,	///< Throughput, e.g. bulk writes
+	NVM_IO_CLASS_BACKGROUND = 0x2	///< Background, e.g. compaction and GC
+};
+#define NVM_IO_NCLASSES 3	///< Number of I/O classes
+
+/**
+ * Enumeration of submission queue combining flags
+ *
+ * @see nvm_dev_set_sq
+ */
+enum nvm_sq_flags {
+	NVM_SQ_NONE = 0x0,	///< Submission queue disabled
+	NVM_SQ_PMODE = 0x1,	///< Combine single-plane into multi-plane
+	NVM_SQ_MERGE = 0x2	///< Merge commands into full vector commands
+};
+
 /**
  * Enumeration of pseudo meta mode
  */
@@ -127,6 +176,16 @@ enum nvm_bounds {
 
 /**
  * Encapsulation and representation of lower-level error conditions
+ *
+ * For vector commands, `status` is the per-address completion bitmap, bit `i`
+ * is set when the command failed for address `i` of the address list. When the
+ * backend does not report which addresses failed, then all bits covering the
+ * address list are set.
+ *
+ * Address lists split into several commands report the bits of all failed
+ * commands, and of those not sent after a failure, at the position of their
+ * addresses within the list. Failures past address 63 cannot be represented,
+ * all bits are then set.
  */
 struct nvm_ret {
 	uint64_t status;	///< NVMe command status / completion bits
@@ -381,6 +440,35 @@ struct nvm_bbt {
 	uint8_t blks[];		///< Array of block status for each block in LUN
 };
 
+/**
+ * Load and latency statistics of a LUN
+ *
+ * @see nvm_dev_set_lun_stats, nvm_dev_get_lun_stats and nvm_dev_place_luns
+ */
+struct nvm_lun_stats {
+	int outstanding;	///< # of commands submitted and not completed
+	uint64_t ncmds;		///< # of commands completed
+	double lat_us;		///< Moving average of command latency in usec
+	uint64_t nreads;	///< # of reads completed
+	double read_lat_us;	///< Moving average of read latency in usec
+	double read_p50_us;	///< Estimated median of recent read latency
+	double read_p99_us;	///< Estimated 99th percentile of recent reads
+	int slow;		///< Whether an outlier, see nvm_dev_set_slow_luns
+};
+
+/**
+ * A single read-request of a batch of virtual block reads
+ *
+ * @see nvm_vblk_pread_batch
+ */
+struct nvm_vblk_pread_req {
+	struct nvm_vblk *vblk;	///< Virtual block to read from
+	void *buf;		///< Buffer to store the result of the read into
+	size_t count;		///< # of bytes to read
+	size_t offset;		///< Offset, in bytes, within the virtual block
+	ssize_t res;		///< `count` on success, -1 on error
+};
+
 /**
  * @returns the "major" version of the library
  */
@@ -537,6 +625,48 @@ void nvm_bbt_pr(const struct nvm_bbt *bbt);
  */
 void nvm_bbt_state_pr(int state);
 
+/**
+ * Retrieves the descriptor of the chunk containing the given address, i.e. its
+ * state, type, wear-level index and write pointer, see `struct nvm_spec_chunk`
+ *
+ * The chunk information is cached by the device handle. The descriptors of
+ * all chunks of a LUN are fetched from the device in bulk on the first lookup
+ * within the LUN, thereafter lookups are served from the cache which is kept
+ * current by the erases and writes issued via `nvm_addr_*` and `nvm_vblk_*`.
+ *
+ * @note
+ * Only devices implementing Open-Channel SSD 2.0 report chunk information
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param addr Address of the chunk, using the channel, LUN and block fields
+ * @param chunk Pointer to the descriptor in which to store the information
+ * @param ret Pointer to structure in which to store lower-level status and
+ *            result
+ * @returns 0 on success. On error: returns -1, sets `errno` accordingly, and
+ *          fills `ret` with lower-level result and status codes, `ENOSYS` when
+ *          the device does not report chunk information
+ */
+int nvm_chunk_get(struct nvm_dev *dev, struct nvm_addr addr,
+		  struct nvm_spec_chunk *chunk, struct nvm_ret *ret);
+
+/**
+ * Fetches the descriptors of all chunks of the LUN containing the given address
+ * anew, e.g. after the chunks were written by means other than the library
+ *
+ * Chunks of LUNs where an erase or write failed are fetched anew automatically
+ * on the next call to `nvm_chunk_get`.
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param addr Address of the LUN, using the channel and LUN fields
+ * @param ret Pointer to structure in which to store lower-level status and
+ *            result
+ * @returns 0 on success. On error: returns -1, sets `errno` accordingly, and
+ *          fills `ret` with lower-level result and status codes, `ENOSYS` when
+ *          the device does not report chunk information
+ */
+int nvm_chunk_refresh(struct nvm_dev *dev, struct nvm_addr addr,
+		      struct nvm_ret *ret);
+
 /**
  * Prints human readable representation of the given geometry
  */
@@ -568,6 +698,33 @@ struct nvm_dev *nvm_dev_openf(const char *dev_path, int flags);
  */
 void nvm_dev_close(struct nvm_dev *dev);
 
+/**
+ * Creates a handle to the partition of the given device consisting of the
+ * channels [ch_bgn, ch_end] and the LUNs [lun_bgn, lun_end] of each of them
+ *
+ * The partition shares the backend and file descriptor of the device, its
+ * geometry describes the partition only and addresses are partition-local,
+ * that is, channel 0 and LUN 0 of the partition are channel `ch_bgn` and LUN
+ * `lun_bgn` of the device. Address checks, conversions, bad-block-tables,
+ * and the nvm_addr_* and nvm_vblk_* functions thus operate within the
+ * partition. The submission queue and scheduler of the partition are disabled
+ * regardless of those of the device.
+ *
+ * @note
+ * Close partitions, using `nvm_dev_close`, before closing the device
+ *
+ * @param dev Device handle obtained with `nvm_dev_open` or `nvm_dev_partition`
+ * @param ch_bgn First channel of the partition
+ * @param ch_end Last channel of the partition
+ * @param lun_bgn First LUN of the partition
+ * @param lun_end Last LUN of the partition
+ *
+ * @returns A handle to the partition on success. On error, NULL is returned
+ * and `errno` set to indicate the error.
+ */
+struct nvm_dev *nvm_dev_partition(struct nvm_dev *dev, int ch_bgn, int ch_end,
+				  int lun_bgn, int lun_end);
+
 /**
  * Prints misc. device attribute associated with the given handle
  *
@@ -631,6 +788,59 @@ int nvm_dev_get_verid(const struct nvm_dev *dev);
  */
 uint32_t nvm_dev_get_mccap(const struct nvm_dev *dev);
 
+/**
+ * Returns whether nvm_addr_copy is carried out by the device
+ *
+ * This is the case for devices advertising NVM_SPEC_20_MCCAP_VCOPY, until a
+ * vector copy is rejected by the backend, copies are then done by the host.
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @return 1 when copies are offloaded to the device, 0 otherwise
+ */
+int nvm_dev_get_vcopy(const struct nvm_dev *dev);
+
+/**
+ * Returns the # of sectors which an Open-Channel SSD 2.0 device may not yet be
+ * able to read after they are written, e.g. mw_cunits of the geometry
+ *
+ * Of each open chunk, the data of the last `mw_cunits` sectors written must be
+ * kept by the host, see nvm_dev_set_wcache.
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @return The # of sectors, 0 when the device does not report it
+ */
+int nvm_dev_get_mw_cunits(const struct nvm_dev *dev);
+
+/**
+ * Returns whether the device handle keeps the write caches of open chunks
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @return 1 when enabled, 0 otherwise
+ */
+int nvm_dev_get_wcache(const struct nvm_dev *dev);
+
+/**
+ * Enable or disable the write caches of open chunks, enabled by default on
+ * devices reporting `mw_cunits`, see nvm_dev_get_mw_cunits
+ *
+ * With the caches enabled, the last `mw_cunits` sectors written to each open
+ * chunk via `nvm_addr_*` and `nvm_vblk_*` are kept by the device handle, and
+ * reads of these sectors are served from the cache instead of the device.
+ * The cache of a chunk is released when the chunk is fully written or reset.
+ * Disabling discards the cached sectors, callers must then keep the data of
+ * these sectors themselves.
+ *
+ * @note
+ * The caches are shared by a device and its partitions
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param enabled 1 to enable, 0 to disable
+ *
+ * @returns 0 on success, -1 on error and errno set to indicate the error,
+ * `ENOSYS` when the device does not report `mw_cunits`
+ */
+int nvm_dev_set_wcache(struct nvm_dev *dev, int enabled);
+
 /**
  * Returns the default plane_mode of the given device
  *
@@ -792,6 +1002,242 @@ int nvm_dev_set_read_naddrs_max(struct nvm_dev *dev, int naddrs);
  */
 int nvm_dev_set_write_naddrs_max(struct nvm_dev *dev, int naddrs);
 
+/**
+ * Returns the maximum number of times the virtual block interface re-submits
+ * the failed addresses of a command
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ */
+int nvm_dev_get_nretries(const struct nvm_dev *dev);
+
+/**
+ * Set the maximum number of times the virtual block interface re-submits the
+ * failed addresses of a command, 0 disables retries.
+ *
+ * @note
+ * Only reads and erases are re-submitted, and only the addresses reported as
+ * failed in the completion bitmap, erases along with the other addresses of
+ * their block, as these are erased together. Completions flagged "Do Not
+ * Retry" or reporting an empty page are not retried. Failed writes are
+ * returned as is, a page cannot be programmed again without an erase, the
+ * data must be relocated by the caller
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param nretries The maximum
+ *
+ * @returns 0 on success, -1 on error and errno set to indicate the error.
+ */
+int nvm_dev_set_nretries(struct nvm_dev *dev, int nretries);
+
+/**
+ * Returns the combining flags of the submission queue of the device, see
+ * enum nvm_sq_flags
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ */
+int nvm_dev_get_sq(const struct nvm_dev *dev);
+
+/**
+ * Enable or disable the submission queue of the device
+ *
+ * With the submission queue enabled, vector commands of less than
+ * NVM_NADDR_MAX addresses, issued by nvm_addr_erase, nvm_addr_write,
+ * nvm_addr_read and the nvm_vblk_* functions, are queued. The first command
+ * of a batch waits for up to `window_us` for others to arrive, the batch is
+ * then combined according to `flags` and issued. Completions are split back
+ * per caller, each caller blocks until its own command is completed.
+ *
+ * With NVM_SQ_PMODE, single-plane commands from independent callers, which
+ * together address all planes of the same page, or block for erase, are
+ * combined into one multi-plane command.
+ *
+ * With NVM_SQ_MERGE, commands of equal opcode and access mode are merged into
+ * shared vector commands of up to the maximum number of addresses of the
+ * device for the opcode, e.g. `read_naddrs_max`. The flags can be combined,
+ * multi-plane commands formed by NVM_SQ_PMODE are then merged as a whole.
+ *
+ * @note
+ * Do not change the submission queue while I/O is in flight on the device
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param flags Combining flags, see enum nvm_sq_flags, NVM_SQ_NONE disables
+ * @param window_us The collection window in microseconds
+ *
+ * @returns 0 on success, -1 on error and errno set to indicate the error.
+ */
+int nvm_dev_set_sq(struct nvm_dev *dev, int flags, int window_us);
+
+/**
+ * Returns the maximum number of commands in flight per LUN of the device
+ * scheduler, 0 when the scheduler is disabled
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ */
+int nvm_dev_get_sched(const struct nvm_dev *dev);
+
+/**
+ * Enable or disable the per-LUN scheduler of the device
+ *
+ * With the scheduler enabled, every vector command sent to the device, via
+ * nvm_cmd_vuser, the nvm_addr_* and the nvm_vblk_* functions, is admitted to
+ * the LUNs it addresses while each of them has less than `inflight_max`
+ * commands in flight. Waiting reads are admitted before waiting programs and
+ * erases. A command waiting for longer than `deadline_us` becomes urgent and
+ * is admitted before anything else, thus writes are not starved by reads.
+ *
+ * When the media controller supports program/erase suspension, see `mccap`,
+ * programs and erases are issued with NVM_FLAG_SUSPEND, the command passed by
+ * the caller is not modified. While they are in flight on a LUN, one read
+ * beyond `inflight_max` is admitted to it, that read thus waits for at most a
+ * suspend instead of an entire program or erase, further reads wait for
+ * admission as usual. Erases addressing multiple LUNs are issued as one
+ * command per LUN, in parallel, such that a read waits only for the erase of
+ * its own LUN.
+ *
+ * @note
+ * Do not change the scheduler while I/O is in flight on the device
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param inflight_max Maximum # of commands in flight per LUN, 0 disables
+ * @param deadline_us Wait before a command becomes urgent, 0 for never
+ *
+ * @returns 0 on success, -1 on error and errno set to indicate the error.
+ */
+int nvm_dev_set_sched(struct nvm_dev *dev, int inflight_max, int deadline_us);
+
+/**
+ * Returns the I/O class of commands sent via the device handle, see enum
+ * nvm_io_class
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ */
+int nvm_dev_get_io_class(const struct nvm_dev *dev);
+
+/**
+ * Set the I/O class of commands sent via the device handle, virtual blocks
+ * allocated thereafter inherit it
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param io_class The I/O class, see enum nvm_io_class
+ *
+ * @returns 0 on success, -1 on error and errno set to indicate the error.
+ */
+int nvm_dev_set_io_class(struct nvm_dev *dev, int io_class);
+
+/**
+ * Limit the bandwidth and command rate of an I/O class on each LUN of the
+ * device handle
+ *
+ * Every vector command sent via the handle is charged, before it is sent, to
+ * a token bucket per LUN it addresses and I/O class, holding up to 100ms worth
+ * of the limits. The command waits while any of its buckets is depleted.
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param io_class The I/O class, see enum nvm_io_class
+ * @param bytes_per_sec Maximum # of bytes per second per LUN, 0 for no limit
+ * @param cmds_per_sec Maximum # of commands per second per LUN, 0 for no limit
+ *
+ * @returns 0 on success, -1 on error and errno set to indicate the error.
+ */
+int nvm_dev_set_io_limit(struct nvm_dev *dev, int io_class,
+			 uint64_t bytes_per_sec, uint64_t cmds_per_sec);
+
+/**
+ * Returns whether per-LUN statistics are collected for the device handle
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ */
+int nvm_dev_get_lun_stats_enabled(const struct nvm_dev *dev);
+
+/**
+ * Enable or disable the collection of per-LUN statistics, see struct
+ * nvm_lun_stats, of the vector commands sent via the device handle,
+ * disabling discards the statistics collected
+ *
+ * @note
+ * Do not change the statistics collection while I/O is in flight on the
+ * device
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param enabled 1 to enable, 0 to disable
+ *
+ * @returns 0 on success, -1 on error and errno set to indicate the error.
+ */
+int nvm_dev_set_lun_stats(struct nvm_dev *dev, int enabled);
+
+/**
+ * Retrieve the statistics of the LUN with the given address
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param addr Address of the LUN, `ch` and `lun` are used
+ * @param stats Pointer to the struct to fill with the statistics
+ *
+ * @returns 0 on success, -1 on error and errno set to indicate the error.
+ */
+int nvm_dev_get_lun_stats(struct nvm_dev *dev, struct nvm_addr addr,
+			  struct nvm_lun_stats *stats);
+
+/**
+ * Suggest the least-loaded LUNs of the device as targets for new writes
+ *
+ * LUNs are ranked by their expected wait, that is, the number of outstanding
+ * commands, plus one, times their average latency. Outstanding commands on a
+ * LUN without completions yet count with the mean latency of the other LUNs,
+ * idle LUNs without statistics rank first and slow LUNs last, see
+ * nvm_dev_set_slow_luns. Equally ranked LUNs are given channel-first, thus
+ * spread across channels.
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param addrs Array to fill with the LUN addresses, `ch` and `lun` are set
+ * @param naddrs The # of LUNs to suggest
+ *
+ * @returns 0 on success, -1 on error and errno set to indicate the error.
+ * When slow LUNs are excluded and too few others remain, errno is EBUSY.
+ */
+int nvm_dev_place_luns(struct nvm_dev *dev, struct nvm_addr addrs[],
+		       int naddrs);
+
+/**
+ * Detect slow LUNs and set how placement treats them
+ *
+ * A LUN is flagged slow, see struct nvm_lun_stats, when its average read
+ * latency exceeds `factor` times the median of the averages of all LUNs that
+ * have been read. Slow LUNs are ranked after all others by
+ * nvm_dev_place_luns and nvm_vblk_alloc_placed, or, with `exclude`, never
+ * suggested.
+ *
+ * @note
+ * Requires statistics to be enabled, see nvm_dev_set_lun_stats
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param factor Outlier threshold e.g. 2.0, 0 disables detection
+ * @param exclude 1 to exclude slow LUNs from placement, 0 to rank them last
+ *
+ * @returns 0 on success, -1 on error and errno set to indicate the error.
+ */
+int nvm_dev_set_slow_luns(struct nvm_dev *dev, double factor, int exclude);
+
+/**
+ * Periodically probe the read latency of all LUNs
+ *
+ * Every `interval_ms`, a background thread reads the first sector of block
+ * `blk` on each LUN, in the I/O class NVM_IO_CLASS_BACKGROUND, such that the
+ * statistics of LUNs which are otherwise not read are kept up to date. When
+ * started, the probe erases `blk` on each LUN and writes its first page, such
+ * that it measures reads of data instead of failures on an unwritten page.
+ *
+ * @note
+ * Requires statistics to be enabled, see nvm_dev_set_lun_stats. Block `blk`
+ * is overwritten, reserve it for the probe.
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param interval_ms Interval between probes, 0 stops probing
+ * @param blk Block reserved for the probe
+ *
+ * @returns 0 on success, -1 on error and errno set to indicate the error.
+ */
+int nvm_dev_set_lun_probe(struct nvm_dev *dev, int interval_ms, int blk);
+
 /**
  * Returns the geometry of the given device
  *
@@ -888,6 +1334,16 @@ int nvm_buf_from_file(char *buf, size_t nbytes, const char *path);
  * contrast to `nvm_addr_mark`, `nvm_addr_write`, and `nvm_addr_read` for which
  * the address is interpreted as a sector address.
  *
+ * @note
+ * Address lists longer than the device maximum, see
+ * nvm_dev_set_erase_naddrs_max, are split into multiple commands which are
+ * submitted concurrently
+ *
+ * @note
+ * On Open-Channel SSD 2.0 devices the chunks of the addresses are reset, all
+ * addresses within the same chunk, e.g. one per plane, collapse into a single
+ * address of the reset
+ *
  * @param dev Device handle obtained with `nvm_dev_open`
  * @param addrs Array of memory address
  * @param naddrs Length of array of memory addresses
@@ -895,7 +1351,10 @@ int nvm_buf_from_file(char *buf, size_t nbytes, const char *path);
  * @param ret Pointer to structure in which to store lower-level status and
  *            result.
  * @returns 0 on success. On error: returns -1, sets `errno` accordingly, and
- *          fills `ret` with lower-level result and status codes
+ *          fills `ret` with lower-level result and status codes, where
+ *          `ret->status` holds the bitmap of failed addresses. Completions
+ *          with a high-ECC warning are successful, the warning is still
+ *          reported in `ret`
  */
 ssize_t nvm_addr_erase(struct nvm_dev *dev, struct nvm_addr addrs[], int naddrs,
 		       uint16_t flags, struct nvm_ret *ret);
@@ -908,6 +1367,12 @@ ssize_t nvm_addr_erase(struct nvm_dev *dev, struct nvm_addr addrs[], int naddrs,
  * contrast to nvm_addr_mark and nvm_addr_erase for which the address is
  * interpreted as a block address.
  *
+ * @note
+ * Address lists longer than the device maximum, see
+ * nvm_dev_set_write_naddrs_max, are split into multiple commands of whole
+ * plane-mode groups. Commands to different LUNs are submitted concurrently,
+ * commands to the same LUN are submitted in order
+ *
  * @param dev Device handle obtained with `nvm_dev_open`
  * @param addrs Array of memory address
  * @param naddrs Length of array of memory addresses
@@ -920,7 +1385,10 @@ ssize_t nvm_addr_erase(struct nvm_dev *dev, struct nvm_addr addrs[], int naddrs,
  * @param ret Pointer to structure in which to store lower-level status and
  *            result.
  * @returns 0 on success. On error: returns -1, sets `errno` accordingly, and
- *          fills `ret` with lower-level result and status codes
+ *          fills `ret` with lower-level result and status codes, where
+ *          `ret->status` holds the bitmap of failed addresses. Completions
+ *          with a high-ECC warning are successful, the warning is still
+ *          reported in `ret`
  */
 ssize_t nvm_addr_write(struct nvm_dev *dev, struct nvm_addr addrs[], int naddrs,
 		       const void *buf, const void *meta, uint16_t flags,
@@ -934,6 +1402,11 @@ ssize_t nvm_addr_write(struct nvm_dev *dev, struct nvm_addr addrs[], int naddrs,
  * contrast to `nvm_addr_mark` and `nvm_addr_erase` for which the address is
  * interpreted as a block address.
  *
+ * @note
+ * Address lists longer than the device maximum, see
+ * nvm_dev_set_read_naddrs_max, are split into multiple commands of whole
+ * plane-mode groups which are submitted concurrently
+ *
  * @param dev Device handle obtained with `nvm_dev_open`
  * @param addrs List of memory address
  * @param naddrs Length of array of memory addresses
@@ -946,12 +1419,101 @@ ssize_t nvm_addr_write(struct nvm_dev *dev, struct nvm_addr addrs[], int naddrs,
  * @param ret Pointer to structure in which to store lower-level status and
  *            result.
  * @returns 0 on success. On error: returns -1, sets `errno` accordingly, and
- *          fills `ret` with lower-level result and status codes
+ *          fills `ret` with lower-level result and status codes, where
+ *          `ret->status` holds the bitmap of failed addresses. Completions
+ *          with a high-ECC warning are successful, the warning is still
+ *          reported in `ret`
  */
 ssize_t nvm_addr_read(struct nvm_dev *dev, struct nvm_addr addrs[], int naddrs,
 		      void *buf, void *meta, uint16_t flags,
 		      struct nvm_ret *ret);
 
+/**
+ * Write content of the io-vector to nvm at address(es)
+ *
+ * Equivalent to nvm_addr_write, except that the data is given as an io-vector
+ * of segments instead of a single contiguous buffer. Each command points
+ * directly into the segments, only plane-mode groups straddling two segments
+ * are copied via a bounce buffer.
+ *
+ * @note
+ * Segments must be aligned as buffers from nvm_buf_alloc and their length a
+ * multiple of `geo.sector_nbytes`, the total length must equal `naddrs *
+ * geo.sector_nbytes`
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param addrs Array of memory address
+ * @param naddrs Length of array of memory addresses
+ * @param iov The io-vector which content to write
+ * @param iovcnt Number of segments in the io-vector
+ * @param meta Buffer containing metadata, must be of size equal to device
+ *             `naddrs * geo.meta_nbytes`
+ * @param flags Access mode
+ * @param ret Pointer to structure in which to store lower-level status and
+ *            result.
+ * @returns 0 on success. On error: returns -1, sets `errno` accordingly, and
+ *          fills `ret` with lower-level result and status codes
+ */
+ssize_t nvm_addr_writev(struct nvm_dev *dev, struct nvm_addr addrs[],
+			int naddrs, const struct iovec *iov, int iovcnt,
+			const void *meta, uint16_t flags, struct nvm_ret *ret);
+
+/**
+ * Read content of nvm at addresses into the io-vector
+ *
+ * Equivalent to nvm_addr_read, except that the data is given as an io-vector
+ * of segments instead of a single contiguous buffer, see nvm_addr_writev
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param addrs List of memory address
+ * @param naddrs Length of array of memory addresses
+ * @param iov The io-vector to store the result of the read into
+ * @param iovcnt Number of segments in the io-vector
+ * @param meta Buffer to store content of metadata, must be of size equal to
+ *             device `naddrs * geo.meta_nbytes`
+ * @param flags Access mode
+ * @param ret Pointer to structure in which to store lower-level status and
+ *            result.
+ * @returns 0 on success. On error: returns -1, sets `errno` accordingly, and
+ *          fills `ret` with lower-level result and status codes
+ */
+ssize_t nvm_addr_readv(struct nvm_dev *dev, struct nvm_addr addrs[],
+		       int naddrs, const struct iovec *iov, int iovcnt,
+		       void *meta, uint16_t flags, struct nvm_ret *ret);
+
+/**
+ * Copy the sectors at `src` to `dst`, along with their meta-data
+ *
+ * When the device supports it, see nvm_dev_get_vcopy, the sectors are copied
+ * by the device with the vector copy command, without transferring them to
+ * the host. Each command carries a source and a destination address list of
+ * up to NVM_NADDR_MAX addresses, made of whole write units, that is, runs of
+ * `nsectors` consecutive sectors of a chunk starting at a multiple of
+ * `nsectors`. Copies are sent via the I/O class limits and the scheduler like
+ * other commands, the LUNs of the destination in parallel. Otherwise, and for
+ * the sectors of a LUN from its first failed vector copy, or first sectors
+ * not forming a write unit, on, the sectors are read into, and written from,
+ * a host buffer in commands of up to NVM_NADDR_MAX addresses.
+ *
+ * @note
+ * The destination addresses must satisfy the constraints of writes, that is,
+ * whole plane-mode groups of `nsectors` sectors written in order.
+ *
+ * @param dev Handle to the device
+ * @param src Array of source addresses
+ * @param dst Array of destination addresses
+ * @param naddrs Length of the arrays
+ * @param flags Access mode
+ * @param ret Pointer to structure in which to store lower-level status and
+ *            result, for the device-side copy, `status` covers the addresses
+ *            of the failed command
+ *
+ * @returns 0 on success. On error, -1 and `errno` set to indicate the error.
+ */
+ssize_t nvm_addr_copy(struct nvm_dev *dev, struct nvm_addr src[],
+		      struct nvm_addr dst[], int naddrs, uint16_t flags,
+		      struct nvm_ret *ret);
+
 /**
  * Checks whether the given address exceeds bounds of the given geometry
  *
@@ -1075,6 +1637,92 @@ struct nvm_vblk *nvm_vblk_alloc_line(struct nvm_dev *dev, int ch_bgn,
 				     int ch_end, int lun_bgn, int lun_end,
 				     int blk);
 
+/**
+ * Allocate a virtual block with the given striping layout
+ *
+ * With NVM_VBLK_LAYOUT_PAGE, multi-plane pages are striped round-robin over
+ * groups of `width` consecutive member blocks, each group is filled before
+ * the next. A `width` of zero means all members, which is the layout of
+ * nvm_vblk_alloc. With NVM_VBLK_LAYOUT_BLOCK each member block is filled
+ * before the next, `width` is ignored.
+ *
+ * The layout is used consistently by read, write, and nvm_vblk_off2addr. A
+ * wide stripe suits a single stream needing the bandwidth of all members,
+ * narrow stripes suit many concurrent streams each writing a few members.
+ *
+ * @param dev Handle to the device on which the virtual block resides
+ * @param addrs Set of block-addresses forming the virtual block
+ * @param naddrs The number of addresses in the address-set
+ * @param layout The layout, see enum nvm_vblk_layout
+ * @param width # of member blocks per stripe, must divide naddrs, 0 means all
+ *
+ * @returns On success, an opaque pointer to the initialized virtual block is
+ * returned. On error, NULL and `errno` set to indicate the error.
+ */
+struct nvm_vblk *nvm_vblk_alloc_layout(struct nvm_dev *dev,
+				       struct nvm_addr addrs[], int naddrs,
+				       int layout, int width);
+
+/**
+ * Allocate a virtual block spanning a set of parallel units with the given
+ * striping layout, see nvm_vblk_alloc_layout
+ *
+ * By default the members are ordered channel-first, that is, consecutive
+ * members reside on different channels. With NVM_VBLK_LAYOUT_LUN_FIRST set in
+ * `layout`, consecutive members reside on different LUNs of the same channel.
+ *
+ * @param dev Handle to the device on which the virtual block resides
+ * @param ch_bgn Beginning of channel span, as inclusive index
+ * @param ch_end End of channel span, as inclusive index
+ * @param lun_bgn Beginning of LUN span, as inclusive index
+ * @param lun_end End of LUN span, as inclusive index
+ * @param blk Block index
+ * @param layout The layout, see enum nvm_vblk_layout
+ * @param width # of member blocks per stripe, 0 means all
+ *
+ * @returns On success, an opaque pointer to the initialized virtual block is
+ * returned. On error, NULL and `errno` set to indicate the error.
+ */
+struct nvm_vblk *nvm_vblk_alloc_line_layout(struct nvm_dev *dev, int ch_bgn,
+					    int ch_end, int lun_bgn,
+					    int lun_end, int blk, int layout,
+					    int width);
+
+/**
+ * Allocate a virtual block of the given chunks of an Open-Channel SSD 2.0
+ * device, striped as with nvm_vblk_alloc
+ *
+ * The write cursor starts at the write pointers of the chunks, see
+ * nvm_vblk_recover_pos, and writes are checked against the write pointers,
+ * writes not starting at the write pointer of a chunk fail with `EINVAL`
+ * instead of being rejected by the device.
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param chunks Array of chunk addresses
+ * @param nchunks Length of the array of chunk addresses
+ *
+ * @returns On success, an opaque pointer to the initialized virtual block is
+ * returned. On error, NULL and `errno` set to indicate the error, `ENOSYS`
+ * when the device does not report chunk information and `EIO` when a chunk is
+ * offline
+ */
+struct nvm_vblk *nvm_vblk_alloc_chunks(struct nvm_dev *dev,
+				       struct nvm_addr chunks[], int nchunks);
+
+/**
+ * Allocate a virtual block spanning block `blk` of the `nluns` least-loaded
+ * LUNs of the device, see nvm_dev_place_luns
+ *
+ * @param dev Device handle obtained with `nvm_dev_open`
+ * @param nluns The # of LUNs to span
+ * @param blk Block index
+ *
+ * @returns On success, an opaque pointer to the initialized virtual block is
+ * returned.  On error, NULL and `errno` set to indicate the error.
+ */
+struct nvm_vblk *nvm_vblk_alloc_placed(struct nvm_dev *dev, int nluns,
+				       int blk);
+
 /**
  * Destroy a virtual block
  *
@@ -1132,6 +1780,27 @@ ssize_t nvm_vblk_write(struct nvm_vblk *vblk, const void *buf, size_t count);
 ssize_t nvm_vblk_pwrite(struct nvm_vblk *vblk, const void *buf, size_t count,
 			size_t offset);
 
+/**
+ * Write the content of an io-vector to a virtual block at a given offset
+ *
+ * Equivalent to nvm_vblk_pwrite, except that the data is given as an io-vector
+ * of segments, each command points directly into the segments without copying
+ *
+ * @note
+ * Segments must be aligned as buffers from nvm_buf_alloc and their length a
+ * multiple of `geo.sector_nbytes`, the total length must be a multiple of
+ * min-size, see struct nvm_geo
+ *
+ * @param vblk The virtual block to write to
+ * @param iov The io-vector which content to write
+ * @param iovcnt Number of segments in the io-vector
+ * @param offset Start writing offset bytes within virtual block
+ * @returns On success, the number of bytes written is returned. On error, -1 is
+ * returned and `errno` set to indicate the error.
+ */
+ssize_t nvm_vblk_pwritev(struct nvm_vblk *vblk, const struct iovec *iov,
+			 int iovcnt, size_t offset);
+
 /**
  * Pad the virtual block with synthetic data
  *
@@ -1146,6 +1815,49 @@ ssize_t nvm_vblk_pwrite(struct nvm_vblk *vblk, const void *buf, size_t count,
  */
 ssize_t nvm_vblk_pad(struct nvm_vblk *vblk);
 
+/**
+ * Append to a virtual block via its write-combining buffer
+ *
+ * Appends of arbitrary size are combined in a stripe-sized buffer, allocated
+ * on first use. Whenever the appended data reaches a stripe boundary, that is,
+ * one multi-plane page on every member block, it is written. Appends of whole
+ * stripes, with nothing buffered, are written directly from `buf`.
+ *
+ * Appended bytes which are not yet written are served by nvm_vblk_pread.
+ *
+ * @note
+ * Use nvm_vblk_flush before nvm_vblk_write or nvm_vblk_set_pos_write, these
+ * fail with `EINVAL` while appended bytes are buffered. Buffered bytes are
+ * discarded by nvm_vblk_erase, nvm_vblk_recover_pos and nvm_vblk_free.
+ *
+ * When a write fails, the write position is not advanced. The bytes of `buf`
+ * preceding the failed stripe are consumed, that is, written or buffered, the
+ * remainder is not. As a failed stripe cannot be programmed again without an
+ * erase, its data must be relocated, e.g. to another virtual block.
+ *
+ * @param vblk The virtual block to append to
+ * @param buf Content to append
+ * @param count The number of bytes to append, any size
+ * @returns On success, `count` is returned. When a write fails after part of
+ * `buf` is consumed, the number of bytes consumed is returned. Otherwise, on
+ * error, -1 is returned and `errno` set to indicate the error.
+ */
+ssize_t nvm_vblk_append(struct nvm_vblk *vblk, const void *buf, size_t count);
+
+/**
+ * Write the bytes buffered by nvm_vblk_append
+ *
+ * The buffered bytes are padded with zeroes to min-size, see struct nvm_geo,
+ * the next append thus starts at the following aligned offset, see
+ * nvm_vblk_get_pos_append
+ *
+ * @param vblk The virtual block to flush
+ * @returns On success, the number of bytes written including padding is
+ * returned, 0 when nothing is buffered. On error, -1 is returned and `errno`
+ * set to indicate the error.
+ */
+ssize_t nvm_vblk_flush(struct nvm_vblk *vblk);
+
 /**
  * Read from a virtual block
  */
@@ -1153,10 +1865,95 @@ ssize_t nvm_vblk_read(struct nvm_vblk *vblk, void *buf, size_t count);
 
 /**
  * Read from a virtual block at given offset
+ *
+ * @note
+ * Offset and count need not be aligned, when they are not a multiple of
+ * min-size, see struct nvm_geo, the aligned middle of the range is read in
+ * the configured plane-mode and only the sectors covering the unaligned head
+ * and tail are read using single-sector addressing
+ *
+ * @param vblk The virtual block to read from
+ * @param buf Buffer to store the result of the read into
+ * @param count The number of bytes to read
+ * @param offset Start reading offset bytes within virtual block
+ * @returns On success, the number of bytes read is returned. On error, -1 is
+ * returned and `errno` set to indicate the error.
  */
 ssize_t nvm_vblk_pread(struct nvm_vblk *vblk, void *buf, size_t count,
 		       size_t offset);
 
+/**
+ * Read from a virtual block at a given offset into an io-vector
+ *
+ * Equivalent to nvm_vblk_pread, except that the data is given as an io-vector
+ * of segments, see nvm_vblk_pwritev
+ *
+ * @param vblk The virtual block to read from
+ * @param iov The io-vector to read into
+ * @param iovcnt Number of segments in the io-vector
+ * @param offset Start reading offset bytes within virtual block
+ * @returns On success, the number of bytes read is returned. On error, -1 is
+ * returned and `errno` set to indicate the error.
+ */
+ssize_t nvm_vblk_preadv(struct nvm_vblk *vblk, const struct iovec *iov,
+			int iovcnt, size_t offset);
+
+/**
+ * Read a batch of independent ranges from one or more virtual blocks
+ *
+ * The sectors of all requests are grouped by the LUN they reside on and packed
+ * into vector commands of up to `read_naddrs_max` addresses, the LUNs are read
+ * in parallel, by at most as many threads as the widest vblk has members.
+ * Failed addresses are retried as with nvm_vblk_pread, see
+ * nvm_dev_set_nretries. This is intended for many small reads, e.g. point-lookups,
+ * where issuing nvm_vblk_pread one range at a time leaves the device idle.
+ * Commands holding sectors of a vblk with parity hold no other sectors, such
+ * that unreadable ones are reconstructed, see nvm_vblk_set_parity.
+ *
+ * @note
+ * Offset and count of each request must be a multiple of `geo.sector_nbytes`,
+ * all virtual blocks must reside on the same device. Reads are submitted in
+ * single-plane mode.
+ *
+ * @param reqs Array of read-requests, `res` of each request is set to `count`
+ *             on success and -1 on error
+ * @param nreqs Length of the array of read-requests
+ * @returns 0 when all requests succeeded. On error, -1 is returned and `errno`
+ * set to indicate the error, `EIO` when one or more requests failed.
+ */
+ssize_t nvm_vblk_pread_batch(struct nvm_vblk_pread_req *reqs, int nreqs);
+
+/**
+ * Copy `count` bytes of `src`, starting at `offset`, to `dst`, e.g. to move
+ * the valid data of a vblk during garbage collection
+ *
+ * The range is copied in windows of two stripes of `src`, the next window is
+ * read while the current is written, thus reads and writes overlap. The data
+ * is appended to `dst`, see nvm_vblk_append, call nvm_vblk_flush to write out
+ * the bytes remaining in its write-combining buffer.
+ *
+ * When both vblks reside on the same device and the device copies sectors
+ * itself, see nvm_dev_get_vcopy, whole super-pages are instead copied with
+ * nvm_addr_copy, without transferring them to the host, provided that `dst`
+ * has no parity and no buffered appends.
+ *
+ * @note
+ * Offset and count must be a multiple of `geo.sector_nbytes`.
+ *
+ * @param dst The vblk to append the data to
+ * @param src The vblk to read the data from
+ * @param offset Start offset of the range within `src`
+ * @param count The # of bytes of the range
+ * @param valid Bitmap of the sectors of the range to copy, bit `i % 8` of
+ *              byte `i / 8` for sector `i` of the range, the others are
+ *              skipped and the valid ones appended back to back. NULL copies
+ *              all sectors.
+ * @returns The # of bytes appended to `dst`. On error, -1 and `errno` set to
+ * indicate the error.
+ */
+ssize_t nvm_vblk_copy(struct nvm_vblk *dst, struct nvm_vblk *src,
+		      size_t offset, size_t count, const uint8_t *valid);
+
 /**
  * Retrieve the device associated with the given virtual block
  *
@@ -1164,6 +1961,109 @@ ssize_t nvm_vblk_pread(struct nvm_vblk *vblk, void *buf, size_t count,
  */
 struct nvm_dev *nvm_vblk_get_dev(struct nvm_vblk *vblk);
 
+/**
+ * Map a byte offset within the virtual block to the address of the sector
+ * holding it, according to the striping layout of the virtual block
+ *
+ * @param vblk The virtual block
+ * @param off Offset, in bytes, within the virtual block
+ * @param addr Pointer to store the address of the sector in
+ * @returns On success, 0 is returned. On error, -1 is returned and `errno` set
+ * to indicate the error.
+ */
+int nvm_vblk_off2addr(struct nvm_vblk *vblk, size_t off, struct nvm_addr *addr);
+
+/**
+ * Retrieve the striping layout of the given virtual block
+ *
+ * @param vblk The entity to retrieve information from
+ * @returns The layout, see enum nvm_vblk_layout
+ */
+int nvm_vblk_get_layout(struct nvm_vblk *vblk);
+
+/**
+ * Retrieve the stripe width, in member blocks, of the given virtual block
+ *
+ * @param vblk The entity to retrieve information from
+ */
+int nvm_vblk_get_width(struct nvm_vblk *vblk);
+
+/**
+ * Retrieve the parity block of the given virtual block
+ *
+ * @param vblk The entity to retrieve information from
+ * @returns The address of the parity block, NULL when the vblk has no parity
+ */
+struct nvm_addr *nvm_vblk_get_parity(struct nvm_vblk *vblk);
+
+/**
+ * Protect the given virtual block by XOR parity on an extra block
+ *
+ * Page `pg` of the parity block holds the XOR of page `pg` of all member
+ * blocks. Sectors which cannot be read, e.g. due to a grown bad block, are
+ * reconstructed from the same sectors of the other members and the parity
+ * block. The parity block is erased with the vblk and written along with it,
+ * writes must therefore cover whole stripes, and nvm_vblk_flush pads to a
+ * stripe. The vblk must be page-interleaved over all of its members, and the
+ * parity block must reside on a LUN without members. Set the parity before
+ * writing the vblk, a vblk holding data written without parity is rejected
+ * with EINVAL.
+ *
+ * @param vblk The vblk to change
+ * @param blk Address of the parity block, `ch`, `lun` and `blk` are used, NULL
+ * removes the parity and disables hedging
+ *
+ * @returns On success, 0 is returned. On error, -1 is returned and `errno` set
+ * to indicate the error
+ */
+int nvm_vblk_set_parity(struct nvm_vblk *vblk, const struct nvm_addr *blk);
+
+/**
+ * Retrieve the degraded-read hedging threshold of the given virtual block
+ *
+ * @param vblk The entity to retrieve information from
+ * @returns The threshold in microseconds, 0 when hedging is disabled
+ */
+int nvm_vblk_get_hedge(struct nvm_vblk *vblk);
+
+/**
+ * Enable or disable degraded-read hedging for a virtual block with parity
+ *
+ * The sectors of each read command are read per member block, by a worker
+ * thread of the member. The sectors of members which have not completed
+ * within `threshold_us`, e.g. as their LUN is busy erasing or programming,
+ * are reconstructed from the other members and the parity block meanwhile,
+ * and the first to finish provides the data. This bounds the tail latency of
+ * reads at the cost of reading all members for the hedged sectors.
+ *
+ * @param vblk The vblk to change
+ * @param threshold_us Time in microseconds to wait for a read before
+ * reconstructing, 0 disables hedging
+ *
+ * @returns On success, 0 is returned. On error, -1 is returned and `errno` set
+ * to indicate the error
+ */
+int nvm_vblk_set_hedge(struct nvm_vblk *vblk, int threshold_us);
+
+/**
+ * Retrieve the I/O class of commands sent by the given virtual block
+ *
+ * @param vblk The entity to retrieve information from
+ * @returns The I/O class, see enum nvm_io_class
+ */
+int nvm_vblk_get_io_class(struct nvm_vblk *vblk);
+
+/**
+ * Set the I/O class of commands sent by the given virtual block, overriding
+ * the class of its device handle
+ *
+ * @param vblk The entity to set the I/O class of
+ * @param io_class The I/O class, see enum nvm_io_class
+ *
+ * @returns 0 on success, -1 on error and errno set to indicate the error.
+ */
+int nvm_vblk_set_io_class(struct nvm_vblk *vblk, int io_class);
+
 /**
  * Retrieve the set of addresses defining the virtual block
  *
@@ -1199,6 +2099,42 @@ size_t nvm_vblk_get_pos_read(struct nvm_vblk *vblk);
  */
 size_t nvm_vblk_get_pos_write(struct nvm_vblk *vblk);
 
+/**
+ * Retrieve the offset at which the next nvm_vblk_append lands, that is, the
+ * write cursor plus the number of buffered bytes
+ *
+ * @param vblk The entity to retrieve information from
+ */
+size_t nvm_vblk_get_pos_append(struct nvm_vblk *vblk);
+
+/**
+ * Retrieve the read-ahead window of the given virtual block
+ *
+ * @param vblk The entity to retrieve information from
+ * @returns The # of stripes per read-ahead window, 0 when disabled
+ */
+int nvm_vblk_get_readahead(struct nvm_vblk *vblk);
+
+/**
+ * Enable or disable sequential read-ahead for nvm_vblk_read
+ *
+ * When nvm_vblk_read continues where the previous read ended, the windows
+ * following the read cursor are prefetched, asynchronously, into two pooled
+ * buffers of `nstripes` stripes each. A stripe is a multi-plane page on every
+ * member block, a prefetch thus reads from all LUNs. Subsequent reads are
+ * served from the prefetched windows. Reads elsewhere drop the windows.
+ *
+ * Prefetches are run by a single worker thread of the vblk and stop at the
+ * write cursor, bytes not yet written are read when requested.
+ *
+ * @param vblk The vblk to change
+ * @param nstripes # of stripes per read-ahead window, 0 disables read-ahead
+ *
+ * @returns On success, 0 is returned. On error, -1 is returned and `errno` set
+ * to indicate the error
+ */
+int nvm_vblk_set_readahead(struct nvm_vblk *vblk, int nstripes);
+
 /**
  * Set the read cursor position for the given virtual block
  *
@@ -1221,6 +2157,87 @@ int nvm_vblk_set_pos_read(struct nvm_vblk *vblk, size_t pos);
  */
 int nvm_vblk_set_pos_write(struct nvm_vblk *vblk, size_t pos);
 
+/**
+ * Recover the write cursor position of a partially written virtual block
+ *
+ * Each member block is searched concurrently, using a binary search over its
+ * pages, for the first page not yet written. The write cursor is then
+ * reconstructed from the number of written pages in each member block.
+ * On devices reporting chunk information, see nvm_chunk_get, the number of
+ * written pages is instead derived from the write pointer of each block.
+ *
+ * @note
+ * Assumes the virtual block was written sequentially, that is, by
+ * nvm_vblk_write and/or nvm_vblk_pad. Reads reporting an empty page or a
+ * read-error are both treated as "not written"
+ *
+ * @param vblk The vblk to recover the write cursor for
+ *
+ * @returns On success, the recovered write cursor is returned and set on the
+ * vblk. On error, -1 is returned and `errno` set to indicate the error.
+ */
+ssize_t nvm_vblk_recover_pos(struct nvm_vblk *vblk);
+
+/**
+ * Create an erase-ahead pool
+ *
+ * A worker thread erases the virtual blocks queued with nvm_vblk_eahead_put,
+ * in order, as long as less than `depth` erased virtual blocks are ready
+ *
+ * @param depth Max. # of erased virtual blocks to keep ready
+ * @returns On success, a pointer to the pool is returned. On error, NULL is
+ * returned and `errno` set to indicate the error.
+ */
+struct nvm_vblk_eahead *nvm_vblk_eahead_create(int depth);
+
+/**
+ * Stop the worker thread and destroy the erase-ahead pool, virtual blocks
+ * still held by the pool are freed
+ *
+ * @param ea The pool to destroy
+ */
+void nvm_vblk_eahead_destroy(struct nvm_vblk_eahead *ea);
+
+/**
+ * Queue a virtual block for erase-ahead, the pool owns the virtual block until
+ * it is returned by nvm_vblk_eahead_get or nvm_vblk_eahead_get_failed
+ *
+ * @param ea The erase-ahead pool
+ * @param vblk The virtual block to erase, e.g. from nvm_vblk_alloc_line
+ * @returns On success, 0 is returned. On error, -1 is returned and `errno` set
+ * to indicate the error.
+ */
+int nvm_vblk_eahead_put(struct nvm_vblk_eahead *ea, struct nvm_vblk *vblk);
+
+/**
+ * Retrieve an erased virtual block, in the order they were queued, blocks
+ * until one is erased. Virtual blocks which failed to erase are skipped, see
+ * nvm_vblk_eahead_get_failed.
+ *
+ * @param ea The erase-ahead pool
+ * @returns On success, an erased virtual block with its cursors reset is
+ * returned. On error, NULL is returned and `errno` set to indicate the error,
+ * `ENOENT` when no virtual blocks are queued.
+ */
+struct nvm_vblk *nvm_vblk_eahead_get(struct nvm_vblk_eahead *ea);
+
+/**
+ * Retrieve a virtual block which failed to erase, does not block
+ *
+ * @param ea The erase-ahead pool
+ * @returns On success, the virtual block is returned. On error, NULL is
+ * returned and `errno` set to indicate the error, `ENOENT` when no erase has
+ * failed.
+ */
+struct nvm_vblk *nvm_vblk_eahead_get_failed(struct nvm_vblk_eahead *ea);
+
+/**
+ * Retrieve the number of erased virtual blocks ready in the pool
+ *
+ * @param ea The entity to retrieve information from
+ */
+int nvm_vblk_eahead_nready(struct nvm_vblk_eahead *ea);
+
 /**
  * Print the virtual block in a humanly readable form
  *
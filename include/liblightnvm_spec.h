@@ -91,6 +91,60 @@ enum nvm_spec_12_opcodes {
 	NVM_S12_OPC_READ = 0x92,
 };
 
+/**
+ * The vector reset, write and read of rev. 2.0 share the opcodes of the rev.
+ * 1.2 erase, write and read, however, addresses are in the LBA format, see
+ * `struct nvm_spec_lbaf`, and a reset takes a single address per chunk
+ */
+enum nvm_spec_20_opcodes {
+	NVM_S20_OPC_GET_LOG = 0x02,
+	NVM_S20_OPC_VRESET = 0x90,
+	NVM_S20_OPC_VWRITE = 0x91,
+	NVM_S20_OPC_VREAD = 0x92,
+	NVM_S20_OPC_VCOPY = 0x93,
+};
+
+/**
+ * Log page identifiers
+ */
+enum nvm_spec_20_log {
+	NVM_S20_LOG_CHUNK = 0xCA,	///< Chunk information
+};
+
+/**
+ * Chunk states, as reported in `struct nvm_spec_chunk.cs`
+ */
+enum nvm_spec_20_chunk_state {
+	NVM_S20_CHUNK_FREE = 0x1,	///< Erased, write pointer at zero
+	NVM_S20_CHUNK_CLOSED = 0x2,	///< Fully written
+	NVM_S20_CHUNK_OPEN = 0x4,	///< Partially written
+	NVM_S20_CHUNK_OFFLINE = 0x8,	///< Retired, must not be used
+};
+
+/**
+ * Chunk types, as reported in `struct nvm_spec_chunk.ct`
+ */
+enum nvm_spec_20_chunk_type {
+	NVM_S20_CHUNK_SEQ = 0x1,	///< Must be written sequentially
+	NVM_S20_CHUNK_RAN = 0x2,	///< Allows random writes
+	NVM_S20_CHUNK_DEVIATES = 0x10,	///< Size deviates from geometry
+};
+
+/**
+ * Command completion status codes, as reported in `struct nvm_ret.result`
+ *
+ * The "Do Not Retry" bit is reported separately, mask it off before comparing
+ * with the codes below.
+ */
+enum nvm_spec_12_status {
+	NVM_S12_STATUS_DNR = 0x4000,		///< Do Not Retry
+	NVM_S12_STATUS_FAIL_CRC = 0x0004,	///< Read failed, CRC mismatch
+	NVM_S12_STATUS_FAIL_WRITE = 0x00FF,	///< Write failed
+	NVM_S12_STATUS_FAIL_ECC = 0x0281,	///< Read failed, unrecoverable ECC
+	NVM_S12_STATUS_EMPTY_PAGE = 0x02FF,	///< Read of an unwritten page
+	NVM_S12_STATUS_HIGH_ECC = 0x0700,	///< Read succeeded, high ECC
+};
+
 /**
  * Specification version identifier
  */
@@ -126,11 +180,15 @@ struct nvm_spec_ppaf_nand_mask {
 	};
 };
 
+/**
+ * Rev. 2.0 LBA format, an address is formed by the fields, from the most to
+ * the least significant bits: group, parallel unit, chunk and sector
+ */
 struct nvm_spec_lbaf {
-	uint8_t ch_len;
-	uint8_t lun_len;
-	uint8_t cnk_len;
-	uint8_t sec_len;
+	uint8_t ch_len;			///< Nr. of bits repr. group
+	uint8_t lun_len;		///< Nr. of bits repr. parallel unit
+	uint8_t cnk_len;		///< Nr. of bits repr. chunk
+	uint8_t sec_len;		///< Nr. of bits repr. sector
 	uint8_t rsvd[4];
 };
 
@@ -230,6 +288,19 @@ struct nvm_spec_bbt {
 	uint8_t		blk[];
 };
 
+/**
+ * Chunk descriptor, an entry of the chunk information log page
+ */
+struct nvm_spec_chunk {
+	uint8_t cs;			///< Chunk state
+	uint8_t ct;			///< Chunk type
+	uint8_t wli;			///< Wear-level index
+	uint8_t rsvd_3_7[5];
+	uint64_t slba;			///< Start LBA of the chunk
+	uint64_t cnlb;			///< # of sectors in the chunk
+	uint64_t wp;			///< Write pointer, in sectors
+};
+
 void nvm_spec_identify_pr(const struct nvm_spec_identify *idf);
 
 void nvm_spec_lbaf_pr(const struct nvm_spec_lbaf *lbaf);
@@ -255,4 +326,11 @@ void nvm_spec_ppaf_nand_mask_pr(const struct nvm_spec_ppaf_nand_mask *mask);
  */
 void nvm_spec_bbt_pr(const struct nvm_spec_bbt *bbt);
 
+/**
+ * Prints a humanly readable representation of the given chunk descriptor
+ *
+ * @param chunk The chunk descriptor to print
+ */
+void nvm_spec_chunk_pr(const struct nvm_spec_chunk *chunk);
+
 #endif /* __LIBLIGHTNVM_SPEC_H */
@@ -68,6 +68,11 @@ struct nvm_be {
 	 * Send a vector admin command to device
 	 */
 	int (*vadmin)(struct nvm_dev *, struct nvm_cmd *, struct nvm_ret *);
+
+	/**
+	 * Send a vector passthru command, `vadmin` layout, to the I/O queue
+	 */
+	int (*vio)(struct nvm_dev *, struct nvm_cmd *, struct nvm_ret *);
 };
 
 struct nvm_dev* nvm_be_nosys_open(const char *dev_path, int flags);
@@ -86,6 +91,9 @@ int nvm_be_nosys_vuser(struct nvm_dev *dev, struct nvm_cmd *cmd,
 int nvm_be_nosys_vadmin(struct nvm_dev *dev, struct nvm_cmd *cmd,
 			struct nvm_ret *ret);
 
+int nvm_be_nosys_vio(struct nvm_dev *dev, struct nvm_cmd *cmd,
+		     struct nvm_ret *ret);
+
 /**
  * Splits a dev_path such as "/dev/nvme0n1" into {nvme_name: nvme0, nsid: 1}
  *
@@ -49,4 +49,7 @@ int nvm_be_ioctl_vuser(struct nvm_dev *dev, struct nvm_cmd *cmd,
 int nvm_be_ioctl_vadmin(struct nvm_dev *dev, struct nvm_cmd *cmd,
 			struct nvm_ret *ret);
 
+int nvm_be_ioctl_vio(struct nvm_dev *dev, struct nvm_cmd *cmd,
+		     struct nvm_ret *ret);
+
 #endif /* __INTERNAL_NVM_BE_IOCTL */
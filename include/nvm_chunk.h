@@ -0,0 +1,104 @@
+/*
+ * nvm_chunk - internal header for liblightnvm
+ *
+ * Copyright (C) 2015-2017 Javier Gonzáles <javier@cnexlabs.com>
+ * Copyright (C) 2015-2017 Matias Bjørling <matias@cnexlabs.com>
+ * Copyright (C) 2015-2017 Simon A. F. Lund <slund@cnexlabs.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __INTERNAL_NVM_CHUNK_H
+#define __INTERNAL_NVM_CHUNK_H
+
+#include <pthread.h>
+#include <liblightnvm.h>
+
+/**
+ * Cache of the chunk information log of a device, shared by its partitions
+ *
+ * Descriptors are fetched a parallel unit at a time, on the first lookup of
+ * one of its chunks, and thereafter updated by the resets and writes issued
+ * through the library.
+ */
+struct nvm_chunk_tbl {
+	pthread_mutex_t lock;
+	int nluns;			///< # of LUNs per channel of the device
+	int nchunks;			///< # of chunks per LUN
+	size_t nentries;		///< # of chunks of the device
+	uint8_t *fetched;		///< Indexed by ch * nluns + lun
+	struct nvm_spec_chunk *chunks;	///< Indexed by (ch*nluns+lun)*nchunks+chk
+	struct nvm_chunk_wcache **wcaches;///< Indexed as chunks, NULL when off
+	int nwcaches;			///< # of allocated write caches
+};
+
+/**
+ * Write cache of an open chunk, the last `mw_cunits` sectors written to the
+ * chunk, which the device may not yet be able to read
+ *
+ * Sector `sec` of the chunk is kept in slot `sec % mw_cunits`.
+ */
+struct nvm_chunk_wcache {
+	uint64_t *tags;			///< Sector in a slot plus one, 0 when empty
+	char *data;			///< Data of the slots
+	char *meta;			///< Meta-data of the slots
+};
+
+struct nvm_chunk_tbl *nvm_chunk_tbl_create(const struct nvm_dev *dev);
+
+void nvm_chunk_tbl_destroy(struct nvm_chunk_tbl *tbl);
+
+/**
+ * Apply the outcome of an erase or write of the given addresses to the cache,
+ * `failed` is the mask of the addresses which failed. The parallel units of
+ * failed addresses are fetched anew on their next lookup.
+ *
+ * The write caches of chunks which are reset or fully written are dropped.
+ * Failed writes only drop their own sectors from the cache, the sectors
+ * written before them remain cached, such that the host can read them back
+ * to rewrite them elsewhere.
+ */
+void nvm_chunk_update(struct nvm_dev *dev, struct nvm_addr addrs[],
+		      int naddrs, uint16_t opcode, uint64_t failed);
+
+/**
+ * Enable or disable the write caches of the device, disabling discards the
+ * cached sectors
+ */
+int nvm_chunk_wcache_enable(struct nvm_dev *dev, int enabled);
+
+/**
+ * Keep the given sectors in the write caches of their chunks, called before
+ * the write is issued, see nvm_chunk_update for when the caches are dropped
+ */
+void nvm_chunk_wcache_put(struct nvm_dev *dev, struct nvm_addr addrs[],
+			  int naddrs, const char *data, const char *meta);
+
+/**
+ * Serve the given sectors from the write caches, filling `data` and `meta`
+ * for the addresses found
+ *
+ * @returns The mask of the addresses found
+ */
+uint64_t nvm_chunk_wcache_get(struct nvm_dev *dev, struct nvm_addr addrs[],
+			      int naddrs, char *data, char *meta);
+
+#endif /* __INTERNAL_NVM_CHUNK_H */
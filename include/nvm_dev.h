@@ -39,19 +39,34 @@ struct nvm_dev {
 	uint8_t verid;			///< Open-Channel SSD version identifier
 	struct nvm_spec_ppaf_nand ppaf;	///< Device address format
 	struct nvm_spec_ppaf_nand_mask mask;///< Device address format mask
+	struct nvm_spec_lbaf lbaf;	///< Rev. 2.0 format, zero when not used
 	struct nvm_geo geo;		///< Device geometry
 	uint64_t ssw;			///< Bit-width for LBA fmt conversion
 	uint32_t mccap;			///< Media-controller capabilities
+	uint32_t mw_cunits;		///< Rev. 2.0 # of sectors cached by host
 	int pmode;			///< Default plane-mode I/O
 	int erase_naddrs_max;		///< Maximum # of cmd-addrs. for erase
 	int read_naddrs_max;		///< Maximum # of cmd-addrs. for read
 	int write_naddrs_max;		///< Maximum # of cmd-addrs. for write
+	int nretries;			///< Maximum # of retries of failed addrs.
 	int bbts_cached;		///< Whether to cache bbts
 	size_t nbbts;			///< Number of entries in cache
 	struct nvm_bbt **bbts;		///< Cache of bad-block-tables
 	enum nvm_meta_mode meta_mode;	///< Flag to indicate the how meta is w
+	char *pad_buf;			///< Pre-filled padding of max. cmd-addrs.
+	char *meta_bufs[3];		///< Pre-filled meta by nvm_meta_mode
 	struct nvm_be *be;		///< Backend interface
+	struct nvm_sq *sq;		///< Submission queue, NULL when disabled
+	struct nvm_sched *sched;	///< LUN scheduler, NULL when disabled
+	int io_class;			///< I/O class of commands via the handle
+	struct nvm_qos *qos;		///< I/O class limits, NULL when unlimited
+	struct nvm_load *load;		///< LUN statistics, NULL when disabled
 	int quirks;			///< Mask representing known quirks
+	struct nvm_dev *parent;		///< Partitioned device, NULL when not
+	int ch_off;			///< First channel of partition on device
+	int lun_off;			///< First LUN of partition on device
+	int vcopy;			///< Whether copies are done by the device
+	struct nvm_chunk_tbl *chunks;	///< Chunk information, NULL when not 2.0
 };
 
 #endif /* __INTERNAL_NVM_DEV_H */
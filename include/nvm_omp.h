@@ -33,6 +33,7 @@
 #include <omp.h>
 #else
 #define omp_get_thread_num() 0
+#define omp_get_max_threads() 1
 #endif
 
 #endif /* __NVM_OMP_H */
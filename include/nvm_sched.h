@@ -0,0 +1,171 @@
+/*
+ * nvm_sched - internal header for liblightnvm
+ *
+ * Copyright (C) 2015-2017 Javier Gonzáles <javier@cnexlabs.com>
+ * Copyright (C) 2015-2017 Matias Bjørling <matias@cnexlabs.com>
+ * Copyright (C) 2015-2017 Simon A. F. Lund <slund@cnexlabs.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __INTERNAL_NVM_SCHED_H
+#define __INTERNAL_NVM_SCHED_H
+
+#include <pthread.h>
+#include <time.h>
+#include <liblightnvm.h>
+
+/**
+ * Scheduling classes of waiting commands, in order of priority
+ */
+enum nvm_sched_class {
+	NVM_SCHED_URGENT = 0,		///< Waited past the deadline
+	NVM_SCHED_READ = 1,		///< Reads
+	NVM_SCHED_OTHER = 2,		///< Programs, erases and others
+	NVM_SCHED_NCLASSES = 3
+};
+
+/**
+ * Scheduling state of a parallel unit
+ */
+struct nvm_sched_lun {
+	int inflight;			///< # of commands in flight
+	int nsuspendable;		///< # of those which reads can preempt
+	int nwaiting[NVM_SCHED_NCLASSES];///< # of commands waiting by class
+};
+
+/**
+ * Per-LUN scheduler, commands are admitted to a LUN while it has less than
+ * `inflight_max` commands in flight and no command of a higher class waits
+ * for it. On devices supporting program/erase suspension, programs and
+ * erases are issued suspendable and one read beyond the limit is admitted to
+ * a LUN while they are in flight.
+ */
+struct nvm_sched {
+	int inflight_max;		///< Maximum # of commands in flight per LUN
+	int deadline_us;		///< Wait before becoming urgent, 0 never
+	int suspend;			///< Whether to issue suspendable commands
+	pthread_mutex_t lock;
+	pthread_cond_t cond;		///< Completions and promotions
+	int nluns;			///< # of LUNs, nchannels * nluns
+	struct nvm_sched_lun *luns;	///< Indexed by ch * geo.nluns + lun
+};
+
+/**
+ * Token bucket of an I/O class on a LUN, tokens are allowed to go negative
+ * such that a command larger than the bucket is admitted, subsequent
+ * commands then wait for the debt to be paid
+ */
+struct nvm_qos_bucket {
+	double bytes;			///< Available bytes
+	double cmds;			///< Available commands
+	struct timespec refilled;	///< Time of last refill
+};
+
+/**
+ * Per-LUN token bucket limits of the I/O classes of a device handle
+ */
+struct nvm_qos {
+	pthread_mutex_t lock;
+	uint64_t bytes_per_sec[NVM_IO_NCLASSES];///< Byte limit, 0 for none
+	uint64_t cmds_per_sec[NVM_IO_NCLASSES];	///< Command limit, 0 for none
+	int nluns;			///< # of LUNs, nchannels * nluns
+	struct nvm_qos_bucket *buckets;	///< By lun * NVM_IO_NCLASSES + class
+};
+
+#define NVM_LOAD_NBUCKETS 32		///< Read latency buckets, log2 usec
+#define NVM_LOAD_HIST_WINDOW 1024	///< Histogram halved beyond this
+
+/**
+ * Statistics of a LUN, with the histogram of its read latencies from which
+ * percentiles are estimated
+ */
+struct nvm_load_lun {
+	struct nvm_lun_stats stats;
+	uint32_t hist[NVM_LOAD_NBUCKETS];///< # of reads by log2(usec)
+	uint32_t nhist;			///< # of reads in the histogram
+};
+
+/**
+ * Per-LUN load and latency statistics of a device handle
+ */
+struct nvm_load {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;		///< Wakes the probe when stopped
+	struct nvm_dev *dev;
+	int nluns;			///< # of LUNs, nchannels * nluns
+	struct nvm_load_lun *luns;	///< Indexed by ch * geo.nluns + lun
+	double slow_factor;		///< Outlier threshold, 0 for none
+	int slow_exclude;		///< Whether to exclude outliers
+	int probe_ms;			///< Probe interval, 0 when not probing
+	int probe_blk;			///< Block read by the probe
+	int probe_stop;
+	pthread_t probe;
+};
+
+struct nvm_load *nvm_load_create(struct nvm_dev *dev);
+
+void nvm_load_destroy(struct nvm_load *load);
+
+/**
+ * Snapshot the statistics of all LUNs, estimating read percentiles and
+ * flagging outliers
+ */
+void nvm_load_stats(struct nvm_load *load, struct nvm_lun_stats stats[]);
+
+/**
+ * Start, restart or, with an interval of 0, stop the probe of the LUNs
+ */
+int nvm_load_probe(struct nvm_load *load, int interval_ms, int blk);
+
+struct nvm_qos *nvm_qos_create(const struct nvm_geo *geo);
+
+void nvm_qos_destroy(struct nvm_qos *qos);
+
+/**
+ * Set the I/O class of the commands sent by the calling thread, overriding
+ * the class of the device handle, -1 removes the override
+ *
+ * @returns The previous override
+ */
+int nvm_sched_io_class_set(int io_class);
+
+/**
+ * Returns the I/O class of commands sent by the calling thread via the given
+ * device handle
+ */
+int nvm_sched_io_class_get(const struct nvm_dev *dev);
+
+struct nvm_sched *nvm_sched_create(const struct nvm_dev *dev,
+				   int inflight_max, int deadline_us);
+
+void nvm_sched_destroy(struct nvm_sched *sched);
+
+/**
+ * Send a vector user command, or a vector copy, to the device via its I/O
+ * class limits and its scheduler, accounting its load, or directly to the
+ * backend when none of these are enabled, see nvm_dev_set_io_limit,
+ * nvm_dev_set_sched and nvm_dev_set_lun_stats
+ */
+int nvm_sched_vuser(struct nvm_dev *dev, struct nvm_cmd *cmd,
+		    struct nvm_ret *ret);
+
+#endif /* __INTERNAL_NVM_SCHED_H */
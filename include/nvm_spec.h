@@ -43,4 +43,17 @@ struct nvm_spec_bbt *nvm_spec_bbt_get(struct nvm_dev *dev, struct nvm_addr addr,
 int nvm_spec_bbt_set(struct nvm_dev *dev, struct nvm_addr *addrs,
 		     int naddrs, uint16_t flags, struct nvm_ret *ret);
 
+/**
+ * Construct and execute a LightNVM spec rev. 2.0 get log page command,
+ * retrieving `nchunks` descriptors of the chunk information log, starting with
+ * the descriptor at index `idx`
+ *
+ * The log is ordered by group, then parallel unit, then chunk, i.e. the index
+ * of a chunk is (ch * num_lun + lun) * num_chk + chk
+ *
+ * @returns 0 on success. -1 on error and errno set to indicate the error
+ */
+int nvm_spec_chunk_get(struct nvm_dev *dev, size_t idx, size_t nchunks,
+		       struct nvm_spec_chunk *chunks, struct nvm_ret *ret);
+
 #endif /* __INTERNAL_NVM_SPEC_H */
@@ -0,0 +1,91 @@
+/*
+ * nvm_sq - internal header for liblightnvm
+ *
+ * Copyright (C) 2015-2017 Javier Gonzáles <javier@cnexlabs.com>
+ * Copyright (C) 2015-2017 Matias Bjørling <matias@cnexlabs.com>
+ * Copyright (C) 2015-2017 Simon A. F. Lund <slund@cnexlabs.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __INTERNAL_NVM_SQ_H
+#define __INTERNAL_NVM_SQ_H
+
+#include <pthread.h>
+#include <liblightnvm.h>
+
+/**
+ * A vector command request waiting in the submission queue
+ */
+struct nvm_sq_req {
+	struct nvm_addr *addrs;		///< Addresses of the request
+	int naddrs;			///< # of addresses of the request
+	char *data;			///< Data of the request
+	char *meta;			///< Meta of the request
+	uint16_t flags;			///< Access mode of the request
+	uint16_t opcode;		///< Opcode of the request
+	int io_class;			///< I/O class of the request
+	struct nvm_ret ret;		///< Completion of the request
+	int err;			///< errno of the request, 0 on success
+	int done;			///< Whether the request is completed
+	struct nvm_sq_req *next;	///< Next request in the queue
+};
+
+/**
+ * Submission queue, requests arriving within a window are collected by the
+ * first of them, the leader, and combined into fewer vector commands
+ */
+struct nvm_sq {
+	int flags;			///< Combining, see enum nvm_sq_flags
+	int window_us;			///< Collection window in microseconds
+	pthread_mutex_t lock;
+	pthread_cond_t cond;		///< Arrivals and completions
+	struct nvm_sq_req *head;	///< Queued requests
+	struct nvm_sq_req *tail;
+	int nqueued;			///< # of addresses queued
+	int leader;			///< Whether a leader is collecting
+};
+
+struct nvm_sq *nvm_sq_create(int flags, int window_us);
+
+void nvm_sq_destroy(struct nvm_sq *sq);
+
+/**
+ * Whether the given command is handled by the submission queue
+ */
+int nvm_sq_accepts(struct nvm_sq *sq, uint16_t opcode, int naddrs);
+
+/**
+ * Submit a vector command via the submission queue, blocks until completed
+ */
+ssize_t nvm_sq_submit(struct nvm_dev *dev, struct nvm_addr addrs[], int naddrs,
+		      void *data, void *meta, uint16_t flags, uint16_t opcode,
+		      struct nvm_ret *ret);
+
+/**
+ * Issue a single vector command directly, bypassing the submission queue,
+ * naddrs must be within [1, NVM_NADDR_MAX]
+ */
+ssize_t nvm_addr_cmd_issue(struct nvm_dev *dev, struct nvm_addr addrs[],
+			   int naddrs, void *data, void *meta, uint16_t flags,
+			   uint16_t opcode, struct nvm_ret *ret);
+
+#endif /* __INTERNAL_NVM_SQ_H */
@@ -29,8 +29,91 @@
 #ifndef __INTERNAL_NVM_VBLK_H
 #define __INTERNAL_NVM_VBLK_H
 
+#include <pthread.h>
 #include <liblightnvm.h>
 
+/**
+ * A read-ahead window, filled asynchronously by the read-ahead worker
+ */
+struct nvm_vblk_ra_win {
+	struct nvm_vblk *vblk;	///< Virtual block which the window belongs to
+	char *buf;		///< Content of the window
+	size_t off;		///< Offset of the window within the vblk
+	size_t len;		///< # of bytes in the window, 0 when empty
+	int err;		///< Whether the prefetch failed
+	int pending;		///< Whether the prefetch is queued or running
+};
+
+/**
+ * Read-ahead state of a vblk, see nvm_vblk_set_readahead
+ */
+struct nvm_vblk_ra {
+	struct nvm_vblk_ra_win wins[2];	///< Double-buffered windows
+	int nstripes;			///< # of stripes per window
+	size_t nbytes;			///< # of bytes per window
+	size_t pos_expect;		///< Read cursor of a sequential reader
+	int stop;			///< Whether the worker must stop
+	pthread_mutex_t lock;		///< Protects `pending`, `err` and `stop`
+	pthread_cond_t cond;		///< Queued and completed prefetches
+	pthread_t worker;		///< Prefetches the pending windows
+};
+
+/**
+ * A window of nvm_vblk_copy, read by a thread of its own while the previous
+ * window is written
+ */
+struct nvm_vblk_copy_win {
+	struct nvm_vblk *vblk;	///< Source of the copy
+	const uint8_t *valid;	///< Valid-sector bitmap of the copy, or NULL
+	char *buf;		///< Valid sectors of the window
+	size_t sec;		///< First sector of the window within the vblk
+	size_t bit;		///< Bit of the first sector within `valid`
+	size_t nsecs;		///< # of sectors of the window
+	size_t len;		///< # of bytes read into `buf`
+	int err;		///< Whether the read failed
+	int pending;		///< Whether the read thread is running
+	pthread_t thread;	///< The read thread
+};
+
+/**
+ * States of a hedging slot, see struct nvm_vblk_hedge_slot
+ */
+enum nvm_vblk_hedge_state {
+	NVM_VBLK_HEDGE_IDLE = 0,	///< Free to take a read
+	NVM_VBLK_HEDGE_QUEUED,		///< Read waiting for the worker
+	NVM_VBLK_HEDGE_RUNNING,		///< Read submitted by the worker
+	NVM_VBLK_HEDGE_DONE		///< Read completed, result not yet taken
+};
+
+/**
+ * The member reads of hedged commands on one member block, issued by a worker
+ * of its own, one read at a time
+ */
+struct nvm_vblk_hedge_slot {
+	struct nvm_vblk *vblk;
+	struct nvm_vblk_hedge *hedge;
+	int state;		///< See enum nvm_vblk_hedge_state
+	int abandoned;		///< Whether the command stopped waiting for it
+	uint16_t flags;		///< Access mode of the read
+	ssize_t err;		///< Result of the read
+	char *buf;		///< Read buffer of NVM_NADDR_MAX sectors
+	int naddrs;
+	struct nvm_addr addrs[NVM_NADDR_MAX];
+	pthread_t worker;
+};
+
+/**
+ * Degraded-read hedging state of a vblk with parity, see nvm_vblk_set_hedge
+ */
+struct nvm_vblk_hedge {
+	int threshold_us;	///< Wait before reconstructing, in microseconds
+	int stop;		///< Whether the workers must stop
+	int nslots;
+	struct nvm_vblk_hedge_slot *slots;	///< One per member block
+	pthread_mutex_t lock;	///< Protects the slot states and `stop`
+	pthread_cond_t cond;	///< Queued, completed and released reads
+};
+
 struct nvm_vblk {
 	struct nvm_dev *dev;
 	struct nvm_addr blks[128];
@@ -39,6 +122,49 @@ struct nvm_vblk {
 	size_t pos_write;
 	size_t pos_read;
 	int32_t nthreads;
+	int layout;		///< Striping layout, see enum nvm_vblk_layout
+	int width;		///< # of member blocks per stripe
+	char *wbuf;		///< Write-combining buffer, see nvm_vblk_append
+	size_t wbuf_len;	///< # of appended bytes not yet written
+	struct nvm_vblk_ra *ra;	///< Read-ahead state, NULL when disabled
+	int io_class;		///< I/O class, see enum nvm_io_class
+	int parity;		///< Whether `pblk` holds the XOR of the members
+	struct nvm_addr pblk;	///< Parity block, see nvm_vblk_set_parity
+	struct nvm_vblk_hedge *hedge;	///< NULL when hedging is disabled
+	int chunked;		///< Whether writes follow chunk write pointers
+};
+
+/**
+ * Entry of the erase-ahead queues
+ */
+struct nvm_vblk_eahead_ent {
+	struct nvm_vblk *vblk;
+	struct nvm_vblk_eahead_ent *next;
+};
+
+/**
+ * FIFO of erase-ahead entries
+ */
+struct nvm_vblk_eahead_fifo {
+	struct nvm_vblk_eahead_ent *head;
+	struct nvm_vblk_eahead_ent *tail;
+	int len;
+};
+
+/**
+ * Erase-ahead pool, a worker thread erases the queued vblks while less than
+ * `depth` erased vblks are ready
+ */
+struct nvm_vblk_eahead {
+	struct nvm_vblk_eahead_fifo pending;	///< Queued for erase
+	struct nvm_vblk_eahead_fifo ready;	///< Erased, ready for writers
+	struct nvm_vblk_eahead_fifo failed;	///< Erase failed
+	int erasing;				///< Whether an erase is running
+	int depth;				///< Max. # of erased vblks ready
+	int stop;				///< Whether the worker must stop
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pthread_t worker;
 };
 
 #endif /* __INTERNAL_NVM_VBLK_H */
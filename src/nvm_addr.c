@@ -26,14 +26,26 @@
  * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
+#include <sys/uio.h>
 #include <liblightnvm.h>
 #include <nvm_be.h>
 #include <nvm_dev.h>
+#include <nvm_sq.h>
+#include <nvm_sched.h>
+#include <nvm_chunk.h>
+#include <nvm_omp.h>
 #include <nvm_debug.h>
 #include <nvm_utils.h>
 
+/**
+ * Per-thread arena for the device-formatted address list of a vector command
+ */
+static _Thread_local uint64_t nvm_addr_arena[NVM_NADDR_MAX];
+
 void nvm_ret_pr(const struct nvm_ret *ret)
 {
 	printf("nvm_ret: {");
@@ -91,12 +103,43 @@ int nvm_addr_check(struct nvm_addr addr, const struct nvm_geo *geo)
 	return exceeded;
 }
 
+/**
+ * Sector of the given address within its chunk, the order in which the
+ * sectors of a chunk are written
+ */
+static inline uint64_t nvm_addr_chunk_sec(const struct nvm_geo *geo,
+					  struct nvm_addr addr)
+{
+	return ((uint64_t)addr.g.pg * geo->nplanes + addr.g.pl) *
+		geo->nsectors + addr.g.sec;
+}
+
+static inline uint64_t nvm_addr_lbaf_mask(uint8_t len)
+{
+	return ((uint64_t)1 << len) - 1;
+}
+
 inline uint64_t nvm_addr_gen2dev(struct nvm_dev *dev, struct nvm_addr addr)
 {
+	const struct nvm_spec_lbaf *lbaf = &dev->lbaf;
 	uint64_t d_addr = 0;
 
-	d_addr |= ((uint64_t)addr.g.ch) << dev->ppaf.n.ch_off;
-	d_addr |= ((uint64_t)addr.g.lun) << dev->ppaf.n.lun_off;
+	if (lbaf->sec_len) {		// Rev. 2.0 LBA format
+		const int sec_off = 0;
+		const int cnk_off = sec_off + lbaf->sec_len;
+		const int lun_off = cnk_off + lbaf->cnk_len;
+		const int ch_off = lun_off + lbaf->lun_len;
+
+		d_addr |= ((uint64_t)(addr.g.ch + dev->ch_off)) << ch_off;
+		d_addr |= ((uint64_t)(addr.g.lun + dev->lun_off)) << lun_off;
+		d_addr |= ((uint64_t)addr.g.blk) << cnk_off;
+		d_addr |= nvm_addr_chunk_sec(&dev->geo, addr) << sec_off;
+
+		return d_addr;
+	}
+
+	d_addr |= ((uint64_t)(addr.g.ch + dev->ch_off)) << dev->ppaf.n.ch_off;
+	d_addr |= ((uint64_t)(addr.g.lun + dev->lun_off)) << dev->ppaf.n.lun_off;
 	d_addr |= ((uint64_t)addr.g.pl) << dev->ppaf.n.pl_off;
 	d_addr |= ((uint64_t)addr.g.blk) << dev->ppaf.n.blk_off;
 	d_addr |= ((uint64_t)addr.g.pg) << dev->ppaf.n.pg_off;
@@ -130,8 +173,30 @@ inline struct nvm_addr nvm_addr_dev2gen(struct nvm_dev *dev, uint64_t addr)
 	struct nvm_addr gen;
 
 	gen.ppa = 0;
-	gen.g.ch = (addr & dev->mask.n.ch) >> dev->ppaf.n.ch_off;
-	gen.g.lun |= (addr & dev->mask.n.lun) >> dev->ppaf.n.lun_off;
+
+	if (dev->lbaf.sec_len) {	// Rev. 2.0 LBA format
+		const struct nvm_spec_lbaf *lbaf = &dev->lbaf;
+		const struct nvm_geo *geo = &dev->geo;
+		const int cnk_off = lbaf->sec_len;
+		const int lun_off = cnk_off + lbaf->cnk_len;
+		const int ch_off = lun_off + lbaf->lun_len;
+		const uint64_t sec = addr & nvm_addr_lbaf_mask(lbaf->sec_len);
+
+		gen.g.ch = ((addr >> ch_off) & nvm_addr_lbaf_mask(lbaf->ch_len)) -
+			   dev->ch_off;
+		gen.g.lun = ((addr >> lun_off) &
+			     nvm_addr_lbaf_mask(lbaf->lun_len)) - dev->lun_off;
+		gen.g.blk = (addr >> cnk_off) & nvm_addr_lbaf_mask(lbaf->cnk_len);
+		gen.g.pg = sec / (geo->nplanes * geo->nsectors);
+		gen.g.pl = (sec / geo->nsectors) % geo->nplanes;
+		gen.g.sec = sec % geo->nsectors;
+
+		return gen;
+	}
+
+	gen.g.ch = ((addr & dev->mask.n.ch) >> dev->ppaf.n.ch_off) - dev->ch_off;
+	gen.g.lun |= ((addr & dev->mask.n.lun) >> dev->ppaf.n.lun_off) -
+		     dev->lun_off;
 	gen.g.pl|= (addr & dev->mask.n.pl) >> dev->ppaf.n.pl_off;
 	gen.g.blk |= (addr & dev->mask.n.blk) >> dev->ppaf.n.blk_off;
 	gen.g.pg |= (addr & dev->mask.n.pg) >> dev->ppaf.n.pg_off;
@@ -150,20 +215,26 @@ struct nvm_addr nvm_addr_lba2gen(struct nvm_dev *dev, uint64_t off)
 	return nvm_addr_off2gen(dev, off << NVM_UNIVERSAL_SECT_SH);
 }
 
-static inline ssize_t nvm_addr_cmd(struct nvm_dev *dev, struct nvm_addr addrs[],
-				   int naddrs, void *data, void *meta,
-				   uint16_t flags, uint16_t opcode,
-				   struct nvm_ret *ret)
+/**
+ * Send a single vector command to the device, see nvm_addr_cmd_issue
+ */
+static ssize_t nvm_addr_cmd_dev(struct nvm_dev *dev, struct nvm_addr addrs[],
+				int naddrs, void *data, void *meta,
+				uint16_t flags, uint16_t opcode,
+				struct nvm_ret *ret)
 {
 	struct nvm_cmd cmd = {.cdw={0}};
-	uint64_t dev_addrs[naddrs];
+	uint64_t *dev_addrs = nvm_addr_arena;
 	int i, err;
 
-	if (naddrs > NVM_NADDR_MAX) {
+	if ((naddrs < 1) || (naddrs > NVM_NADDR_MAX)) {
 		errno = EINVAL;
 		return -1;
 	}
 
+	if (dev->lbaf.sec_len)		// Rev. 2.0 has no plane-mode
+		flags &= ~(NVM_FLAG_PMODE_DUAL | NVM_FLAG_PMODE_QUAD);
+
 	cmd.vuser.opcode = opcode;
 	cmd.vuser.control = flags | NVM_FLAG_DEFAULT;
 
@@ -183,7 +254,7 @@ static inline ssize_t nvm_addr_cmd(struct nvm_dev *dev, struct nvm_addr addrs[],
 	cmd.vuser.metadata = (uint64_t)meta;
 	cmd.vuser.metadata_len = meta ? dev->geo.meta_nbytes * naddrs : 0;
 
-	err = dev->be->vuser(dev, &cmd, ret);
+	err = nvm_sched_vuser(dev, &cmd, ret);
 #ifdef NVM_DEBUG_ENABLED
 	if (err || cmd.vuser.result || cmd.vuser.status) {
 		printf("opcode(0x%02x), err(%d), result(%u), status(%lu)\n",
@@ -191,22 +262,626 @@ static inline ssize_t nvm_addr_cmd(struct nvm_dev *dev, struct nvm_addr addrs[],
 		nvm_addr_prn(addrs, naddrs);
 	}
 #endif
-	if (!err)
+	if (!err) {
+		nvm_chunk_update(dev, addrs, naddrs, opcode, 0x0);
 		return 0;		// No errors, we can return
+	}
 
-	switch (cmd.vuser.result) {
-	case 0x700:			// Ignore: Acceptable error
-	case 0x4700:			// Ignore: Acceptable error
+	switch (cmd.vuser.result & ~NVM_S12_STATUS_DNR) {
+	case NVM_S12_STATUS_HIGH_ECC:	// Acceptable, reported via `ret`
+		NVM_DEBUG("high-ECC: result(0x%x), status(0x%016"PRIx64")",
+			  cmd.vuser.result, cmd.vuser.status);
+		nvm_chunk_update(dev, addrs, naddrs, opcode, 0x0);
 		return 0;
 
 	default:
-		return -1;		// Propagate errno from backend
+		break;
+	}
+
+	if (ret && !ret->status) {	// Unknown which failed, mark them all
+		ret->status = naddrs < 64 ? (1ULL << naddrs) - 1 : ~0ULL;
+	}
+	nvm_chunk_update(dev, addrs, naddrs, opcode, ret ? ret->status : ~0ULL);
+
+	return -1;			// Propagate errno from backend
+}
+
+/**
+ * Read the given addresses, serving those held by the write caches of their
+ * chunks from the host, see nvm_dev_set_wcache, and the remainder from the
+ * device
+ */
+static ssize_t nvm_addr_read_wcache(struct nvm_dev *dev,
+				    struct nvm_addr addrs[], int naddrs,
+				    char *data, char *meta, uint16_t flags,
+				    struct nvm_ret *ret)
+{
+	const struct nvm_geo *geo = &dev->geo;
+	const uint64_t found = nvm_chunk_wcache_get(dev, addrs, naddrs, data,
+						    meta);
+	struct nvm_addr maddrs[naddrs];
+	int midx[naddrs];
+	int nmiss = 0;
+	char *mdata = NULL;
+	char *mmeta = NULL;
+	ssize_t err;
+
+	if (!found)
+		return nvm_addr_cmd_dev(dev, addrs, naddrs, data, meta, flags,
+					NVM_S12_OPC_READ, ret);
+
+	for (int i = 0; i < naddrs; ++i) {
+		if ((found >> i) & 0x1)
+			continue;
+
+		midx[nmiss] = i;
+		maddrs[nmiss] = addrs[i];
+		++nmiss;
+	}
+	if (!nmiss)
+		return 0;		// All served by the write caches
+
+	if (data)
+		mdata = nvm_buf_alloc(geo, nmiss * geo->sector_nbytes);
+	if (meta)
+		mmeta = nvm_buf_alloc(geo, nmiss * geo->meta_nbytes);
+	if ((data && !mdata) || (meta && !mmeta)) {
+		nvm_buf_free(mdata);
+		nvm_buf_free(mmeta);
+		errno = ENOMEM;
+		return -1;
+	}
+
+	err = nvm_addr_cmd_dev(dev, maddrs, nmiss, mdata, mmeta, flags,
+			       NVM_S12_OPC_READ, ret);
+	if (!err) {
+		for (int j = 0; j < nmiss; ++j) {
+			if (data)
+				memcpy(data + midx[j] * geo->sector_nbytes,
+				       mdata + j * geo->sector_nbytes,
+				       geo->sector_nbytes);
+			if (meta)
+				memcpy(meta + midx[j] * geo->meta_nbytes,
+				       mmeta + j * geo->meta_nbytes,
+				       geo->meta_nbytes);
+		}
+	} else if (ret) {		// Completion bits of the given addrs
+		const uint64_t status = ret->status;
+
+		ret->status = 0;
+		for (int j = 0; j < nmiss; ++j) {
+			if ((status >> j) & 0x1)
+				ret->status |= 1ULL << midx[j];
+		}
+	}
+
+	nvm_buf_free(mdata);
+	nvm_buf_free(mmeta);
+
+	return err;
+}
+
+ssize_t nvm_addr_cmd_issue(struct nvm_dev *dev, struct nvm_addr addrs[],
+			   int naddrs, void *data, void *meta, uint16_t flags,
+			   uint16_t opcode, struct nvm_ret *ret)
+{
+	if ((naddrs < 1) || (naddrs > NVM_NADDR_MAX)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (dev->chunks) {		// Rev. 2.0, see nvm_dev_set_wcache
+		switch (opcode) {
+		case NVM_S12_OPC_WRITE:
+			nvm_chunk_wcache_put(dev, addrs, naddrs, data, meta);
+			break;
+		case NVM_S12_OPC_READ:
+			return nvm_addr_read_wcache(dev, addrs, naddrs, data,
+						    meta, flags, ret);
+		}
+	}
+
+	return nvm_addr_cmd_dev(dev, addrs, naddrs, data, meta, flags, opcode,
+				ret);
+}
+
+/**
+ * Submit a single vector command, naddrs must be within [1, NVM_NADDR_MAX],
+ * via the submission queue of the device when enabled, see nvm_dev_set_sq
+ */
+static inline ssize_t nvm_addr_cmd_submit(struct nvm_dev *dev,
+					  struct nvm_addr addrs[], int naddrs,
+					  void *data, void *meta,
+					  uint16_t flags, uint16_t opcode,
+					  struct nvm_ret *ret)
+{
+	if (nvm_sq_accepts(dev->sq, opcode, naddrs))
+		return nvm_sq_submit(dev, addrs, naddrs, data, meta, flags,
+				     opcode, ret);
+
+	return nvm_addr_cmd_issue(dev, addrs, naddrs, data, meta, flags,
+				  opcode, ret);
+}
+
+/**
+ * Returns the number of addresses forming the smallest legal command for the
+ * given opcode and plane-mode, that is, a command must consist of whole groups
+ */
+static inline int nvm_addr_cmd_group(struct nvm_dev *dev, uint16_t opcode,
+				     uint16_t flags)
+{
+	const int pmode = flags & (NVM_FLAG_PMODE_DUAL | NVM_FLAG_PMODE_QUAD);
+	int group = pmode ? dev->geo.nplanes : 1;
+
+	if (dev->lbaf.sec_len) {	// Rev. 2.0: units of mw_opt or mw_min
+		const int mw_min = dev->geo.nsectors;
+		const int mw_opt = dev->geo.nplanes * mw_min;
+
+		if (opcode != NVM_S12_OPC_WRITE)
+			return 1;
+
+		return mw_opt <= dev->write_naddrs_max ? mw_opt : mw_min;
+	}
+
+	if (opcode == NVM_S12_OPC_WRITE)
+		group *= dev->geo.nsectors;
+
+	return group;
+}
+
+static inline int nvm_addr_cmd_naddrs_max(struct nvm_dev *dev, uint16_t opcode)
+{
+	switch (opcode) {
+	case NVM_S12_OPC_ERASE:
+		return dev->erase_naddrs_max;
+	case NVM_S12_OPC_WRITE:
+		return dev->write_naddrs_max;
+	case NVM_S12_OPC_READ:
+		return dev->read_naddrs_max;
+
+	default:
+		return NVM_NADDR_MAX;
+	}
+}
+
+static inline int nvm_addr_lun(struct nvm_dev *dev, struct nvm_addr addr)
+{
+	return addr.g.ch * dev->geo.nluns + addr.g.lun;
+}
+
+/**
+ * A piece of a vector command, that is, a range of the address list along
+ * with the data for it
+ */
+struct nvm_addr_piece {
+	int bgn;		///< First address of the piece
+	int naddrs;		///< Number of addresses in the piece
+	char *data;		///< Data for the piece
+	int bounced;		///< Whether `data` is a bounce buffer
+	int next;		///< Next piece in the same lane, or -1
+};
+
+/**
+ * Split the address range [bgn, bgn + naddrs), with contiguous data, into
+ * pieces consisting of whole plane-mode groups of at most the opcode maximum.
+ * Writes are furthermore split at LUN boundaries.
+ *
+ * @returns The number of pieces appended to `pieces`
+ */
+static int nvm_addr_split(struct nvm_dev *dev, struct nvm_addr addrs[],
+			  int bgn, int naddrs, char *data, uint16_t flags,
+			  uint16_t opcode, struct nvm_addr_piece *pieces)
+{
+	const int GROUP = nvm_addr_cmd_group(dev, opcode, flags);
+	const int CMD_NADDRS_MAX = nvm_addr_cmd_naddrs_max(dev, opcode);
+	const int CMD_NADDRS = CMD_NADDRS_MAX < GROUP ? GROUP :
+			       (CMD_NADDRS_MAX / GROUP) * GROUP;
+	const int ORDERED = opcode == NVM_S12_OPC_WRITE;
+	const int end = bgn + naddrs;
+	int npieces = 0;
+
+	for (int i = bgn; i < end; ) {
+		const int lun = nvm_addr_lun(dev, addrs[i]);
+		int j = i + GROUP;
+
+		while ((j < end) && (j - i < CMD_NADDRS)) {
+			if (ORDERED && nvm_addr_lun(dev, addrs[j]) != lun)
+				break;
+			j += GROUP;
+		}
+		j = j < end ? j : end;
+
+		pieces[npieces].bgn = i;
+		pieces[npieces].naddrs = j - i;
+		pieces[npieces].data = data ? data + (i - bgn) * dev->geo.sector_nbytes : NULL;
+		pieces[npieces].bounced = 0;
+		pieces[npieces].next = -1;
+		++npieces;
+
+		i = j;
 	}
+
+	return npieces;
+}
+
+/**
+ * Move the completion bits of a piece to the position of the piece within the
+ * address list of the caller. Bits past 63 cannot be represented, all bits are
+ * then set.
+ */
+static inline uint64_t nvm_addr_status_shift(uint64_t status, int bgn,
+					     int naddrs)
+{
+	if (bgn + naddrs > 64)
+		return ~0ULL;
+
+	return (status & (naddrs < 64 ? (1ULL << naddrs) - 1 : ~0ULL)) << bgn;
+}
+
+/**
+ * Submit the given pieces as individual commands
+ *
+ * Pieces are submitted concurrently, except writes to the same LUN, these are
+ * submitted in order. On error, `ret` is filled with the result of the first
+ * failing piece, and with the completion bits of all failing pieces, along
+ * with those of the pieces skipped after a failure, relative to `addrs`, see
+ * nvm_addr_status_shift.
+ */
+static ssize_t nvm_addr_submit(struct nvm_dev *dev, struct nvm_addr addrs[],
+			       struct nvm_addr_piece *pieces, int npieces,
+			       char *meta, uint16_t flags, uint16_t opcode,
+			       struct nvm_ret *ret)
+{
+	const int ORDERED = opcode == NVM_S12_OPC_WRITE;
+	const int NLUNS = dev->geo.nchannels * dev->geo.nluns;
+	int *lane_head = NULL;		// First piece of each lane
+	int *lane_tail = NULL;		// Last piece of each lane, by LUN
+	int nlanes = 0;
+	int fail = -1;			// First failing piece
+	int fail_errno = 0;
+	struct nvm_ret fail_ret = {0,0};
+	uint64_t fail_status = 0;	// Completion bits relative to `addrs`
+
+	lane_head = malloc(sizeof(*lane_head) * npieces);
+	lane_tail = malloc(sizeof(*lane_tail) * NLUNS);
+	if (!lane_head || !lane_tail) {
+		free(lane_head);
+		free(lane_tail);
+		errno = ENOMEM;
+		return -1;
+	}
+	for (int lun = 0; lun < NLUNS; ++lun)
+		lane_tail[lun] = -1;
+
+	for (int p = 0; p < npieces; ++p) {	// Assign pieces to lanes
+		const int lun = nvm_addr_lun(dev, addrs[pieces[p].bgn]);
+
+		if (ORDERED && (lun < NLUNS) && (lane_tail[lun] >= 0)) {
+			pieces[lane_tail[lun]].next = p;	// Append to lane
+		} else {
+			lane_head[nlanes++] = p;		// Start a lane
+		}
+		if (ORDERED && (lun < NLUNS))
+			lane_tail[lun] = p;
+	}
+
+	const int NTHREADS = nlanes < NLUNS ? nlanes : NLUNS;
+
+	#pragma omp parallel for num_threads(NTHREADS) schedule(dynamic,1) if(NTHREADS>1)
+	for (int lane = 0; lane < nlanes; ++lane) {
+		for (int p = lane_head[lane]; p >= 0; p = pieces[p].next) {
+			const int bgn = pieces[p].bgn;
+			struct nvm_ret piece_ret = {0,0};
+			ssize_t err;
+
+			err = nvm_addr_cmd_submit(dev, addrs + bgn,
+				pieces[p].naddrs, pieces[p].data,
+				meta ? meta + bgn * dev->geo.meta_nbytes : NULL,
+				flags, opcode, &piece_ret);
+			if (!err)
+				continue;
+
+			#pragma omp critical
+			{
+				if ((fail < 0) || (p < fail)) {
+					fail = p;
+					fail_errno = errno;
+					fail_ret = piece_ret;
+				}
+
+				fail_status |= nvm_addr_status_shift(
+					piece_ret.status, bgn,
+					pieces[p].naddrs);
+
+				// Pieces skipped past a failure are not done
+				for (int q = pieces[p].next; q >= 0;
+				     q = pieces[q].next)
+					fail_status |= nvm_addr_status_shift(
+						~0ULL, pieces[q].bgn,
+						pieces[q].naddrs);
+			}
+
+			break;	// Do not continue past a failure within a lane
+		}
+	}
+
+	free(lane_head);
+	free(lane_tail);
+
+	if (fail < 0)
+		return 0;
+
+	if (ret) {
+		*ret = fail_ret;
+		ret->status = fail_status;
+	}
+	errno = fail_errno;
+
+	return -1;
+}
+
+/**
+ * Submit a vector command of arbitrary length, address lists exceeding the
+ * maximum for the opcode are split, see nvm_addr_split and nvm_addr_submit
+ */
+static ssize_t nvm_addr_cmd(struct nvm_dev *dev, struct nvm_addr addrs[],
+			    int naddrs, void *data, void *meta, uint16_t flags,
+			    uint16_t opcode, struct nvm_ret *ret)
+{
+	struct nvm_addr_piece *pieces = NULL;
+	int npieces;
+	ssize_t err;
+
+	if (naddrs < 1) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (naddrs <= nvm_addr_cmd_naddrs_max(dev, opcode))
+		return nvm_addr_cmd_submit(dev, addrs, naddrs, data, meta,
+					   flags, opcode, ret);
+
+	pieces = malloc(sizeof(*pieces) * naddrs);
+	if (!pieces) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	npieces = nvm_addr_split(dev, addrs, 0, naddrs, data, flags, opcode,
+				 pieces);
+	err = nvm_addr_submit(dev, addrs, pieces, npieces, meta, flags, opcode,
+			      ret);
+
+	free(pieces);
+
+	return err;
+}
+
+/**
+ * Copy `nbytes` between `buf` and the io-vector, starting `off` bytes into it
+ */
+static void nvm_addr_iov_copy(const struct iovec *iov, int iovcnt, size_t off,
+			      char *buf, size_t nbytes, int to_iov)
+{
+	for (int seg = 0; (seg < iovcnt) && nbytes; ++seg) {
+		size_t len;
+
+		if (off >= iov[seg].iov_len) {
+			off -= iov[seg].iov_len;
+			continue;
+		}
+
+		len = iov[seg].iov_len - off;
+		len = len < nbytes ? len : nbytes;
+
+		if (to_iov)
+			memcpy((char *)iov[seg].iov_base + off, buf, len);
+		else
+			memcpy(buf, (char *)iov[seg].iov_base + off, len);
+
+		buf += len;
+		nbytes -= len;
+		off = 0;
+	}
+}
+
+/**
+ * Submit a vector command with data given as an io-vector
+ *
+ * Each segment maps onto whole sectors, the data pointer of each command is
+ * set directly into the segment. A plane-mode group straddling two segments
+ * cannot be expressed without copying, such groups go through a bounce buffer.
+ */
+static ssize_t nvm_addr_cmdv(struct nvm_dev *dev, struct nvm_addr addrs[],
+			     int naddrs, const struct iovec *iov, int iovcnt,
+			     void *meta, uint16_t flags, uint16_t opcode,
+			     struct nvm_ret *ret)
+{
+	const size_t SECTOR_NBYTES = dev->geo.sector_nbytes;
+	const int GROUP = nvm_addr_cmd_group(dev, opcode, flags);
+	const int WRITE = opcode == NVM_S12_OPC_WRITE;
+	struct nvm_addr_piece *pieces = NULL;
+	char *bounce = NULL;		// Groups straddling segments
+	int nbounced = 0;
+	int npieces = 0;
+	size_t tbytes = 0;
+	size_t seg_off = 0;
+	int seg = 0;
+	ssize_t err;
+
+	if ((naddrs < 1) || (iovcnt < 1)) {
+		errno = EINVAL;
+		return -1;
+	}
+	for (int i = 0; i < iovcnt; ++i) {	// Check alignment and size
+		if (iov[i].iov_len % SECTOR_NBYTES) {
+			errno = EINVAL;
+			return -1;
+		}
+		tbytes += iov[i].iov_len;
+	}
+	if (tbytes != naddrs * SECTOR_NBYTES) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	pieces = malloc(sizeof(*pieces) * naddrs);
+	if (!pieces) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	for (int i = 0; i < naddrs; ) {
+		size_t avail;
+		int n;
+
+		while (seg_off == iov[seg].iov_len) {	// Skip consumed segments
+			++seg;
+			seg_off = 0;
+		}
+
+		avail = (iov[seg].iov_len - seg_off) / SECTOR_NBYTES;
+		if ((size_t)(naddrs - i) <= avail)
+			n = naddrs - i;
+		else
+			n = (avail / GROUP) * GROUP;
+
+		if (n) {				// Directly in the segment
+			npieces += nvm_addr_split(dev, addrs, i, n,
+						  (char *)iov[seg].iov_base + seg_off,
+						  flags, opcode, pieces + npieces);
+			seg_off += n * SECTOR_NBYTES;
+			i += n;
+			continue;
+		}
+
+		if (!bounce) {				// Straddling group
+			bounce = nvm_buf_alloc(&dev->geo,
+					       iovcnt * GROUP * SECTOR_NBYTES);
+			if (!bounce) {
+				free(pieces);
+				errno = ENOMEM;
+				return -1;
+			}
+		}
+
+		n = GROUP < naddrs - i ? GROUP : naddrs - i;
+
+		pieces[npieces].bgn = i;
+		pieces[npieces].naddrs = n;
+		pieces[npieces].data = bounce + nbounced * GROUP * SECTOR_NBYTES;
+		pieces[npieces].bounced = 1;
+		pieces[npieces].next = -1;
+
+		if (WRITE)
+			nvm_addr_iov_copy(iov, iovcnt, i * SECTOR_NBYTES,
+					  pieces[npieces].data,
+					  n * SECTOR_NBYTES, 0);
+		++npieces;
+		++nbounced;
+
+		for (size_t left = n * SECTOR_NBYTES; left; ) {	// Consume
+			const size_t len = iov[seg].iov_len - seg_off < left ?
+					   iov[seg].iov_len - seg_off : left;
+
+			seg_off += len;
+			left -= len;
+			if (left) {
+				++seg;
+				seg_off = 0;
+			}
+		}
+		i += n;
+	}
+
+	err = nvm_addr_submit(dev, addrs, pieces, npieces, meta, flags, opcode,
+			      ret);
+
+	if (!WRITE && nbounced) {			// Scatter bounced groups
+		for (int p = 0; p < npieces; ++p) {
+			if (!pieces[p].bounced)
+				continue;
+
+			nvm_addr_iov_copy(iov, iovcnt,
+					  pieces[p].bgn * SECTOR_NBYTES,
+					  pieces[p].data,
+					  pieces[p].naddrs * SECTOR_NBYTES, 1);
+		}
+	}
+
+	nvm_buf_free(bounce);
+	free(pieces);
+
+	return err;
+}
+
+/**
+ * Reset the chunks of the given addresses, a rev. 2.0 reset takes a single
+ * address per chunk, thus e.g. the planes of a block collapse into one
+ * address. On error, the completion bits in `ret` are those of the given
+ * addresses.
+ */
+static ssize_t nvm_addr_reset(struct nvm_dev *dev, struct nvm_addr addrs[],
+			      int naddrs, uint16_t flags, struct nvm_ret *ret)
+{
+	struct nvm_addr *chunks;
+	int *map;
+	int nchunks = 0;
+	ssize_t err;
+
+	if (naddrs < 1) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	chunks = malloc(sizeof(*chunks) * naddrs);
+	map = malloc(sizeof(*map) * naddrs);
+	if (!chunks || !map) {
+		free(chunks);
+		free(map);
+		errno = ENOMEM;
+		return -1;
+	}
+
+	for (int i = 0; i < naddrs; ++i) {
+		struct nvm_addr chunk = {.ppa = 0};
+
+		chunk.g.ch = addrs[i].g.ch;
+		chunk.g.lun = addrs[i].g.lun;
+		chunk.g.blk = addrs[i].g.blk;
+
+		map[i] = nchunks - 1;
+		while ((map[i] >= 0) && (chunks[map[i]].ppa != chunk.ppa))
+			--map[i];
+		if (map[i] < 0) {
+			map[i] = nchunks;
+			chunks[nchunks++] = chunk;
+		}
+	}
+
+	err = nvm_addr_cmd(dev, chunks, nchunks, NULL, NULL, flags,
+			   NVM_S12_OPC_ERASE, ret);
+	if (err && ret) {
+		const uint64_t status = ret->status;
+
+		ret->status = 0;
+		for (int i = 0; (i < naddrs) && (i < 64); ++i) {
+			if ((map[i] < 64) && ((status >> map[i]) & 0x1))
+				ret->status |= 1ULL << i;
+		}
+	}
+
+	free(chunks);
+	free(map);
+
+	return err;
 }
 
 ssize_t nvm_addr_erase(struct nvm_dev *dev, struct nvm_addr addrs[], int naddrs,
 		       uint16_t flags, struct nvm_ret *ret)
 {
+	if (dev->lbaf.sec_len)
+		return nvm_addr_reset(dev, addrs, naddrs, flags, ret);
+
 	return nvm_addr_cmd(dev, addrs, naddrs, NULL, NULL, flags,
 			    NVM_S12_OPC_ERASE, ret);
 }
@@ -230,3 +905,287 @@ ssize_t nvm_addr_read(struct nvm_dev *dev, struct nvm_addr addrs[], int naddrs,
 			    NVM_S12_OPC_READ, ret);
 }
 
+/**
+ * Issue a vector copy via the I/O class limits and the scheduler, see
+ * nvm_sched_vuser, the source list is passed in `ppa_list` and the
+ * destination list in `cdw14/15`, both inline for a single address
+ */
+static inline int nvm_addr_vcopy_issue(struct nvm_dev *dev,
+				       struct nvm_addr src[],
+				       struct nvm_addr dst[], int naddrs,
+				       uint16_t flags, struct nvm_ret *ret)
+{
+	struct nvm_cmd cmd = {.cdw={0}};
+	uint64_t src_dev[NVM_NADDR_MAX];
+	uint64_t dst_dev[NVM_NADDR_MAX];
+	uint64_t dst_list;
+	int err;
+
+	for (int i = 0; i < naddrs; ++i) {
+		src_dev[i] = nvm_addr_gen2dev(dev, src[i]);
+		dst_dev[i] = nvm_addr_gen2dev(dev, dst[i]);
+	}
+	dst_list = naddrs == 1 ? dst_dev[0] : (uint64_t)dst_dev;
+
+	cmd.vadmin.opcode = NVM_S20_OPC_VCOPY;
+	cmd.vadmin.control = flags | NVM_FLAG_DEFAULT;
+	cmd.vadmin.nppas = naddrs - 1;
+	cmd.vadmin.ppa_list = naddrs == 1 ? src_dev[0] : (uint64_t)src_dev;
+	cmd.vadmin.cdw14 = dst_list & 0xFFFFFFFF;
+	cmd.vadmin.cdw15 = dst_list >> 32;
+
+	err = nvm_sched_vuser(dev, &cmd, ret);
+	if (err && !ret->status)	// Unknown which failed, mark them all
+		ret->status = naddrs < 64 ? (1ULL << naddrs) - 1 : ~0ULL;
+
+	nvm_chunk_update(dev, dst, naddrs, NVM_S12_OPC_WRITE,
+			 err ? ret->status : 0x0);
+
+	return err;
+}
+
+/**
+ * Whether `addr` is sector `k` of a write unit starting at `first`, that is,
+ * `first` is at a multiple of `nsectors` within its chunk and `addr` is the
+ * k'th sector of the chunk following it
+ */
+static inline int nvm_addr_vcopy_unit(const struct nvm_geo *geo,
+				      struct nvm_addr first,
+				      struct nvm_addr addr, int k)
+{
+	const uint64_t sec = ((uint64_t)first.g.pg * geo->nplanes +
+			      first.g.pl) * geo->nsectors + first.g.sec;
+
+	if ((addr.g.ch != first.g.ch) || (addr.g.lun != first.g.lun) ||
+	    (addr.g.blk != first.g.blk) || (sec % geo->nsectors))
+		return 0;
+
+	return ((uint64_t)addr.g.pg * geo->nplanes + addr.g.pl) *
+	       geo->nsectors + addr.g.sec == sec + k;
+}
+
+/**
+ * Copy the sectors by the device, the LUNs of the destination in parallel and
+ * the sectors of each LUN in order, in vector copies of whole write units of
+ * `nsectors` sectors. A LUN stops at its first failure, or at the first
+ * sectors not forming a write unit. A rejection other than EIO disables the
+ * offload, see nvm_dev_get_vcopy.
+ *
+ * @returns The # of sectors not copied, these are flagged in `todo`, or -1
+ * and errno set on error
+ */
+static int nvm_addr_vcopy(struct nvm_dev *dev, struct nvm_addr src[],
+			  struct nvm_addr dst[], int naddrs, uint16_t flags,
+			  uint8_t todo[])
+{
+	const int NLUNS = dev->geo.nchannels * dev->geo.nluns;
+	const int UNIT = dev->geo.nsectors;
+	const int CMD_NADDRS = (NVM_NADDR_MAX / UNIT) * UNIT;
+	int *next = NULL;		// Next sector of the same LUN
+	int *lane_head = NULL;		// First sector of each lane
+	int *lane_tail = NULL;		// Last sector of each lane, by LUN
+	int nlanes = 0;
+	int nleft = 0;
+	int reject = 0;
+
+	next = malloc(sizeof(*next) * naddrs);
+	lane_head = malloc(sizeof(*lane_head) * naddrs);
+	lane_tail = malloc(sizeof(*lane_tail) * NLUNS);
+	if (!next || !lane_head || !lane_tail) {
+		free(next);
+		free(lane_head);
+		free(lane_tail);
+		errno = ENOMEM;
+		return -1;
+	}
+	for (int lun = 0; lun < NLUNS; ++lun)
+		lane_tail[lun] = -1;
+
+	for (int i = 0; i < naddrs; ++i) {	// Assign sectors to lanes
+		const int lun = nvm_addr_lun(dev, dst[i]);
+
+		next[i] = -1;
+		todo[i] = 1;
+		if ((lun < NLUNS) && (lane_tail[lun] >= 0)) {
+			next[lane_tail[lun]] = i;
+		} else {
+			lane_head[nlanes++] = i;
+		}
+		if (lun < NLUNS)
+			lane_tail[lun] = i;
+	}
+
+	const int NTHREADS = nlanes < NLUNS ? nlanes : NLUNS;
+
+	#pragma omp parallel for num_threads(NTHREADS) schedule(dynamic,1) if(NTHREADS>1)
+	for (int lane = 0; lane < nlanes; ++lane) {
+		int i = lane_head[lane];
+
+		while (i >= 0) {
+			struct nvm_addr csrc[NVM_NADDR_MAX];
+			struct nvm_addr cdst[NVM_NADDR_MAX];
+			int cidx[NVM_NADDR_MAX];
+			struct nvm_ret vret = {0,0};
+			int n = 0;
+
+			while ((i >= 0) && (n + UNIT <= CMD_NADDRS)) {
+				int j = i, k;
+
+				for (k = 0; (k < UNIT) && (j >= 0) &&
+				     nvm_addr_vcopy_unit(&dev->geo, dst[i],
+							 dst[j], k); ++k)
+					j = next[j];
+				if (k < UNIT)
+					break;		// Not a write unit
+
+				for (k = 0; k < UNIT; ++k, i = next[i]) {
+					csrc[n] = src[i];
+					cdst[n] = dst[i];
+					cidx[n++] = i;
+				}
+			}
+			if (!n)
+				break;			// The rest via the host
+
+			if (!nvm_addr_vcopy_issue(dev, csrc, cdst, n, flags,
+						  &vret)) {
+				for (int k = 0; k < n; ++k)
+					todo[cidx[k]] = 0;
+				continue;
+			}
+
+			if (errno != EIO) {
+				#pragma omp atomic write
+				reject = 1;
+			}
+			for (int k = 0; k < n; ++k) {	// Copied before failing
+				if (!((vret.status >> k) & 0x1))
+					todo[cidx[k]] = 0;
+			}
+			break;			// The rest via the host
+		}
+	}
+
+	for (int i = 0; i < naddrs; ++i)
+		nleft += todo[i];
+
+	if (reject) {			// Not supported by the backend
+		NVM_DEBUG("vcopy: rejected, copying via the host");
+		dev->vcopy = 0;
+	}
+
+	free(next);
+	free(lane_head);
+	free(lane_tail);
+
+	return nleft;
+}
+
+ssize_t nvm_addr_copy(struct nvm_dev *dev, struct nvm_addr src[],
+		      struct nvm_addr dst[], int naddrs, uint16_t flags,
+		      struct nvm_ret *ret)
+{
+	const struct nvm_geo *geo = &dev->geo;
+	char *data = NULL, *meta = NULL;
+	uint8_t *todo = NULL;		// Sectors left to the host
+	int *idx = NULL;		// Position of host sectors in the list
+	struct nvm_addr *hsrc = src, *hdst = dst;
+	int nhost = naddrs;
+	ssize_t err = 0;
+
+	if (naddrs < 1) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (dev->vcopy) {
+		todo = malloc(naddrs);
+		if (!todo) {
+			errno = ENOMEM;
+			return -1;
+		}
+
+		nhost = nvm_addr_vcopy(dev, src, dst, naddrs, flags, todo);
+		if (nhost <= 0) {
+			free(todo);
+			return nhost;		// Propagate errno
+		}
+	}
+
+	// Copy the remaining sectors via the host, in list order
+	data = nvm_buf_alloc(geo, NVM_NADDR_MAX * geo->sector_nbytes);
+	if (geo->meta_nbytes)
+		meta = nvm_buf_alloc(geo, NVM_NADDR_MAX * geo->meta_nbytes);
+	if (todo) {
+		hsrc = malloc(sizeof(*hsrc) * nhost);
+		hdst = malloc(sizeof(*hdst) * nhost);
+		idx = malloc(sizeof(*idx) * nhost);
+	}
+	if (!data || (geo->meta_nbytes && !meta) ||
+	    (todo && (!hsrc || !hdst || !idx))) {
+		err = -1;
+		errno = ENOMEM;
+		goto exit;
+	}
+
+	for (int i = 0, n = 0; todo && (i < naddrs); ++i) {
+		if (!todo[i])
+			continue;
+
+		hsrc[n] = src[i];
+		hdst[n] = dst[i];
+		idx[n++] = i;
+	}
+
+	for (int bgn = 0; !err && (bgn < nhost); bgn += NVM_NADDR_MAX) {
+		const int n = nhost - bgn < NVM_NADDR_MAX ? nhost - bgn :
+							    NVM_NADDR_MAX;
+		uint64_t status;
+
+		err = nvm_addr_read(dev, hsrc + bgn, n, data, meta, flags, ret);
+		if (!err)
+			err = nvm_addr_write(dev, hdst + bgn, n, data, meta,
+					     flags, ret);
+		if (!err || !ret)
+			continue;
+
+		status = ret->status;		// Relative to the caller's list
+		ret->status = 0;
+		for (int j = 0; j < n; ++j) {
+			const int pos = idx ? idx[bgn + j] : bgn + j;
+
+			if (!((status >> j) & 0x1))
+				continue;
+
+			ret->status |= nvm_addr_status_shift(0x1, pos, 1);
+		}
+	}
+
+exit:
+	if (todo) {
+		free(hsrc);
+		free(hdst);
+	}
+	free(idx);
+	free(todo);
+	nvm_buf_free(data);
+	nvm_buf_free(meta);
+
+	return err;				// Propagate errno
+}
+
+ssize_t nvm_addr_writev(struct nvm_dev *dev, struct nvm_addr addrs[],
+			int naddrs, const struct iovec *iov, int iovcnt,
+			const void *meta, uint16_t flags, struct nvm_ret *ret)
+{
+	return nvm_addr_cmdv(dev, addrs, naddrs, iov, iovcnt, (void *)meta,
+			     flags, NVM_S12_OPC_WRITE, ret);
+}
+
+ssize_t nvm_addr_readv(struct nvm_dev *dev, struct nvm_addr addrs[],
+		       int naddrs, const struct iovec *iov, int iovcnt,
+		       void *meta, uint16_t flags, struct nvm_ret *ret)
+{
+	return nvm_addr_cmdv(dev, addrs, naddrs, iov, iovcnt, meta, flags,
+			     NVM_S12_OPC_READ, ret);
+}
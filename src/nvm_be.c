@@ -108,6 +108,15 @@ int nvm_be_nosys_vadmin(struct nvm_dev *NVM_UNUSED(dev),
 	return -1;
 }
 
+int nvm_be_nosys_vio(struct nvm_dev *NVM_UNUSED(dev),
+		     struct nvm_cmd *NVM_UNUSED(cmd),
+		     struct nvm_ret *NVM_UNUSED(ret))
+{
+	NVM_DEBUG("nvm_be_nosys_vio");
+	errno = ENOSYS;
+	return -1;
+}
+
 int nvm_be_split_dpath(const char *dev_path, char *nvme_name, int *nsid)
 {
 	const char prefix[] = "/dev/nvme";
@@ -244,7 +253,9 @@ int nvm_be_populate(struct nvm_dev *dev,
 		geo->nsectors = geo->page_nbytes / geo->sector_nbytes;
 
 		dev->ppaf = idf->s20.ppaf;
+		dev->lbaf = idf->s20.lbaf;
 		dev->mccap = idf->s20.mccap;
+		dev->mw_cunits = idf->s20.mw_cunits;
 		break;
 
 	default:
@@ -354,6 +365,8 @@ int nvm_be_populate_derived(struct nvm_dev *dev)
 	dev->write_naddrs_max = NVM_NADDR_MAX;
 	dev->read_naddrs_max = NVM_NADDR_MAX;
 
+	dev->nretries = 2;
+
 	dev->meta_mode = NVM_META_MODE_NONE;
 
 	nvm_be_quirks(dev);
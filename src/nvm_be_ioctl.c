@@ -40,7 +40,8 @@ struct nvm_be nvm_be_ioctl = {
 	.admin = nvm_be_nosys_admin,
 
 	.vuser = nvm_be_nosys_vuser,
-	.vadmin = nvm_be_nosys_vadmin
+	.vadmin = nvm_be_nosys_vadmin,
+	.vio = nvm_be_nosys_vio
 };
 #else
 #define _GNU_SOURCE
@@ -99,6 +100,27 @@ int nvm_be_ioctl_vadmin(struct nvm_dev *dev, struct nvm_cmd *cmd,
 	return 0;
 }
 
+int nvm_be_ioctl_vio(struct nvm_dev *dev, struct nvm_cmd *cmd,
+		     struct nvm_ret *ret)
+{
+	const int err = ioctl(dev->fd, NVME_NVM_IOCTL_IO_VIO, cmd);
+
+	if (ret) {
+		ret->result = cmd->vadmin.result;
+		ret->status = cmd->vadmin.status;
+	}
+
+	if (err == -1)
+		return err;		// Propagate errno from IOCTL error
+
+	if (cmd->vadmin.result) {	// Construct errno on cmd error
+		errno = EIO;
+		return -1;
+	}
+
+	return 0;
+}
+
 int nvm_be_ioctl_user(struct nvm_dev *dev, struct nvm_cmd *cmd,
 		      struct nvm_ret *ret)
 {
@@ -207,6 +229,7 @@ struct nvm_be nvm_be_ioctl = {
 
 	.vuser = nvm_be_ioctl_vuser,
 	.vadmin = nvm_be_ioctl_vadmin,
+	.vio = nvm_be_ioctl_vio,
 };
 #endif
 
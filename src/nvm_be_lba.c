@@ -40,7 +40,8 @@ struct nvm_be nvm_be_lba = {
 	.admin = nvm_be_nosys_admin,
 
 	.vuser = nvm_be_nosys_vuser,
-	.vadmin = nvm_be_nosys_vadmin
+	.vadmin = nvm_be_nosys_vadmin,
+	.vio = nvm_be_nosys_vio
 };
 #else
 #include <stdlib.h>
@@ -103,8 +104,14 @@ int nvm_be_lba_vuser(struct nvm_dev *dev, struct nvm_cmd *cmd,
 			return -1;
 		}
 
-		if (res < 0)
+		if (res < 0) {		// Mark this and remaining as failed
+			if (ret) {
+				ret->status = ~0ULL << i;
+				if (cmd->vuser.nppas < 63)
+					ret->status &= (1ULL << (cmd->vuser.nppas + 1)) - 1;
+			}
 			return -1;
+		}
 	}
 
 	return 0;
@@ -125,7 +132,8 @@ struct nvm_be nvm_be_lba = {
 	.admin = nvm_be_ioctl_admin,
 
 	.vuser = nvm_be_lba_vuser,
-	.vadmin = nvm_be_ioctl_vadmin
+	.vadmin = nvm_be_ioctl_vadmin,
+	.vio = nvm_be_nosys_vio
 };
 #endif
 
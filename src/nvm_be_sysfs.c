@@ -39,7 +39,8 @@ struct nvm_be nvm_be_sysfs = {
 	.admin = nvm_be_nosys_admin,
 
 	.vuser = nvm_be_nosys_vuser,
-	.vadmin = nvm_be_nosys_vadmin
+	.vadmin = nvm_be_nosys_vadmin,
+	.vio = nvm_be_nosys_vio
 };
 #else
 #define _GNU_SOURCE
@@ -239,7 +240,7 @@ struct nvm_dev *nvm_be_sysfs_open(const char *dev_path, int flags)
 		return NULL;
 	}
 
-	dev = malloc(sizeof(*dev));
+	dev = calloc(1, sizeof(*dev));
 	if (!dev) {
 		NVM_DEBUG("FAILED: allocating 'struct nvm_dev'\n");
 		return NULL;	// Propagate errno from malloc
@@ -293,7 +294,8 @@ struct nvm_be nvm_be_sysfs = {
 	.admin = nvm_be_ioctl_admin,
 
 	.vuser = nvm_be_ioctl_vuser,
-	.vadmin = nvm_be_ioctl_vadmin
+	.vadmin = nvm_be_ioctl_vadmin,
+	.vio = nvm_be_ioctl_vio
 };
 #endif
 
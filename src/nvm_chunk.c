@@ -0,0 +1,391 @@
+/*
+ * nvm_chunk - chunk information cache for liblightnvm
+ *
+ * Copyright (C) 2015-2017 Javier Gonzáles <javier@cnexlabs.com>
+ * Copyright (C) 2015-2017 Matias Bjørling <matias@cnexlabs.com>
+ * Copyright (C) 2015-2017 Simon A. F. Lund <slund@cnexlabs.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <liblightnvm.h>
+#include <liblightnvm_spec.h>
+#include <nvm_dev.h>
+#include <nvm_spec.h>
+#include <nvm_chunk.h>
+#include <nvm_debug.h>
+
+struct nvm_chunk_tbl *nvm_chunk_tbl_create(const struct nvm_dev *dev)
+{
+	const struct nvm_geo *geo = &dev->geo;
+	const int npus = geo->nchannels * geo->nluns;
+	struct nvm_chunk_tbl *tbl;
+
+	tbl = calloc(1, sizeof(*tbl));
+	if (!tbl) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	tbl->nluns = geo->nluns;
+	tbl->nchunks = geo->nblocks;
+	tbl->nentries = (size_t)npus * tbl->nchunks;
+	tbl->fetched = calloc(npus, sizeof(*tbl->fetched));
+	tbl->chunks = calloc(tbl->nentries, sizeof(*tbl->chunks));
+	if (!tbl->fetched || !tbl->chunks) {
+		NVM_DEBUG("FAILED: calloc chunks");
+		nvm_chunk_tbl_destroy(tbl);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	pthread_mutex_init(&tbl->lock, NULL);
+
+	return tbl;
+}
+
+static void _wcache_free(struct nvm_chunk_tbl *tbl, size_t idx)
+{
+	if (!tbl->wcaches[idx])
+		return;
+
+	free(tbl->wcaches[idx]);
+	tbl->wcaches[idx] = NULL;
+	--(tbl->nwcaches);
+}
+
+static void _wcache_free_all(struct nvm_chunk_tbl *tbl)
+{
+	for (size_t idx = 0; tbl->nwcaches && (idx < tbl->nentries); ++idx)
+		_wcache_free(tbl, idx);
+
+	free(tbl->wcaches);
+	tbl->wcaches = NULL;
+}
+
+void nvm_chunk_tbl_destroy(struct nvm_chunk_tbl *tbl)
+{
+	if (!tbl)
+		return;
+
+	if (tbl->fetched && tbl->chunks)
+		pthread_mutex_destroy(&tbl->lock);
+
+	if (tbl->wcaches)
+		_wcache_free_all(tbl);
+
+	free(tbl->fetched);
+	free(tbl->chunks);
+	free(tbl);
+}
+
+/**
+ * Index of the parallel unit of the given partition address on the device
+ */
+static inline int _chunk_pu(const struct nvm_dev *dev, struct nvm_addr addr)
+{
+	return (addr.g.ch + dev->ch_off) * dev->chunks->nluns +
+		addr.g.lun + dev->lun_off;
+}
+
+static inline size_t _chunk_idx(const struct nvm_dev *dev,
+				struct nvm_addr addr)
+{
+	return (size_t)_chunk_pu(dev, addr) * dev->chunks->nchunks +
+		addr.g.blk;
+}
+
+/**
+ * Sector of the given address within its chunk, in write order
+ */
+static inline uint64_t _chunk_sec(const struct nvm_geo *geo,
+				  struct nvm_addr addr)
+{
+	return ((uint64_t)addr.g.pg * geo->nplanes + addr.g.pl) *
+		geo->nsectors + addr.g.sec;
+}
+
+static inline uint64_t _chunk_nsecs(const struct nvm_geo *geo)
+{
+	return (uint64_t)geo->npages * geo->nplanes * geo->nsectors;
+}
+
+/**
+ * Fetch the descriptors of all chunks of the given parallel unit, caller must
+ * hold the lock
+ */
+static int _chunk_fetch(struct nvm_dev *dev, int pu, struct nvm_ret *ret)
+{
+	struct nvm_chunk_tbl *tbl = dev->chunks;
+	const size_t idx = (size_t)pu * tbl->nchunks;
+
+	if (nvm_spec_chunk_get(dev, idx, tbl->nchunks, &tbl->chunks[idx], ret))
+		return -1;			// Propagate errno
+
+	tbl->fetched[pu] = 1;
+
+	return 0;
+}
+
+static int _chunk_check(struct nvm_dev *dev, struct nvm_addr addr)
+{
+	if (!dev->chunks) {
+		errno = ENOSYS;
+		return -1;
+	}
+	if ((addr.g.ch >= dev->geo.nchannels) ||
+	    (addr.g.lun >= dev->geo.nluns) ||
+	    (addr.g.blk >= dev->geo.nblocks)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
+
+int nvm_chunk_get(struct nvm_dev *dev, struct nvm_addr addr,
+		  struct nvm_spec_chunk *chunk, struct nvm_ret *ret)
+{
+	struct nvm_chunk_tbl *tbl;
+	int pu, err = 0;
+
+	if (!dev || !chunk) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (_chunk_check(dev, addr))
+		return -1;
+
+	tbl = dev->chunks;
+	pu = _chunk_pu(dev, addr);
+
+	pthread_mutex_lock(&tbl->lock);
+	if (!tbl->fetched[pu])
+		err = _chunk_fetch(dev, pu, ret);
+	if (!err)
+		*chunk = tbl->chunks[_chunk_idx(dev, addr)];
+	pthread_mutex_unlock(&tbl->lock);
+
+	return err;
+}
+
+int nvm_chunk_refresh(struct nvm_dev *dev, struct nvm_addr addr,
+		      struct nvm_ret *ret)
+{
+	struct nvm_chunk_tbl *tbl;
+	int pu, err;
+
+	if (!dev) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (_chunk_check(dev, addr))
+		return -1;
+
+	tbl = dev->chunks;
+	pu = _chunk_pu(dev, addr);
+
+	pthread_mutex_lock(&tbl->lock);
+	err = _chunk_fetch(dev, pu, ret);
+	pthread_mutex_unlock(&tbl->lock);
+
+	return err;
+}
+
+void nvm_chunk_update(struct nvm_dev *dev, struct nvm_addr addrs[],
+		      int naddrs, uint16_t opcode, uint64_t failed)
+{
+	struct nvm_chunk_tbl *tbl = dev->chunks;
+	const struct nvm_geo *geo = &dev->geo;
+
+	if (!tbl)
+		return;
+
+	switch (opcode) {
+	case NVM_S12_OPC_ERASE:
+	case NVM_S12_OPC_WRITE:
+		break;
+
+	default:
+		return;
+	}
+
+	pthread_mutex_lock(&tbl->lock);
+	for (int i = 0; i < naddrs; ++i) {
+		const int pu = _chunk_pu(dev, addrs[i]);
+		const size_t idx = _chunk_idx(dev, addrs[i]);
+		const int fail = (failed >> i) & 0x1;
+		const uint64_t sec = _chunk_sec(geo, addrs[i]);
+		struct nvm_spec_chunk *chunk = &tbl->chunks[idx];
+
+		if (tbl->wcaches && tbl->wcaches[idx]) {
+			struct nvm_chunk_wcache *wc = tbl->wcaches[idx];
+			const size_t slot = sec % dev->mw_cunits;
+
+			if ((opcode == NVM_S12_OPC_ERASE) ||
+			    (!fail && (sec + 1 == _chunk_nsecs(geo))))
+				_wcache_free(tbl, idx);
+			else if (fail && (wc->tags[slot] == sec + 1))
+				wc->tags[slot] = 0;	// Not on the media
+		}
+
+		if (!tbl->fetched[pu])		// Up-to-date when fetched
+			continue;
+
+		if (fail) {			// Unknown state, fetch it anew
+			tbl->fetched[pu] = 0;
+			continue;
+		}
+
+		if (opcode == NVM_S12_OPC_ERASE) {
+			chunk->cs = NVM_S20_CHUNK_FREE;
+			chunk->wp = 0;
+			continue;
+		}
+
+		if (sec >= chunk->wp)
+			chunk->wp = sec + 1;
+		chunk->cs = chunk->wp < chunk->cnlb ? NVM_S20_CHUNK_OPEN :
+						      NVM_S20_CHUNK_CLOSED;
+	}
+	pthread_mutex_unlock(&tbl->lock);
+}
+
+int nvm_chunk_wcache_enable(struct nvm_dev *dev, int enabled)
+{
+	struct nvm_chunk_tbl *tbl = dev->chunks;
+	int err = 0;
+
+	if (!tbl || !dev->mw_cunits) {
+		errno = ENOSYS;
+		return -1;
+	}
+
+	pthread_mutex_lock(&tbl->lock);
+	if (!enabled && tbl->wcaches) {
+		_wcache_free_all(tbl);
+	} else if (enabled && !tbl->wcaches) {
+		tbl->wcaches = calloc(tbl->nentries, sizeof(*tbl->wcaches));
+		if (!tbl->wcaches) {
+			errno = ENOMEM;
+			err = -1;
+		}
+	}
+	pthread_mutex_unlock(&tbl->lock);
+
+	return err;
+}
+
+static struct nvm_chunk_wcache *_wcache_alloc(const struct nvm_dev *dev)
+{
+	const struct nvm_geo *geo = &dev->geo;
+	const size_t nslots = dev->mw_cunits;
+	struct nvm_chunk_wcache *wc;
+
+	wc = calloc(1, sizeof(*wc) + nslots * (sizeof(*wc->tags) +
+		    geo->sector_nbytes + geo->meta_nbytes));
+	if (!wc)
+		return NULL;
+
+	wc->tags = (uint64_t *)(wc + 1);
+	wc->data = (char *)(wc->tags + nslots);
+	wc->meta = wc->data + nslots * geo->sector_nbytes;
+
+	return wc;
+}
+
+void nvm_chunk_wcache_put(struct nvm_dev *dev, struct nvm_addr addrs[],
+			  int naddrs, const char *data, const char *meta)
+{
+	struct nvm_chunk_tbl *tbl = dev->chunks;
+	const struct nvm_geo *geo = &dev->geo;
+
+	if (!tbl || !data)
+		return;
+
+	pthread_mutex_lock(&tbl->lock);
+	for (int i = 0; tbl->wcaches && (i < naddrs); ++i) {
+		const size_t idx = _chunk_idx(dev, addrs[i]);
+		const uint64_t sec = _chunk_sec(geo, addrs[i]);
+		const size_t slot = sec % dev->mw_cunits;
+		struct nvm_chunk_wcache *wc = tbl->wcaches[idx];
+
+		if (!wc) {
+			wc = _wcache_alloc(dev);
+			if (!wc) {
+				NVM_DEBUG("FAILED: _wcache_alloc");
+				continue;	// Reads go to the device
+			}
+			tbl->wcaches[idx] = wc;
+			++(tbl->nwcaches);
+		}
+
+		wc->tags[slot] = sec + 1;
+		memcpy(wc->data + slot * geo->sector_nbytes,
+		       data + i * geo->sector_nbytes, geo->sector_nbytes);
+		if (meta)
+			memcpy(wc->meta + slot * geo->meta_nbytes,
+			       meta + i * geo->meta_nbytes, geo->meta_nbytes);
+		else
+			memset(wc->meta + slot * geo->meta_nbytes, 0,
+			       geo->meta_nbytes);
+	}
+	pthread_mutex_unlock(&tbl->lock);
+}
+
+uint64_t nvm_chunk_wcache_get(struct nvm_dev *dev, struct nvm_addr addrs[],
+			      int naddrs, char *data, char *meta)
+{
+	struct nvm_chunk_tbl *tbl = dev->chunks;
+	const struct nvm_geo *geo = &dev->geo;
+	uint64_t found = 0;
+
+	if (!tbl)
+		return 0;
+
+	pthread_mutex_lock(&tbl->lock);
+	for (int i = 0; tbl->nwcaches && (i < naddrs) && (i < 64); ++i) {
+		const size_t idx = _chunk_idx(dev, addrs[i]);
+		const uint64_t sec = _chunk_sec(geo, addrs[i]);
+		const size_t slot = sec % dev->mw_cunits;
+		const struct nvm_chunk_wcache *wc = tbl->wcaches[idx];
+
+		if (!wc || (wc->tags[slot] != sec + 1))
+			continue;
+
+		if (data)
+			memcpy(data + i * geo->sector_nbytes,
+			       wc->data + slot * geo->sector_nbytes,
+			       geo->sector_nbytes);
+		if (meta)
+			memcpy(meta + i * geo->meta_nbytes,
+			       wc->meta + slot * geo->meta_nbytes,
+			       geo->meta_nbytes);
+
+		found |= 1ULL << i;
+	}
+	pthread_mutex_unlock(&tbl->lock);
+
+	return found;
+}
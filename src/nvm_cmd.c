@@ -31,11 +31,12 @@
 #include <liblightnvm.h>
 #include <nvm_be.h>
 #include <nvm_dev.h>
+#include <nvm_sched.h>
 #include <nvm_utils.h>
 
 int nvm_cmd_vuser(struct nvm_dev *dev, struct nvm_cmd *cmd, struct nvm_ret *ret)
 {
-	return dev->be->vuser(dev, cmd, ret);
+	return nvm_sched_vuser(dev, cmd, ret);
 }
 
 int nvm_cmd_vadmin(struct nvm_dev *dev, struct nvm_cmd *cmd, struct nvm_ret *ret)
@@ -33,6 +33,9 @@
 #include <liblightnvm.h>
 #include <nvm_be.h>
 #include <nvm_dev.h>
+#include <nvm_sq.h>
+#include <nvm_sched.h>
+#include <nvm_chunk.h>
 #include <nvm_debug.h>
 #include <nvm_utils.h>
 
@@ -77,6 +80,23 @@ void nvm_dev_attr_pr(const struct nvm_dev *dev)
 	printf("  erase_naddrs_max: %d\n", dev->erase_naddrs_max);
 	printf("  read_naddrs_max: %d\n", dev->read_naddrs_max);
 	printf("  write_naddrs_max: %d\n",dev->write_naddrs_max);
+	printf("  nretries: %d\n", dev->nretries);
+	printf("  sq: {flags: 0x%x, window_us: %d}\n", nvm_dev_get_sq(dev),
+	       dev->sq ? dev->sq->window_us : 0);
+	printf("  sched: {inflight_max: %d, deadline_us: %d, suspend: %d}\n",
+	       nvm_dev_get_sched(dev), dev->sched ? dev->sched->deadline_us : 0,
+	       dev->sched ? dev->sched->suspend : 0);
+	printf("  io_class: %d\n", nvm_dev_get_io_class(dev));
+	printf("  lun_stats: %d\n", nvm_dev_get_lun_stats_enabled(dev));
+	printf("  vcopy: %d\n", nvm_dev_get_vcopy(dev));
+	printf("  chunks: %d\n", dev->chunks != NULL);
+	printf("  wcache: {enabled: %d, mw_cunits: %d}\n",
+	       nvm_dev_get_wcache(dev), nvm_dev_get_mw_cunits(dev));
+	for (int i = 0; dev->qos && (i < NVM_IO_NCLASSES); ++i) {
+		printf("  io_limit[%d]: {bytes_per_sec: %"PRIu64", "
+		       "cmds_per_sec: %"PRIu64"}\n", i,
+		       dev->qos->bytes_per_sec[i], dev->qos->cmds_per_sec[i]);
+	}
 
 	printf("  meta_mode: %d\n", nvm_dev_get_meta_mode(dev));
 	printf("  bbts_cached: %d\n", nvm_dev_get_bbts_cached(dev));
@@ -85,6 +105,8 @@ void nvm_dev_attr_pr(const struct nvm_dev *dev)
 
 	printf("  quirks: "NVM_I8_FMT"\n",
 	       NVM_I8_TO_STR(nvm_dev_get_quirks(dev)));
+	printf("  partition: {ch_off: %d, lun_off: %d}\n", dev->ch_off,
+	       dev->lun_off);
 }
 
 void nvm_dev_pr(const struct nvm_dev *dev)
@@ -135,6 +157,31 @@ uint32_t nvm_dev_get_mccap(const struct nvm_dev *dev)
 	return dev->mccap;
 }
 
+int nvm_dev_get_vcopy(const struct nvm_dev *dev)
+{
+	return dev->vcopy;
+}
+
+int nvm_dev_get_mw_cunits(const struct nvm_dev *dev)
+{
+	return dev->mw_cunits;
+}
+
+int nvm_dev_get_wcache(const struct nvm_dev *dev)
+{
+	return dev->chunks && dev->chunks->wcaches;
+}
+
+int nvm_dev_set_wcache(struct nvm_dev *dev, int enabled)
+{
+	if ((enabled != 0) && (enabled != 1)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return nvm_chunk_wcache_enable(dev, enabled);
+}
+
 int nvm_dev_get_quirks(const struct nvm_dev *dev)
 {
 	return dev->quirks;
@@ -288,6 +335,275 @@ int nvm_dev_set_write_naddrs_max(struct nvm_dev *dev, int naddrs)
 	return 0;
 }
 
+int nvm_dev_get_sq(const struct nvm_dev *dev)
+{
+	return dev->sq ? dev->sq->flags : NVM_SQ_NONE;
+}
+
+int nvm_dev_set_sq(struct nvm_dev *dev, int flags, int window_us)
+{
+	struct nvm_sq *sq = NULL;
+
+	if ((flags & ~(NVM_SQ_PMODE | NVM_SQ_MERGE)) || (window_us < 0)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (flags) {
+		sq = nvm_sq_create(flags, window_us);
+		if (!sq)
+			return -1;	// Propagate errno
+	}
+
+	nvm_sq_destroy(dev->sq);
+	dev->sq = sq;
+
+	return 0;
+}
+
+int nvm_dev_get_sched(const struct nvm_dev *dev)
+{
+	return dev->sched ? dev->sched->inflight_max : 0;
+}
+
+int nvm_dev_set_sched(struct nvm_dev *dev, int inflight_max, int deadline_us)
+{
+	struct nvm_sched *sched = NULL;
+
+	if ((inflight_max < 0) || (deadline_us < 0)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (inflight_max) {
+		sched = nvm_sched_create(dev, inflight_max, deadline_us);
+		if (!sched)
+			return -1;	// Propagate errno
+	}
+
+	nvm_sched_destroy(dev->sched);
+	dev->sched = sched;
+
+	return 0;
+}
+
+int nvm_dev_get_io_class(const struct nvm_dev *dev)
+{
+	return dev->io_class;
+}
+
+int nvm_dev_set_io_class(struct nvm_dev *dev, int io_class)
+{
+	if ((io_class < 0) || (io_class >= NVM_IO_NCLASSES)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	dev->io_class = io_class;
+
+	return 0;
+}
+
+int nvm_dev_set_io_limit(struct nvm_dev *dev, int io_class,
+			 uint64_t bytes_per_sec, uint64_t cmds_per_sec)
+{
+	if ((io_class < 0) || (io_class >= NVM_IO_NCLASSES)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (!dev->qos) {
+		if (!bytes_per_sec && !cmds_per_sec)
+			return 0;
+
+		dev->qos = nvm_qos_create(&dev->geo);
+		if (!dev->qos)
+			return -1;	// Propagate errno
+	}
+
+	pthread_mutex_lock(&dev->qos->lock);
+	dev->qos->bytes_per_sec[io_class] = bytes_per_sec;
+	dev->qos->cmds_per_sec[io_class] = cmds_per_sec;
+	pthread_mutex_unlock(&dev->qos->lock);
+
+	return 0;
+}
+
+int nvm_dev_get_lun_stats_enabled(const struct nvm_dev *dev)
+{
+	return dev->load != NULL;
+}
+
+int nvm_dev_set_lun_stats(struct nvm_dev *dev, int enabled)
+{
+	struct nvm_load *load = NULL;
+
+	switch (enabled) {
+	case 0:
+		break;
+	case 1:
+		if (dev->load)
+			return 0;
+
+		load = nvm_load_create(dev);
+		if (!load)
+			return -1;	// Propagate errno
+		break;
+
+	default:
+		errno = EINVAL;
+		return -1;
+	}
+
+	nvm_load_destroy(dev->load);
+	dev->load = load;
+
+	return 0;
+}
+
+int nvm_dev_get_lun_stats(struct nvm_dev *dev, struct nvm_addr addr,
+			  struct nvm_lun_stats *stats)
+{
+	struct nvm_lun_stats all[dev->geo.nchannels * dev->geo.nluns];
+
+	if (!dev->load || (addr.g.ch >= dev->geo.nchannels) ||
+	    (addr.g.lun >= dev->geo.nluns)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	nvm_load_stats(dev->load, all);
+	*stats = all[addr.g.ch * dev->geo.nluns + addr.g.lun];
+
+	return 0;
+}
+
+int nvm_dev_set_slow_luns(struct nvm_dev *dev, double factor, int exclude)
+{
+	if (!dev->load || (factor < 0) || ((exclude != 0) && (exclude != 1))) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	pthread_mutex_lock(&dev->load->lock);
+	dev->load->slow_factor = factor;
+	dev->load->slow_exclude = exclude;
+	pthread_mutex_unlock(&dev->load->lock);
+
+	return 0;
+}
+
+int nvm_dev_set_lun_probe(struct nvm_dev *dev, int interval_ms, int blk)
+{
+	if (!dev->load || (interval_ms < 0) || (blk < 0) ||
+	    (blk >= (int)dev->geo.nblocks)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return nvm_load_probe(dev->load, interval_ms, blk);
+}
+
+int nvm_dev_place_luns(struct nvm_dev *dev, struct nvm_addr addrs[],
+		       int naddrs)
+{
+	const int NCHANNELS = dev->geo.nchannels;
+	const int NLUNS = NCHANNELS * dev->geo.nluns;
+	struct nvm_lun_stats stats[NLUNS];
+	double wait[NLUNS];
+	double lat_us = 0;
+	int slow[NLUNS];
+	int order[NLUNS];
+	int ncands = 0;
+
+	if ((naddrs < 1) || (naddrs > NLUNS)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (dev->load) {
+		int nlats = 0;
+
+		nvm_load_stats(dev->load, stats);
+
+		for (int i = 0; i < NLUNS; ++i) {	// Mean of sampled LUNs
+			if (stats[i].lat_us > 0) {
+				lat_us += stats[i].lat_us;
+				++nlats;
+			}
+		}
+		lat_us = nlats ? lat_us / nlats : 1;
+	}
+
+	for (int i = 0; i < NLUNS; ++i) {	// Channel-first candidates
+		const int ch = i % NCHANNELS;
+		const int lun = i / NCHANNELS;
+		const struct nvm_lun_stats *st = &stats[ch * dev->geo.nluns + lun];
+
+		wait[i] = 0;
+		slow[i] = 0;
+		if (dev->load) {
+			// Outstanding commands on an unsampled LUN take the mean
+			wait[i] = st->lat_us > 0 ?
+				  (st->outstanding + 1) * st->lat_us :
+				  st->outstanding * lat_us;
+			slow[i] = st->slow;
+		}
+
+		if (slow[i] && dev->load->slow_exclude)
+			continue;
+
+		order[ncands++] = i;
+	}
+
+	if (ncands < naddrs) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	for (int i = 1; i < ncands; ++i) {	// Stable sort, slow then wait
+		const int cand = order[i];
+		int j;
+
+		for (j = i; j > 0; --j) {
+			const int prev = order[j - 1];
+
+			if ((slow[prev] < slow[cand]) ||
+			    ((slow[prev] == slow[cand]) &&
+			     (wait[prev] <= wait[cand])))
+				break;
+
+			order[j] = prev;
+		}
+		order[j] = cand;
+	}
+
+	for (int i = 0; i < naddrs; ++i) {
+		addrs[i].ppa = 0;
+		addrs[i].g.ch = order[i] % NCHANNELS;
+		addrs[i].g.lun = order[i] / NCHANNELS;
+	}
+
+	return 0;
+}
+
+int nvm_dev_get_nretries(const struct nvm_dev *dev)
+{
+	return dev->nretries;
+}
+
+int nvm_dev_set_nretries(struct nvm_dev *dev, int nretries)
+{
+	if (nretries < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	dev->nretries = nretries;
+
+	return 0;
+}
+
 int nvm_dev_get_bbts_cached(const struct nvm_dev *dev)
 {
 	return dev->bbts_cached;
@@ -309,6 +625,56 @@ int nvm_dev_set_bbts_cached(struct nvm_dev *dev, int bbts_cached)
 	return 0;
 }
 
+static void nvm_dev_fillers_free(struct nvm_dev *dev)
+{
+	nvm_buf_free(dev->pad_buf);
+	dev->pad_buf = NULL;
+
+	for (int i = 0; i < 3; ++i) {
+		nvm_buf_free(dev->meta_bufs[i]);
+		dev->meta_bufs[i] = NULL;
+	}
+}
+
+/**
+ * Allocate and fill the padding and meta buffers, they are shared, read-only,
+ * by all writes on the device and sized for a command of NVM_NADDR_MAX
+ * addresses
+ */
+static int nvm_dev_fillers_alloc(struct nvm_dev *dev)
+{
+	const size_t pad_nbytes = NVM_NADDR_MAX * dev->geo.sector_nbytes;
+	const size_t meta_nbytes = NVM_NADDR_MAX * dev->geo.meta_nbytes;
+
+	dev->pad_buf = NULL;
+	for (int i = 0; i < 3; ++i)
+		dev->meta_bufs[i] = NULL;
+
+	dev->pad_buf = nvm_buf_alloc(&dev->geo, pad_nbytes);
+	if (!dev->pad_buf)
+		return -1;
+	nvm_buf_fill(dev->pad_buf, pad_nbytes);
+
+	if (!meta_nbytes)
+		return 0;
+
+	dev->meta_bufs[NVM_META_MODE_ALPHA] = nvm_buf_alloc(&dev->geo,
+							    meta_nbytes);
+	dev->meta_bufs[NVM_META_MODE_CONST] = nvm_buf_alloc(&dev->geo,
+							    meta_nbytes);
+	if (!dev->meta_bufs[NVM_META_MODE_ALPHA] ||
+	    !dev->meta_bufs[NVM_META_MODE_CONST]) {
+		nvm_dev_fillers_free(dev);
+		return -1;
+	}
+
+	nvm_buf_fill(dev->meta_bufs[NVM_META_MODE_ALPHA], meta_nbytes);
+	memset(dev->meta_bufs[NVM_META_MODE_CONST], 65 + (meta_nbytes % 20),
+	       meta_nbytes);
+
+	return 0;
+}
+
 struct nvm_dev * nvm_dev_openf(const char *dev_path, int flags) {
 	struct nvm_dev *dev = NULL;
 
@@ -335,6 +701,8 @@ struct nvm_dev * nvm_dev_openf(const char *dev_path, int flags) {
 	dev->bbts = malloc(sizeof(*dev->bbts) * dev->nbbts);
 	if (!dev->bbts) {
 		NVM_DEBUG("FAILED: malloc dev->bbts");
+		dev->be->close(dev);
+		free(dev);
 		errno = ENOMEM;
 		return NULL;
 	}
@@ -342,6 +710,39 @@ struct nvm_dev * nvm_dev_openf(const char *dev_path, int flags) {
 	for (size_t i = 0; i < dev->nbbts; ++i)
 		dev->bbts[i] = NULL;
 
+	dev->sq = NULL;
+	dev->sched = NULL;
+	dev->io_class = NVM_IO_CLASS_LATENCY;
+	dev->qos = NULL;
+	dev->load = NULL;
+
+	dev->parent = NULL;
+	dev->ch_off = 0;
+	dev->lun_off = 0;
+
+	// Vector copies carry whole write units of `nsectors`
+	dev->vcopy = (dev->verid == NVM_SPEC_VERID_20) &&
+		     (dev->mccap & NVM_SPEC_20_MCCAP_VCOPY) &&
+		     (dev->geo.nsectors <= NVM_NADDR_MAX);
+
+	// The device is usable without the chunk table and the write caches
+	dev->chunks = NULL;
+	if (dev->verid == NVM_SPEC_VERID_20) {
+		dev->chunks = nvm_chunk_tbl_create(dev);
+		if (!dev->chunks) {
+			NVM_DEBUG("FAILED: nvm_chunk_tbl_create, continuing");
+		} else if (dev->mw_cunits && nvm_chunk_wcache_enable(dev, 1)) {
+			NVM_DEBUG("FAILED: nvm_chunk_wcache_enable, continuing");
+		}
+	}
+
+	if (nvm_dev_fillers_alloc(dev)) {
+		NVM_DEBUG("FAILED: nvm_dev_fillers_alloc");
+		nvm_dev_close(dev);
+		errno = ENOMEM;
+		return NULL;
+	}
+
 	// HACK: use naming conventions to determine nsid, fallback to hardcode
 	dev->nsid = atoi(&dev_path[strlen(dev_path)-1]);
 	if ((dev->nsid < 1) || (dev->nsid > 1000))
@@ -360,12 +761,88 @@ void nvm_dev_close(struct nvm_dev *dev)
 	if (!dev)
 		return;
 
+	nvm_load_destroy(dev->load);		// Stops the probe, if any
+	dev->load = NULL;
+
 	nvm_bbt_flush_all(dev, NULL);
 
-	dev->be->close(dev);
+	if (!dev->parent)			// Partitions share the backend
+		dev->be->close(dev);
 
 	nvm_bbt_flush_all(dev, NULL);
 	free(dev->bbts);
+	nvm_dev_fillers_free(dev);
+	nvm_sq_destroy(dev->sq);
+	nvm_sched_destroy(dev->sched);
+	nvm_qos_destroy(dev->qos);
+	if (!dev->parent)			// Partitions share the chunks
+		nvm_chunk_tbl_destroy(dev->chunks);
 	free(dev);
 }
 
+struct nvm_dev *nvm_dev_partition(struct nvm_dev *dev, int ch_bgn, int ch_end,
+				  int lun_bgn, int lun_end)
+{
+	struct nvm_dev *part;
+	struct nvm_geo *geo;
+
+	if (!dev) {
+		errno = EINVAL;
+		return NULL;
+	}
+	if ((ch_bgn < 0) || (ch_end < ch_bgn) ||
+	    (ch_end >= (int)dev->geo.nchannels)) {
+		NVM_DEBUG("FAILED: invalid channels");
+		errno = EINVAL;
+		return NULL;
+	}
+	if ((lun_bgn < 0) || (lun_end < lun_bgn) ||
+	    (lun_end >= (int)dev->geo.nluns)) {
+		NVM_DEBUG("FAILED: invalid LUNs");
+		errno = EINVAL;
+		return NULL;
+	}
+
+	part = malloc(sizeof(*part));
+	if (!part) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	*part = *dev;				// Backend, fd, format and attrs
+
+	part->parent = dev;
+	part->ch_off = dev->ch_off + ch_bgn;
+	part->lun_off = dev->lun_off + lun_bgn;
+
+	geo = &part->geo;
+	geo->nchannels = ch_end - ch_bgn + 1;
+	geo->nluns = lun_end - lun_bgn + 1;
+	geo->tbytes = geo->nchannels * geo->nluns * \
+			geo->nplanes * geo->nblocks * \
+			geo->npages * geo->nsectors * \
+			geo->sector_nbytes;
+
+	part->sq = NULL;
+	part->sched = NULL;
+	part->qos = NULL;
+	part->load = NULL;
+
+	part->nbbts = geo->nchannels * geo->nluns;
+	part->bbts = calloc(part->nbbts, sizeof(*part->bbts));
+	if (!part->bbts) {
+		NVM_DEBUG("FAILED: calloc part->bbts");
+		free(part);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	if (nvm_dev_fillers_alloc(part)) {
+		NVM_DEBUG("FAILED: nvm_dev_fillers_alloc");
+		free(part->bbts);
+		free(part);
+		return NULL;			// Propagate errno
+	}
+
+	return part;
+}
+
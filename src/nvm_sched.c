@@ -0,0 +1,877 @@
+/*
+ * nvm_sched - Per-LUN scheduling of vector commands
+ *
+ * Copyright (C) 2015-2017 Javier Gonzáles <javier@cnexlabs.com>
+ * Copyright (C) 2015-2017 Matias Bjørling <matias@cnexlabs.com>
+ * Copyright (C) 2015-2017 Simon A. F. Lund <slund@cnexlabs.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <liblightnvm.h>
+#include <nvm_be.h>
+#include <nvm_omp.h>
+#include <nvm_dev.h>
+#include <nvm_sched.h>
+#include <nvm_debug.h>
+
+/**
+ * Whether the media controller of the device supports program/erase suspend
+ */
+static int nvm_sched_suspension(const struct nvm_dev *dev)
+{
+	switch (dev->verid) {
+	case NVM_SPEC_VERID_12:
+		return !!(dev->mccap & NVM_SPEC_12_MCCAP_SUSPENSION);
+	case NVM_SPEC_VERID_20:
+		return !!(dev->mccap & NVM_SPEC_20_MCCAP_SUSPENSION);
+
+	default:
+		return 0;
+	}
+}
+
+struct nvm_sched *nvm_sched_create(const struct nvm_dev *dev,
+				   int inflight_max, int deadline_us)
+{
+	const struct nvm_geo *geo = &dev->geo;
+	struct nvm_sched *sched;
+
+	sched = calloc(1, sizeof(*sched));
+	if (!sched) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	sched->inflight_max = inflight_max;
+	sched->deadline_us = deadline_us;
+	sched->suspend = nvm_sched_suspension(dev);
+	sched->nluns = geo->nchannels * geo->nluns;
+
+	sched->luns = calloc(sched->nluns, sizeof(*sched->luns));
+	if (!sched->luns) {
+		free(sched);
+		errno = ENOMEM;
+		return NULL;
+	}
+	if (pthread_mutex_init(&sched->lock, NULL)) {
+		free(sched->luns);
+		free(sched);
+		errno = ENOMEM;
+		return NULL;
+	}
+	if (pthread_cond_init(&sched->cond, NULL)) {
+		pthread_mutex_destroy(&sched->lock);
+		free(sched->luns);
+		free(sched);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	return sched;
+}
+
+void nvm_sched_destroy(struct nvm_sched *sched)
+{
+	if (!sched)
+		return;
+
+	pthread_cond_destroy(&sched->cond);
+	pthread_mutex_destroy(&sched->lock);
+	free(sched->luns);
+	free(sched);
+}
+
+static _Thread_local int nvm_sched_io_class = -1;
+
+int nvm_sched_io_class_set(int io_class)
+{
+	const int prev = nvm_sched_io_class;
+
+	nvm_sched_io_class = io_class;
+
+	return prev;
+}
+
+int nvm_sched_io_class_get(const struct nvm_dev *dev)
+{
+	return nvm_sched_io_class >= 0 ? nvm_sched_io_class : dev->io_class;
+}
+
+struct nvm_qos *nvm_qos_create(const struct nvm_geo *geo)
+{
+	struct nvm_qos *qos;
+
+	qos = calloc(1, sizeof(*qos));
+	if (!qos) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	qos->nluns = geo->nchannels * geo->nluns;
+
+	qos->buckets = calloc(qos->nluns * NVM_IO_NCLASSES,
+			      sizeof(*qos->buckets));
+	if (!qos->buckets) {
+		free(qos);
+		errno = ENOMEM;
+		return NULL;
+	}
+	if (pthread_mutex_init(&qos->lock, NULL)) {
+		free(qos->buckets);
+		free(qos);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	return qos;
+}
+
+void nvm_qos_destroy(struct nvm_qos *qos)
+{
+	if (!qos)
+		return;
+
+	pthread_mutex_destroy(&qos->lock);
+	free(qos->buckets);
+	free(qos);
+}
+
+/**
+ * Refill the given bucket, up to NVM_QOS_BURST_MS worth of the limits, and
+ * return the nanoseconds until it is no longer depleted
+ */
+#define NVM_QOS_BURST_MS 100
+static long nvm_qos_refill(struct nvm_qos_bucket *bucket, uint64_t bytes_rate,
+			   uint64_t cmds_rate, const struct timespec *now)
+{
+	const double dt = (now->tv_sec - bucket->refilled.tv_sec) +
+			  (now->tv_nsec - bucket->refilled.tv_nsec) / 1e9;
+	long wait_ns = 0;
+
+	bucket->refilled = *now;
+
+	if (bytes_rate) {
+		const double burst = bytes_rate * (NVM_QOS_BURST_MS / 1000.0);
+
+		bucket->bytes += bytes_rate * dt;
+		if (bucket->bytes > burst)
+			bucket->bytes = burst;
+		if (bucket->bytes < 0)
+			wait_ns = -bucket->bytes / bytes_rate * 1e9 + 1;
+	}
+	if (cmds_rate) {
+		const double burst = cmds_rate * (NVM_QOS_BURST_MS / 1000.0);
+		long cmds_ns = 0;
+
+		bucket->cmds += cmds_rate * dt;
+		if (bucket->cmds > burst)
+			bucket->cmds = burst;
+		if (bucket->cmds < 0)
+			cmds_ns = -bucket->cmds / cmds_rate * 1e9 + 1;
+		if (cmds_ns > wait_ns)
+			wait_ns = cmds_ns;
+	}
+
+	return wait_ns;
+}
+
+/**
+ * Wait until none of the buckets of the I/O class on the given LUNs are
+ * depleted, then charge the command, its bytes are charged to each LUN in
+ * proportion to its # of addresses
+ */
+static void nvm_qos_wait(struct nvm_qos *qos, int io_class, const int luns[],
+			 const int counts[], int nluns, int naddrs,
+			 size_t nbytes)
+{
+	const uint64_t bytes_rate = qos->bytes_per_sec[io_class];
+	const uint64_t cmds_rate = qos->cmds_per_sec[io_class];
+
+	if (!bytes_rate && !cmds_rate)
+		return;
+
+	for (;;) {
+		struct timespec now, nap;
+		long wait_ns = 0;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		pthread_mutex_lock(&qos->lock);
+		for (int i = 0; i < nluns; ++i) {
+			struct nvm_qos_bucket *bucket = &qos->buckets[
+				luns[i] * NVM_IO_NCLASSES + io_class];
+			long lun_ns;
+
+			lun_ns = nvm_qos_refill(bucket, bytes_rate, cmds_rate,
+						&now);
+			if (lun_ns > wait_ns)
+				wait_ns = lun_ns;
+		}
+		if (!wait_ns) {
+			for (int i = 0; i < nluns; ++i) {
+				struct nvm_qos_bucket *bucket = &qos->buckets[
+					luns[i] * NVM_IO_NCLASSES + io_class];
+
+				bucket->bytes -= (double)nbytes * counts[i] /
+						 naddrs;
+				bucket->cmds -= 1;
+			}
+		}
+		pthread_mutex_unlock(&qos->lock);
+
+		if (!wait_ns)
+			return;
+
+		nap.tv_sec = wait_ns / 1000000000L;
+		nap.tv_nsec = wait_ns % 1000000000L;
+		nanosleep(&nap, NULL);
+	}
+}
+
+/**
+ * Whether the command is a vector copy, which has the `vadmin` layout and is
+ * sent via the `vio` backend function, see nvm_addr_copy
+ */
+static inline int nvm_sched_cmd_vcopy(const struct nvm_cmd *cmd)
+{
+	return cmd->vuser.opcode == NVM_S20_OPC_VCOPY;
+}
+
+static inline int nvm_sched_cmd_naddrs(const struct nvm_cmd *cmd)
+{
+	return (nvm_sched_cmd_vcopy(cmd) ? cmd->vadmin.nppas :
+					   cmd->vuser.nppas) + 1;
+}
+
+static inline int nvm_sched_be(struct nvm_dev *dev, struct nvm_cmd *cmd,
+			       struct nvm_ret *ret)
+{
+	if (nvm_sched_cmd_vcopy(cmd))
+		return dev->be->vio(dev, cmd, ret);
+
+	return dev->be->vuser(dev, cmd, ret);
+}
+
+/**
+ * Collect the distinct LUNs addressed by the given vector command and the #
+ * of addresses on each of them, a vector copy by its destination addresses
+ *
+ * @returns The number of LUNs
+ */
+static int nvm_sched_cmd_luns(struct nvm_dev *dev, struct nvm_cmd *cmd,
+			      int luns[], int counts[])
+{
+	const int naddrs = nvm_sched_cmd_naddrs(cmd);
+	const int NLUNS = dev->geo.nchannels * dev->geo.nluns;
+	const uint64_t list = nvm_sched_cmd_vcopy(cmd) ?
+			      ((uint64_t)cmd->vadmin.cdw15 << 32) |
+			      cmd->vadmin.cdw14 : cmd->vuser.ppa_list;
+	const uint64_t *dev_addrs = naddrs == 1 ? &list :
+				    (const uint64_t *)list;
+	int nluns = 0;
+
+	for (int i = 0; i < naddrs; ++i) {
+		struct nvm_addr addr = nvm_addr_dev2gen(dev, dev_addrs[i]);
+		int lun = addr.g.ch * dev->geo.nluns + addr.g.lun;
+		int j;
+
+		if ((addr.g.ch >= dev->geo.nchannels) ||
+		    (addr.g.lun >= dev->geo.nluns) || (lun >= NLUNS))
+			continue;		// Rejected by the device
+
+		for (j = 0; (j < nluns) && (luns[j] != lun); ++j)
+			;
+		if (j == nluns) {
+			luns[nluns++] = lun;
+			counts[j] = 0;
+		}
+		++counts[j];
+	}
+
+	return nluns;
+}
+
+struct nvm_load *nvm_load_create(struct nvm_dev *dev)
+{
+	const struct nvm_geo *geo = &dev->geo;
+	struct nvm_load *load;
+
+	load = calloc(1, sizeof(*load));
+	if (!load) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	load->dev = dev;
+	load->nluns = geo->nchannels * geo->nluns;
+
+	load->luns = calloc(load->nluns, sizeof(*load->luns));
+	if (!load->luns) {
+		free(load);
+		errno = ENOMEM;
+		return NULL;
+	}
+	if (pthread_mutex_init(&load->lock, NULL)) {
+		free(load->luns);
+		free(load);
+		errno = ENOMEM;
+		return NULL;
+	}
+	if (pthread_cond_init(&load->cond, NULL)) {
+		pthread_mutex_destroy(&load->lock);
+		free(load->luns);
+		free(load);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	return load;
+}
+
+void nvm_load_destroy(struct nvm_load *load)
+{
+	if (!load)
+		return;
+
+	nvm_load_probe(load, 0, 0);
+
+	pthread_cond_destroy(&load->cond);
+	pthread_mutex_destroy(&load->lock);
+	free(load->luns);
+	free(load);
+}
+
+static void nvm_load_outstanding(struct nvm_load *load, const int luns[],
+				 int nluns, int delta)
+{
+	pthread_mutex_lock(&load->lock);
+	for (int i = 0; i < nluns; ++i)
+		load->luns[luns[i]].stats.outstanding += delta;
+	pthread_mutex_unlock(&load->lock);
+}
+
+/**
+ * Moving average of `n` samples, weighing the latest sample by
+ * 1/NVM_LOAD_EWMA_WEIGHT
+ */
+#define NVM_LOAD_EWMA_WEIGHT 8
+static inline double nvm_load_ewma(double avg, double sample, uint64_t n)
+{
+	return n ? avg + (sample - avg) / NVM_LOAD_EWMA_WEIGHT : sample;
+}
+
+/**
+ * Account the latency of a completed command to the given LUNs, reads are
+ * furthermore counted in the histogram of their LUNs
+ */
+static void nvm_load_latency(struct nvm_load *load, const int luns[],
+			     int nluns, int read, double lat_us)
+{
+	int bucket = 0;
+
+	while ((bucket < NVM_LOAD_NBUCKETS - 1) && ((1ULL << (bucket + 1)) <=
+						    (uint64_t)lat_us))
+		++bucket;
+
+	pthread_mutex_lock(&load->lock);
+	for (int i = 0; i < nluns; ++i) {
+		struct nvm_load_lun *lun = &load->luns[luns[i]];
+		struct nvm_lun_stats *stats = &lun->stats;
+
+		stats->lat_us = nvm_load_ewma(stats->lat_us, lat_us,
+					      stats->ncmds);
+		++stats->ncmds;
+
+		if (!read)
+			continue;
+
+		stats->read_lat_us = nvm_load_ewma(stats->read_lat_us, lat_us,
+						   stats->nreads);
+		++stats->nreads;
+
+		if (lun->nhist >= NVM_LOAD_HIST_WINDOW) {	// Age
+			lun->nhist = 0;
+			for (int b = 0; b < NVM_LOAD_NBUCKETS; ++b) {
+				lun->hist[b] /= 2;
+				lun->nhist += lun->hist[b];
+			}
+		}
+		++lun->hist[bucket];
+		++lun->nhist;
+	}
+	pthread_mutex_unlock(&load->lock);
+}
+
+/**
+ * Estimate the given percentile of the read latencies in the histogram,
+ * interpolating within the bucket [2^b, 2^(b+1)) usec containing it
+ */
+static double nvm_load_percentile(const struct nvm_load_lun *lun, double pct)
+{
+	const double rank = lun->nhist * pct / 100.0;
+	double seen = 0;
+
+	if (!lun->nhist)
+		return 0;
+
+	for (int b = 0; b < NVM_LOAD_NBUCKETS; ++b) {
+		const double lo = b ? (double)(1ULL << b) : 0;
+		const double hi = (double)(1ULL << (b + 1));
+
+		if (!lun->hist[b] || (seen + lun->hist[b] < rank)) {
+			seen += lun->hist[b];
+			continue;
+		}
+
+		return lo + (hi - lo) * (rank - seen) / lun->hist[b];
+	}
+
+	return (double)(1ULL << NVM_LOAD_NBUCKETS);
+}
+
+static int nvm_load_cmp_dbl(const void *a, const void *b)
+{
+	const double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+void nvm_load_stats(struct nvm_load *load, struct nvm_lun_stats stats[])
+{
+	double lats[load->nluns];
+	double median = 0;
+	int nlats = 0;
+
+	pthread_mutex_lock(&load->lock);
+	for (int i = 0; i < load->nluns; ++i) {
+		stats[i] = load->luns[i].stats;
+		stats[i].read_p50_us = nvm_load_percentile(&load->luns[i], 50);
+		stats[i].read_p99_us = nvm_load_percentile(&load->luns[i], 99);
+		stats[i].slow = 0;
+
+		if (stats[i].nreads)
+			lats[nlats++] = stats[i].read_lat_us;
+	}
+
+	if (load->slow_factor && (nlats > 2)) {	// Outliers of the median
+		qsort(lats, nlats, sizeof(*lats), nvm_load_cmp_dbl);
+		median = lats[nlats / 2];
+
+		for (int i = 0; i < load->nluns; ++i) {
+			stats[i].slow = stats[i].nreads &&
+				(stats[i].read_lat_us > load->slow_factor * median);
+		}
+	}
+	pthread_mutex_unlock(&load->lock);
+}
+
+/**
+ * Erase the probe block of the given LUN and write its first page from `buf`,
+ * such that probes read known data instead of failing on an unwritten page
+ */
+static int nvm_load_probe_prep(struct nvm_dev *dev, int lun, int blk,
+			       char *buf)
+{
+	const struct nvm_geo *geo = &dev->geo;
+	const int pmode = nvm_dev_get_pmode(dev);
+	const int naddrs = geo->nplanes * geo->nsectors;
+	struct nvm_addr addrs[naddrs];
+	struct nvm_ret ret = {0,0};
+
+	for (int i = 0; i < naddrs; ++i) {
+		addrs[i].ppa = 0;
+		addrs[i].g.ch = lun / geo->nluns;
+		addrs[i].g.lun = lun % geo->nluns;
+		addrs[i].g.blk = blk;
+		addrs[i].g.pl = i % geo->nplanes;
+	}
+	if (nvm_addr_erase(dev, addrs, geo->nplanes, pmode, &ret) < 0)
+		return -1;
+
+	for (int i = 0; i < naddrs; ++i) {		// First page
+		addrs[i].g.pl = (i / geo->nsectors) % geo->nplanes;
+		addrs[i].g.sec = i % geo->nsectors;
+	}
+
+	return nvm_addr_write(dev, addrs, naddrs, buf, NULL, pmode, &ret) < 0;
+}
+
+/**
+ * Read a sector of the probe block on each LUN every interval, such that the
+ * statistics of LUNs not otherwise read are kept up to date. The probe block
+ * is written first, LUNs on which that fails are not probed.
+ */
+static void *nvm_load_prober(void *arg)
+{
+	struct nvm_load *load = arg;
+	struct nvm_dev *dev = load->dev;
+	const struct nvm_geo *geo = &dev->geo;
+	const size_t buf_nbytes = geo->nplanes * geo->nsectors *
+				  geo->sector_nbytes;
+	char *buf = nvm_buf_alloc(geo, buf_nbytes);
+	uint8_t ready[load->nluns];
+
+	nvm_sched_io_class_set(NVM_IO_CLASS_BACKGROUND);
+
+	if (buf)
+		nvm_buf_fill(buf, buf_nbytes);
+	for (int i = 0; buf && (i < load->nluns); ++i)
+		ready[i] = !nvm_load_probe_prep(dev, i, load->probe_blk, buf);
+
+	pthread_mutex_lock(&load->lock);
+	while (buf && !load->probe_stop) {
+		struct timespec deadline;
+
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += (load->probe_ms % 1000) * 1000000L;
+		deadline.tv_sec += load->probe_ms / 1000 +
+				   deadline.tv_nsec / 1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+
+		while (!load->probe_stop &&
+		       (pthread_cond_timedwait(&load->cond, &load->lock,
+					       &deadline) != ETIMEDOUT))
+			;
+		if (load->probe_stop)
+			break;
+
+		pthread_mutex_unlock(&load->lock);
+		for (int i = 0; i < load->nluns; ++i) {
+			struct nvm_ret ret = {0,0};
+			struct nvm_addr addr;
+
+			if (!ready[i])
+				continue;
+
+			addr.ppa = 0;
+			addr.g.ch = i / geo->nluns;
+			addr.g.lun = i % geo->nluns;
+			addr.g.blk = load->probe_blk;
+
+			nvm_addr_read(dev, &addr, 1, buf, NULL,
+				      NVM_FLAG_PMODE_SNGL, &ret);
+		}
+		pthread_mutex_lock(&load->lock);
+	}
+	pthread_mutex_unlock(&load->lock);
+
+	nvm_buf_free(buf);
+
+	return NULL;
+}
+
+int nvm_load_probe(struct nvm_load *load, int interval_ms, int blk)
+{
+	if (load->probe_ms) {				// Stop
+		pthread_mutex_lock(&load->lock);
+		load->probe_stop = 1;
+		pthread_cond_broadcast(&load->cond);
+		pthread_mutex_unlock(&load->lock);
+
+		pthread_join(load->probe, NULL);
+		load->probe_ms = 0;
+	}
+
+	if (!interval_ms)
+		return 0;
+
+	load->probe_ms = interval_ms;
+	load->probe_blk = blk;
+	load->probe_stop = 0;
+	if (pthread_create(&load->probe, NULL, nvm_load_prober, load)) {
+		load->probe_ms = 0;
+		errno = EAGAIN;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Send the command to the backend, accounting its latency when enabled
+ */
+static int nvm_sched_be_vuser(struct nvm_dev *dev, struct nvm_cmd *cmd,
+			      struct nvm_ret *ret, const int luns[], int nluns)
+{
+	struct timespec bgn, end;
+	int err;
+
+	if (!dev->load)
+		return nvm_sched_be(dev, cmd, ret);
+
+	clock_gettime(CLOCK_MONOTONIC, &bgn);
+	err = nvm_sched_be(dev, cmd, ret);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	nvm_load_latency(dev->load, luns, nluns,
+			 cmd->vuser.opcode == NVM_S12_OPC_READ,
+			 (end.tv_sec - bgn.tv_sec) * 1e6 +
+			 (end.tv_nsec - bgn.tv_nsec) / 1e3);
+
+	return err;
+}
+
+/**
+ * Whether a command of the given class is admitted to all of its LUNs. While
+ * suspendable commands are in flight on a LUN, one read beyond the limit is
+ * admitted to preempt them, further reads wait as usual.
+ */
+static int nvm_sched_admits(struct nvm_sched *sched, const int luns[],
+			    int nluns, int class, int read)
+{
+	for (int i = 0; i < nluns; ++i) {
+		struct nvm_sched_lun *lun = &sched->luns[luns[i]];
+		int inflight_max = sched->inflight_max;
+
+		if (read && lun->nsuspendable)
+			++inflight_max;
+		if (lun->inflight >= inflight_max)
+			return 0;
+
+		for (int k = 0; k < class; ++k) {
+			if (lun->nwaiting[k])
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
+static void nvm_sched_waiting(struct nvm_sched *sched, const int luns[],
+			      int nluns, int class, int delta)
+{
+	for (int i = 0; i < nluns; ++i)
+		sched->luns[luns[i]].nwaiting[class] += delta;
+}
+
+static void nvm_sched_inflight(struct nvm_sched *sched, const int luns[],
+			       int nluns, int suspendable, int delta)
+{
+	for (int i = 0; i < nluns; ++i) {
+		sched->luns[luns[i]].inflight += delta;
+		if (suspendable)
+			sched->luns[luns[i]].nsuspendable += delta;
+	}
+}
+
+/**
+ * Wait for admission to the given LUNs, then send the command to the backend
+ */
+static int nvm_sched_issue(struct nvm_dev *dev, struct nvm_sched *sched,
+			   struct nvm_cmd *cmd, struct nvm_ret *ret,
+			   const int luns[], int nluns)
+{
+	const int read = cmd->vuser.opcode == NVM_S12_OPC_READ;
+	const int suspendable = !!(cmd->vuser.control & NVM_FLAG_SUSPEND);
+	int class = read ? NVM_SCHED_READ : NVM_SCHED_OTHER;
+	struct timespec deadline;
+	int err;
+
+	pthread_mutex_lock(&sched->lock);
+
+	if (!nvm_sched_admits(sched, luns, nluns, class, read)) {
+		if (sched->deadline_us) {
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_nsec += (sched->deadline_us % 1000000) * 1000L;
+			deadline.tv_sec += sched->deadline_us / 1000000 +
+					   deadline.tv_nsec / 1000000000L;
+			deadline.tv_nsec %= 1000000000L;
+		}
+
+		nvm_sched_waiting(sched, luns, nluns, class, 1);
+		while (!nvm_sched_admits(sched, luns, nluns, class, read)) {
+			if (!sched->deadline_us || (class == NVM_SCHED_URGENT)) {
+				pthread_cond_wait(&sched->cond, &sched->lock);
+				continue;
+			}
+			if (pthread_cond_timedwait(&sched->cond, &sched->lock,
+						   &deadline) != ETIMEDOUT)
+				continue;
+
+			// Waited past the deadline, promote
+			nvm_sched_waiting(sched, luns, nluns, class, -1);
+			class = NVM_SCHED_URGENT;
+			nvm_sched_waiting(sched, luns, nluns, class, 1);
+		}
+		nvm_sched_waiting(sched, luns, nluns, class, -1);
+	}
+
+	nvm_sched_inflight(sched, luns, nluns, suspendable, 1);
+
+	pthread_mutex_unlock(&sched->lock);
+
+	err = nvm_sched_be_vuser(dev, cmd, ret, luns, nluns);
+
+	pthread_mutex_lock(&sched->lock);
+	nvm_sched_inflight(sched, luns, nluns, suspendable, -1);
+	pthread_cond_broadcast(&sched->cond);
+	pthread_mutex_unlock(&sched->lock);
+
+	return err;
+}
+
+/**
+ * Issue an erase addressing multiple LUNs as one chunk per LUN, in parallel,
+ * such that reads waiting for a LUN are admitted once its own chunk, and not
+ * the entire erase, is completed
+ */
+static int nvm_sched_erase_chunked(struct nvm_dev *dev, struct nvm_sched *sched,
+				   struct nvm_cmd *cmd, struct nvm_ret *ret,
+				   const int luns[], int nluns)
+{
+	const int naddrs = cmd->vuser.nppas + 1;
+	const uint64_t *dev_addrs = (const uint64_t *)cmd->vuser.ppa_list;
+	int chunk_of[naddrs];
+	uint64_t status = 0;
+	uint32_t result = 0;
+	int nerr = 0;
+	int err = 0;
+
+	for (int i = 0; i < naddrs; ++i) {
+		struct nvm_addr addr = nvm_addr_dev2gen(dev, dev_addrs[i]);
+		int lun = addr.g.ch * dev->geo.nluns + addr.g.lun;
+
+		chunk_of[i] = 0;
+		for (int c = 0; c < nluns; ++c) {
+			if (luns[c] == lun)
+				chunk_of[i] = c;
+		}
+	}
+
+	#pragma omp parallel for num_threads(nluns) schedule(static,1) reduction(+:nerr) if(nluns>1)
+	for (int c = 0; c < nluns; ++c) {
+		uint64_t chunk_addrs[NVM_NADDR_MAX];
+		int idx[NVM_NADDR_MAX];
+		struct nvm_cmd chunk = *cmd;
+		struct nvm_ret chunk_ret = {0,0};
+		int n = 0;
+
+		for (int i = 0; i < naddrs; ++i) {
+			if (chunk_of[i] != c)
+				continue;
+
+			idx[n] = i;
+			chunk_addrs[n] = dev_addrs[i];
+			++n;
+		}
+
+		chunk.vuser.nppas = n - 1;
+		chunk.vuser.ppa_list = n == 1 ? chunk_addrs[0] :
+						(uint64_t)chunk_addrs;
+
+		if (!nvm_sched_issue(dev, sched, &chunk, &chunk_ret, &luns[c], 1))
+			continue;
+
+		++nerr;
+
+		#pragma omp critical
+		{
+			for (int j = 0; j < n; ++j) {
+				if (!chunk_ret.status ||
+				    ((chunk_ret.status >> j) & 1))
+					status |= 1ULL << idx[j];
+			}
+			result = chunk.vuser.result;
+			err = errno;
+		}
+	}
+
+	cmd->vuser.status = status;
+	cmd->vuser.result = result;
+	if (ret) {
+		ret->status = status;
+		ret->result = result;
+	}
+	if (nerr) {
+		errno = err;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Send the command via the scheduler, when enabled, to the backend. Programs
+ * and erases are flagged suspendable on a copy, the caller's command is left
+ * as is apart from its completion.
+ */
+static int nvm_sched_dispatch(struct nvm_dev *dev, struct nvm_cmd *cmd,
+			      struct nvm_ret *ret, const int luns[], int nluns)
+{
+	struct nvm_sched *sched = dev->sched;
+	const int erase = cmd->vuser.opcode == NVM_S12_OPC_ERASE;
+	const int suspendable = sched && sched->suspend &&
+		(erase || (cmd->vuser.opcode == NVM_S12_OPC_WRITE));
+	struct nvm_cmd scmd;
+	int err;
+
+	if (!sched)
+		return nvm_sched_be_vuser(dev, cmd, ret, luns, nluns);
+
+	scmd = *cmd;
+	if (suspendable)
+		scmd.vuser.control |= NVM_FLAG_SUSPEND;
+
+	if (erase && (nluns > 1))
+		err = nvm_sched_erase_chunked(dev, sched, &scmd, ret, luns,
+					      nluns);
+	else
+		err = nvm_sched_issue(dev, sched, &scmd, ret, luns, nluns);
+
+	scmd.vuser.control = cmd->vuser.control;
+	*cmd = scmd;			// Completion, of either layout
+
+	return err;
+}
+
+int nvm_sched_vuser(struct nvm_dev *dev, struct nvm_cmd *cmd,
+		    struct nvm_ret *ret)
+{
+	int luns[NVM_NADDR_MAX];
+	int counts[NVM_NADDR_MAX];
+	int nluns, err;
+
+	if (!dev->sched && !dev->qos && !dev->load)
+		return nvm_sched_be(dev, cmd, ret);
+
+	nluns = nvm_sched_cmd_luns(dev, cmd, luns, counts);
+
+	if (dev->load)
+		nvm_load_outstanding(dev->load, luns, nluns, 1);
+
+	if (dev->qos) {
+		const int naddrs = nvm_sched_cmd_naddrs(cmd);
+
+		nvm_qos_wait(dev->qos, nvm_sched_io_class_get(dev), luns,
+			     counts, nluns, naddrs,
+			     nvm_sched_cmd_vcopy(cmd) ?
+			     naddrs * dev->geo.sector_nbytes :
+			     cmd->vuser.data_len);
+	}
+
+	err = nvm_sched_dispatch(dev, cmd, ret, luns, nluns);
+
+	if (dev->load)
+		nvm_load_outstanding(dev->load, luns, nluns, -1);
+
+	return err;
+}
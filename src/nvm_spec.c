@@ -28,6 +28,7 @@
  */
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
 #include <liblightnvm.h>
 #include <nvm_be.h>
@@ -190,6 +191,90 @@ void nvm_spec_bbt_pr(const struct nvm_spec_bbt *bbt)
 	}
 }
 
+void nvm_spec_chunk_pr(const struct nvm_spec_chunk *chunk)
+{
+	if (!chunk) {
+		printf("nvm_spec_chunk: ~\n");
+		return;
+	}
+
+	printf("nvm_spec_chunk: {cs: 0x%02x, ct: 0x%02x, wli: %u, "
+	       "slba: 0x%016"PRIx64", cnlb: %"PRIu64", wp: %"PRIu64"}\n",
+	       chunk->cs, chunk->ct, chunk->wli, chunk->slba, chunk->cnlb,
+	       chunk->wp);
+}
+
+int nvm_spec_chunk_get(struct nvm_dev *dev, size_t idx, size_t nchunks,
+		       struct nvm_spec_chunk *chunks, struct nvm_ret *ret)
+{
+	struct nvm_cmd cmd = {.cdw={0}};
+	const size_t nbytes = nchunks * sizeof(*chunks);
+	const uint64_t offset = idx * sizeof(*chunks);
+	const uint32_t numd = nbytes / 4 - 1;	// Zero-based # of dwords
+
+	if (dev->verid != NVM_SPEC_VERID_20) {
+		errno = ENOSYS;
+		return -1;
+	}
+	if (!nchunks) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	cmd.admin.opcode = NVM_S20_OPC_GET_LOG;
+	cmd.admin.nsid = dev->nsid;
+	cmd.admin.addr = (uint64_t)chunks;
+	cmd.admin.data_len = nbytes;
+	cmd.admin.cdw10 = NVM_S20_LOG_CHUNK | ((numd & 0xFFFF) << 16);
+	cmd.admin.cdw11 = numd >> 16;
+	cmd.admin.cdw12 = offset & 0xFFFFFFFF;
+	cmd.admin.cdw13 = offset >> 32;
+
+	if (dev->be->admin(dev, &cmd, ret)) {
+		NVM_DEBUG("FAILED: be execution failed");
+		return -1;			// Propagate errno from backend
+	}
+
+	return 0;
+}
+
+/**
+ * Form the bad-block-table of a rev. 2.0 device from its chunk information,
+ * offline chunks are bad
+ */
+static int nvm_spec_bbt_chunks(struct nvm_dev *dev, struct nvm_addr addr,
+			       struct nvm_spec_bbt *spec_bbt,
+			       struct nvm_ret *ret)
+{
+	const struct nvm_geo *geo = &dev->geo;
+
+	spec_bbt->tblid[0] = 'B';
+	spec_bbt->tblid[1] = 'B';
+	spec_bbt->tblid[2] = 'L';
+	spec_bbt->tblid[3] = 'T';
+	spec_bbt->tblks = geo->nblocks * geo->nplanes;
+
+	for (size_t blk = 0; blk < geo->nblocks; ++blk) {
+		struct nvm_spec_chunk chunk;
+		uint8_t state;
+
+		addr.g.blk = blk;
+		if (nvm_chunk_get(dev, addr, &chunk, ret))
+			return -1;		// Propagate errno
+
+		state = NVM_BBT_FREE;
+		if (chunk.cs == NVM_S20_CHUNK_OFFLINE) {
+			state = NVM_BBT_BAD;
+			++spec_bbt->tfact;
+		}
+
+		for (size_t pl = 0; pl < geo->nplanes; ++pl)
+			spec_bbt->blk[blk * geo->nplanes + pl] = state;
+	}
+
+	return 0;
+}
+
 struct nvm_spec_bbt *nvm_spec_bbt_get(struct nvm_dev *dev, struct nvm_addr addr,
 				      struct nvm_ret *ret)
 {
@@ -207,6 +292,16 @@ struct nvm_spec_bbt *nvm_spec_bbt_get(struct nvm_dev *dev, struct nvm_addr addr,
 		return NULL;
 	}
 
+	if (dev->chunks) {		// Rev. 2.0 has no bad-block-table
+		memset(spec_bbt, 0, spec_bbt_sz);
+		if (nvm_spec_bbt_chunks(dev, addr, spec_bbt, ret)) {
+			nvm_buf_free(spec_bbt);
+			return NULL;
+		}
+
+		return spec_bbt;
+	}
+
 	cmd.vadmin.opcode = NVM_S12_OPC_GET_BBT;
 	cmd.vadmin.addr = (uint64_t)spec_bbt;
 	cmd.vadmin.data_len = spec_bbt_sz;
@@ -238,6 +333,11 @@ int nvm_spec_bbt_set(struct nvm_dev *dev, struct nvm_addr *addrs,
 	uint64_t dev_addrs[naddrs];
 	int err;
 
+	if (dev->chunks) {		// Rev. 2.0 has no bad-block-table
+		errno = ENOSYS;
+		return -1;
+	}
+
 	switch(flags) {
 	case NVM_BBT_FREE:
 	case NVM_BBT_BAD:
@@ -0,0 +1,548 @@
+/*
+ * nvm_sq - Submission queue combining vector commands
+ *
+ * Copyright (C) 2015-2017 Javier Gonzáles <javier@cnexlabs.com>
+ * Copyright (C) 2015-2017 Matias Bjørling <matias@cnexlabs.com>
+ * Copyright (C) 2015-2017 Simon A. F. Lund <slund@cnexlabs.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <liblightnvm.h>
+#include <nvm_dev.h>
+#include <nvm_sq.h>
+#include <nvm_sched.h>
+#include <nvm_debug.h>
+
+/**
+ * An address of a request placed in a combined command
+ */
+struct nvm_sq_ent {
+	struct nvm_sq_req *req;		///< Request of the address
+	int idx;			///< Index of the address in the request
+};
+
+/**
+ * A combined vector command
+ */
+struct nvm_sq_cmd {
+	uint16_t opcode;
+	uint16_t flags;
+	int io_class;
+	int bgn;			///< First entry of the command
+	int naddrs;			///< # of entries of the command
+};
+
+struct nvm_sq *nvm_sq_create(int flags, int window_us)
+{
+	struct nvm_sq *sq;
+
+	sq = calloc(1, sizeof(*sq));
+	if (!sq) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	sq->flags = flags;
+	sq->window_us = window_us;
+
+	if (pthread_mutex_init(&sq->lock, NULL)) {
+		free(sq);
+		errno = ENOMEM;
+		return NULL;
+	}
+	if (pthread_cond_init(&sq->cond, NULL)) {
+		pthread_mutex_destroy(&sq->lock);
+		free(sq);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	return sq;
+}
+
+void nvm_sq_destroy(struct nvm_sq *sq)
+{
+	if (!sq)
+		return;
+
+	pthread_cond_destroy(&sq->cond);
+	pthread_mutex_destroy(&sq->lock);
+	free(sq);
+}
+
+int nvm_sq_accepts(struct nvm_sq *sq, uint16_t opcode, int naddrs)
+{
+	if (!sq || (naddrs < 1) || (naddrs >= NVM_NADDR_MAX))
+		return 0;
+
+	switch (opcode) {
+	case NVM_S12_OPC_ERASE:
+	case NVM_S12_OPC_WRITE:
+	case NVM_S12_OPC_READ:
+		return 1;
+
+	default:
+		return 0;
+	}
+}
+
+static inline uint16_t nvm_sq_pmode_flag(const struct nvm_geo *geo)
+{
+	switch (geo->nplanes) {
+	case 4:
+		return NVM_FLAG_PMODE_QUAD;
+	case 2:
+		return NVM_FLAG_PMODE_DUAL;
+
+	default:
+		return NVM_FLAG_PMODE_SNGL;
+	}
+}
+
+/**
+ * Whether the request addresses a single plane of a single page (or block for
+ * erase), in sector order, and can thus form a multi-plane group with requests
+ * addressing the other planes
+ *
+ * @returns The plane of the request, -1 when it cannot be combined
+ */
+static int nvm_sq_req_plane(const struct nvm_geo *geo,
+			    const struct nvm_sq_req *req)
+{
+	const int nsectors = req->opcode == NVM_S12_OPC_ERASE ? 1 : geo->nsectors;
+
+	if (req->flags & (NVM_FLAG_PMODE_DUAL | NVM_FLAG_PMODE_QUAD))
+		return -1;
+	if (req->naddrs != nsectors)
+		return -1;
+
+	for (int i = 0; i < req->naddrs; ++i) {
+		struct nvm_addr a = req->addrs[i];
+
+		if ((a.g.ch != req->addrs[0].g.ch) ||
+		    (a.g.lun != req->addrs[0].g.lun) ||
+		    (a.g.pl != req->addrs[0].g.pl) ||
+		    (a.g.blk != req->addrs[0].g.blk) ||
+		    (a.g.pg != req->addrs[0].g.pg) ||
+		    ((req->opcode != NVM_S12_OPC_ERASE) && (a.g.sec != i)))
+			return -1;
+	}
+
+	return req->addrs[0].g.pl;
+}
+
+/**
+ * Whether two plane requests belong to the same multi-plane group
+ */
+static int nvm_sq_req_peers(const struct nvm_sq_req *a,
+			    const struct nvm_sq_req *b)
+{
+	return (a->opcode == b->opcode) && (a->flags == b->flags) &&
+	       (a->io_class == b->io_class) &&
+	       (a->addrs[0].g.ch == b->addrs[0].g.ch) &&
+	       (a->addrs[0].g.lun == b->addrs[0].g.lun) &&
+	       (a->addrs[0].g.blk == b->addrs[0].g.blk) &&
+	       ((a->opcode == NVM_S12_OPC_ERASE) ||
+		(a->addrs[0].g.pg == b->addrs[0].g.pg));
+}
+
+static void nvm_sq_ents_add(struct nvm_sq_ent *ents, int *nents,
+			    struct nvm_sq_req *req)
+{
+	for (int i = 0; i < req->naddrs; ++i) {
+		ents[*nents].req = req;
+		ents[*nents].idx = i;
+		++(*nents);
+	}
+}
+
+/**
+ * Form the commands of the given requests, requests addressing the individual
+ * planes of a page are combined into one multi-plane command when
+ * NVM_SQ_PMODE is enabled, other requests form a command each
+ *
+ * @returns The number of commands
+ */
+static int nvm_sq_form(struct nvm_dev *dev, struct nvm_sq *sq,
+		       struct nvm_sq_req **reqs, int nreqs,
+		       struct nvm_sq_ent *ents, struct nvm_sq_cmd *cmds)
+{
+	const struct nvm_geo *geo = &dev->geo;
+	const int NPLANES = geo->nplanes;
+	int used[nreqs];
+	int planes[nreqs];
+	int nents = 0;
+	int ncmds = 0;
+
+	for (int r = 0; r < nreqs; ++r) {
+		used[r] = 0;
+		planes[r] = -1;
+		if ((sq->flags & NVM_SQ_PMODE) && (NPLANES > 1))
+			planes[r] = nvm_sq_req_plane(geo, reqs[r]);
+	}
+
+	for (int r = 0; r < nreqs; ++r) {
+		int group[NPLANES];
+		int ngroup = 0;
+
+		if (used[r])
+			continue;
+
+		for (int pl = 0; pl < NPLANES; ++pl)
+			group[pl] = -1;
+
+		if (planes[r] >= 0) {			// Find the other planes
+			group[planes[r]] = r;
+			ngroup = 1;
+
+			for (int o = r + 1; (o < nreqs) && (ngroup < NPLANES); ++o) {
+				if (used[o] || (planes[o] < 0) ||
+				    (group[planes[o]] >= 0) ||
+				    !nvm_sq_req_peers(reqs[r], reqs[o]))
+					continue;
+
+				group[planes[o]] = o;
+				++ngroup;
+			}
+		}
+
+		cmds[ncmds].opcode = reqs[r]->opcode;
+		cmds[ncmds].flags = reqs[r]->flags;
+		cmds[ncmds].io_class = reqs[r]->io_class;
+		cmds[ncmds].bgn = nents;
+
+		if (ngroup == NPLANES) {		// Multi-plane command
+			for (int pl = 0; pl < NPLANES; ++pl) {
+				used[group[pl]] = 1;
+				nvm_sq_ents_add(ents, &nents, reqs[group[pl]]);
+			}
+			cmds[ncmds].flags |= nvm_sq_pmode_flag(geo);
+		} else {
+			used[r] = 1;
+			nvm_sq_ents_add(ents, &nents, reqs[r]);
+		}
+
+		cmds[ncmds].naddrs = nents - cmds[ncmds].bgn;
+		++ncmds;
+	}
+
+	return ncmds;
+}
+
+static inline int nvm_sq_naddrs_max(struct nvm_dev *dev, uint16_t opcode)
+{
+	switch (opcode) {
+	case NVM_S12_OPC_ERASE:
+		return dev->erase_naddrs_max;
+	case NVM_S12_OPC_WRITE:
+		return dev->write_naddrs_max;
+
+	default:
+		return dev->read_naddrs_max;
+	}
+}
+
+/**
+ * Merge the formed commands, with equal opcode, flags and I/O class, into
+ * shared vector commands of up to the maximum # of addresses for the opcode.
+ * Commands are merged whole, thus multi-plane groups are kept intact, and in
+ * order of arrival.
+ *
+ * @returns The number of merged commands
+ */
+static int nvm_sq_merge(struct nvm_dev *dev, const struct nvm_sq_cmd *units,
+			int nunits, const struct nvm_sq_ent *ents,
+			struct nvm_sq_cmd *cmds, struct nvm_sq_ent *merged)
+{
+	int owner[nunits];
+	int fill[nunits];
+	int ncmds = 0;
+	int nents = 0;
+
+	for (int u = 0; u < nunits; ++u) {
+		const int max = nvm_sq_naddrs_max(dev, units[u].opcode);
+		int c;
+
+		for (c = 0; c < ncmds; ++c) {
+			if ((cmds[c].opcode == units[u].opcode) &&
+			    (cmds[c].flags == units[u].flags) &&
+			    (cmds[c].io_class == units[u].io_class) &&
+			    (cmds[c].naddrs + units[u].naddrs <= max))
+				break;
+		}
+		if (c == ncmds) {
+			cmds[c].opcode = units[u].opcode;
+			cmds[c].flags = units[u].flags;
+			cmds[c].io_class = units[u].io_class;
+			cmds[c].naddrs = 0;
+			++ncmds;
+		}
+
+		cmds[c].naddrs += units[u].naddrs;
+		owner[u] = c;
+	}
+
+	for (int c = 0; c < ncmds; ++c) {
+		cmds[c].bgn = nents;
+		nents += cmds[c].naddrs;
+		fill[c] = 0;
+	}
+
+	for (int u = 0; u < nunits; ++u) {
+		const int c = owner[u];
+
+		memcpy(merged + cmds[c].bgn + fill[c], ents + units[u].bgn,
+		       sizeof(*ents) * units[u].naddrs);
+		fill[c] += units[u].naddrs;
+	}
+
+	return ncmds;
+}
+
+/**
+ * Issue a combined command and split its completion back onto the requests
+ */
+static void nvm_sq_cmd_issue(struct nvm_dev *dev, struct nvm_sq_cmd *cmd,
+			     struct nvm_sq_ent *ents)
+{
+	const struct nvm_geo *geo = &dev->geo;
+	const int WRITE = cmd->opcode == NVM_S12_OPC_WRITE;
+	const int naddrs = cmd->naddrs;
+	struct nvm_sq_ent *ent = ents + cmd->bgn;
+	struct nvm_sq_req *req = ent[0].req;
+	struct nvm_addr addrs[naddrs];
+	struct nvm_ret ret = {0,0};
+	char *data = NULL, *meta = NULL;
+	int has_data = 0, has_meta = 0;
+	int direct = 1;
+	ssize_t err;
+
+	for (int i = 0; i < naddrs; ++i) {
+		if ((ent[i].req != req) || (ent[i].idx != i))
+			direct = 0;
+		has_data |= ent[i].req->data != NULL;
+		has_meta |= ent[i].req->meta != NULL;
+		addrs[i] = ent[i].req->addrs[ent[i].idx];
+	}
+	direct = direct && (naddrs == req->naddrs) && (cmd->flags == req->flags);
+
+	if (direct) {				// The command is the request
+		err = nvm_addr_cmd_issue(dev, req->addrs, req->naddrs,
+					 req->data, req->meta, req->flags,
+					 req->opcode, &req->ret);
+		req->err = err ? (errno ? errno : EIO) : 0;
+		return;
+	}
+
+	if (has_data)
+		data = nvm_buf_alloc(geo, naddrs * geo->sector_nbytes);
+	if (has_meta)
+		meta = nvm_buf_alloc(geo, naddrs * geo->meta_nbytes);
+	if ((has_data && !data) || (has_meta && !meta)) {
+		for (int i = 0; i < naddrs; ++i)
+			ent[i].req->err = ENOMEM;
+		nvm_buf_free(data);
+		nvm_buf_free(meta);
+		return;
+	}
+	if (meta)
+		memset(meta, 0, naddrs * geo->meta_nbytes);
+
+	for (int i = 0; WRITE && (i < naddrs); ++i) {	// Gather
+		const struct nvm_sq_req *r = ent[i].req;
+
+		if (r->data)
+			memcpy(data + i * geo->sector_nbytes,
+			       r->data + ent[i].idx * geo->sector_nbytes,
+			       geo->sector_nbytes);
+		if (r->meta)
+			memcpy(meta + i * geo->meta_nbytes,
+			       r->meta + ent[i].idx * geo->meta_nbytes,
+			       geo->meta_nbytes);
+	}
+
+	err = nvm_addr_cmd_issue(dev, addrs, naddrs, data, meta, cmd->flags,
+				 cmd->opcode, &ret);
+	if (err)
+		err = errno ? errno : EIO;
+
+	for (int i = 0; i < naddrs; ++i) {	// Split the completion
+		struct nvm_sq_req *r = ent[i].req;
+
+		if (!WRITE && r->data)
+			memcpy(r->data + ent[i].idx * geo->sector_nbytes,
+			       data + i * geo->sector_nbytes,
+			       geo->sector_nbytes);
+		if (!WRITE && r->meta)
+			memcpy(r->meta + ent[i].idx * geo->meta_nbytes,
+			       meta + i * geo->meta_nbytes,
+			       geo->meta_nbytes);
+
+		r->ret.result |= ret.result;
+		if (!err || !((ret.status >> i) & 1))
+			continue;
+
+		r->ret.status |= 1ULL << ent[i].idx;
+		r->err = err;
+	}
+
+	nvm_buf_free(data);
+	nvm_buf_free(meta);
+}
+
+/**
+ * Form and issue the commands of a batch of requests
+ */
+static void nvm_sq_flush(struct nvm_dev *dev, struct nvm_sq *sq,
+			 struct nvm_sq_req *batch)
+{
+	struct nvm_sq_req **reqs = NULL;
+	struct nvm_sq_ent *ents = NULL;
+	struct nvm_sq_cmd *cmds = NULL;
+	struct nvm_sq_ent *issue_ents;
+	struct nvm_sq_cmd *issue_cmds;
+	int nreqs = 0, naddrs = 0, ncmds;
+
+	for (struct nvm_sq_req *r = batch; r; r = r->next) {
+		++nreqs;
+		naddrs += r->naddrs;
+	}
+
+	reqs = malloc(sizeof(*reqs) * nreqs);
+	ents = malloc(sizeof(*ents) * naddrs * 2);
+	cmds = malloc(sizeof(*cmds) * nreqs * 2);
+	if (!reqs || !ents || !cmds) {
+		for (struct nvm_sq_req *r = batch; r; r = r->next)
+			r->err = ENOMEM;
+		goto exit;
+	}
+
+	nreqs = 0;
+	for (struct nvm_sq_req *r = batch; r; r = r->next)
+		reqs[nreqs++] = r;
+
+	ncmds = nvm_sq_form(dev, sq, reqs, nreqs, ents, cmds);
+	issue_ents = ents;
+	issue_cmds = cmds;
+
+	if ((sq->flags & NVM_SQ_MERGE) && (ncmds > 1)) {
+		issue_ents = ents + naddrs;		// Second halves
+		issue_cmds = cmds + nreqs;
+		ncmds = nvm_sq_merge(dev, cmds, ncmds, ents, issue_cmds,
+				     issue_ents);
+	}
+
+	NVM_DEBUG("nreqs(%d), ncmds(%d)", nreqs, ncmds);
+
+	for (int c = 0; c < ncmds; ++c) {	// Charged to the callers' class
+		const int io_class = nvm_sched_io_class_set(
+						issue_cmds[c].io_class);
+
+		nvm_sq_cmd_issue(dev, &issue_cmds[c], issue_ents);
+		nvm_sched_io_class_set(io_class);
+	}
+
+exit:
+	free(reqs);
+	free(ents);
+	free(cmds);
+}
+
+ssize_t nvm_sq_submit(struct nvm_dev *dev, struct nvm_addr addrs[], int naddrs,
+		      void *data, void *meta, uint16_t flags, uint16_t opcode,
+		      struct nvm_ret *ret)
+{
+	struct nvm_sq *sq = dev->sq;
+	struct nvm_sq_req req = {
+		.addrs = addrs, .naddrs = naddrs, .data = data, .meta = meta,
+		.flags = flags, .opcode = opcode,
+		.io_class = nvm_sched_io_class_get(dev), .ret = {0,0}, .err = 0,
+		.done = 0, .next = NULL
+	};
+
+	pthread_mutex_lock(&sq->lock);
+
+	if (sq->tail)					// Enqueue
+		sq->tail->next = &req;
+	else
+		sq->head = &req;
+	sq->tail = &req;
+	sq->nqueued += naddrs;
+
+	if (sq->leader) {				// Follow
+		if (sq->nqueued >= NVM_NADDR_MAX)
+			pthread_cond_broadcast(&sq->cond);
+
+		while (!req.done)
+			pthread_cond_wait(&sq->cond, &sq->lock);
+
+		pthread_mutex_unlock(&sq->lock);
+	} else {					// Lead
+		struct nvm_sq_req *batch;
+		struct timespec deadline;
+
+		sq->leader = 1;
+
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += sq->window_us * 1000L;
+		deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+
+		while (sq->nqueued < NVM_NADDR_MAX) {
+			if (pthread_cond_timedwait(&sq->cond, &sq->lock,
+						   &deadline) == ETIMEDOUT)
+				break;
+		}
+
+		batch = sq->head;
+		sq->head = sq->tail = NULL;
+		sq->nqueued = 0;
+		sq->leader = 0;
+
+		pthread_mutex_unlock(&sq->lock);
+
+		nvm_sq_flush(dev, sq, batch);
+
+		pthread_mutex_lock(&sq->lock);
+		for (struct nvm_sq_req *r = batch; r; ) {
+			struct nvm_sq_req *next = r->next;
+
+			r->done = 1;
+			r = next;
+		}
+		pthread_cond_broadcast(&sq->cond);
+		pthread_mutex_unlock(&sq->lock);
+	}
+
+	if (ret)
+		*ret = req.ret;
+	if (req.err) {
+		errno = req.err;
+		return -1;
+	}
+
+	return 0;
+}
@@ -28,17 +28,26 @@
  */
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
+#include <time.h>
+#include <sys/uio.h>
 #include <liblightnvm.h>
 #include <nvm_dev.h>
 #include <nvm_vblk.h>
+#include <nvm_sched.h>
 #include <nvm_omp.h>
 #include <nvm_utils.h>
+#include <nvm_debug.h>
 
 static inline int NVM_MIN(int x, int y) {
 	return x < y ? x : y;
 }
 
+static inline size_t NVM_MIN_SZ(size_t x, size_t y) {
+	return x < y ? x : y;
+}
+
 struct nvm_vblk* nvm_vblk_alloc(struct nvm_dev *dev, struct nvm_addr addrs[],
 				int naddrs)
 {
@@ -76,327 +85,2519 @@ struct nvm_vblk* nvm_vblk_alloc(struct nvm_dev *dev, struct nvm_addr addrs[],
 	vblk->dev = dev;
 	vblk->pos_write = 0;
 	vblk->pos_read = 0;
+	vblk->wbuf = NULL;
+	vblk->wbuf_len = 0;
+	vblk->ra = NULL;
+	vblk->layout = NVM_VBLK_LAYOUT_PAGE;
+	vblk->width = 0;		// All members, see _vblk_width
+	vblk->io_class = nvm_dev_get_io_class(dev);
+	vblk->parity = 0;
+	vblk->pblk.ppa = 0;
+	vblk->hedge = NULL;
+	vblk->chunked = 0;
 	vblk->nbytes = vblk->nblks * geo->nplanes * geo->npages *
 		       geo->nsectors * geo->sector_nbytes;
 
 	return vblk;
 }
 
-struct nvm_vblk *nvm_vblk_alloc_line(struct nvm_dev *dev, int ch_bgn,
-				     int ch_end, int lun_bgn, int lun_end,
-				     int blk)
+struct nvm_vblk *nvm_vblk_alloc_chunks(struct nvm_dev *dev,
+				       struct nvm_addr chunks[], int nchunks)
 {
 	struct nvm_vblk *vblk;
-	const struct nvm_geo *geo = nvm_dev_get_geo(dev);
-	
-	vblk = nvm_vblk_alloc(dev, NULL, 0);
-	if (!vblk)
-		return NULL;	// Propagate errno
 
-	for (int lun = lun_bgn; lun <= lun_end; ++lun) {
-		for (int ch = ch_bgn; ch <= ch_end; ++ch) {
-			vblk->blks[vblk->nblks].ppa = 0;
-			vblk->blks[vblk->nblks].g.ch = ch;
-			vblk->blks[vblk->nblks].g.lun = lun;
-			vblk->blks[vblk->nblks].g.blk = blk;
-			++(vblk->nblks);
+	for (int i = 0; i < nchunks; ++i) {
+		struct nvm_spec_chunk chunk;
+
+		if (nvm_chunk_get(dev, chunks[i], &chunk, NULL))
+			return NULL;		// Propagate errno
+
+		if (chunk.cs == NVM_S20_CHUNK_OFFLINE) {
+			errno = EIO;
+			return NULL;
 		}
 	}
 
-	vblk->nbytes = vblk->nblks * geo->nplanes * geo->npages *
-		       geo->nsectors * geo->sector_nbytes;
+	vblk = nvm_vblk_alloc(dev, chunks, nchunks);
+	if (!vblk)
+		return NULL;			// Propagate errno
+
+	vblk->chunked = 1;
+
+	if (nvm_vblk_recover_pos(vblk) < 0) {
+		nvm_vblk_free(vblk);
+		return NULL;			// Propagate errno
+	}
 
 	return vblk;
 }
 
-void nvm_vblk_free(struct nvm_vblk *vblk)
+/**
+ * Check and apply the given layout and stripe width to the vblk
+ */
+static int _vblk_set_layout(struct nvm_vblk *vblk, int layout, int width)
 {
-	free(vblk);
-}
+	switch (layout & ~NVM_VBLK_LAYOUT_LUN_FIRST) {
+	case NVM_VBLK_LAYOUT_PAGE:
+		break;
+	case NVM_VBLK_LAYOUT_BLOCK:
+		width = 1;
+		break;
+
+	default:
+		errno = EINVAL;
+		return -1;
+	}
 
-static inline int _cmd_nblks(int nblks, int cmd_nblks_max)
-{
-	int cmd_nblks = cmd_nblks_max;
+	if ((width < 0) || (width > vblk->nblks) ||
+	    (width && (vblk->nblks % width))) {
+		errno = EINVAL;
+		return -1;
+	}
 
-	while(nblks % cmd_nblks && cmd_nblks > 1) --cmd_nblks;
+	vblk->layout = layout;
+	vblk->width = width;
 
-	return cmd_nblks;
+	return 0;
 }
 
-ssize_t nvm_vblk_erase(struct nvm_vblk *vblk)
+struct nvm_vblk *nvm_vblk_alloc_layout(struct nvm_dev *dev,
+				       struct nvm_addr addrs[], int naddrs,
+				       int layout, int width)
 {
-	size_t nerr = 0;
-	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+	struct nvm_vblk *vblk = nvm_vblk_alloc(dev, addrs, naddrs);
 
-	const int BLK_NADDRS = geo->nplanes;
-	const int CMD_NBLKS = _cmd_nblks(vblk->nblks,
-				vblk->dev->erase_naddrs_max / BLK_NADDRS);
-	//const int NTHREADS = vblk->nblks < CMD_NBLKS ? 1 : vblk->nblks / CMD_NBLKS;
-	const int NTHREADS = 1;
+	if (!vblk)
+		return NULL;	// Propagate errno
 
-	#pragma omp parallel for num_threads(NTHREADS) schedule(static,1) reduction(+:nerr) ordered if (NTHREADS>1)
-	for (int off = 0; off < vblk->nblks; off += CMD_NBLKS) {
-		ssize_t err;
-		struct nvm_ret ret = {0,0};
+	if (_vblk_set_layout(vblk, layout, width)) {
+		nvm_vblk_free(vblk);
+		return NULL;	// Propagate errno
+	}
 
-		const int nblks = NVM_MIN(CMD_NBLKS, vblk->nblks - off);
-		const int naddrs = nblks * BLK_NADDRS;
+	return vblk;
+}
 
-		struct nvm_addr addrs[naddrs];
+struct nvm_vblk *nvm_vblk_alloc_line_layout(struct nvm_dev *dev, int ch_bgn,
+					    int ch_end, int lun_bgn,
+					    int lun_end, int blk, int layout,
+					    int width)
+{
+	struct nvm_vblk *vblk;
+	const struct nvm_geo *geo = nvm_dev_get_geo(dev);
+	const int nchs = ch_end - ch_bgn + 1;
+	const int nluns = lun_end - lun_bgn + 1;
 
-		for (int i = 0; i < naddrs; ++i) {
-			const int idx = off + (i / BLK_NADDRS);
+	if ((nchs < 1) || (nluns < 1) || (nchs * nluns > 128)) {
+		errno = EINVAL;
+		return NULL;
+	}
+	
+	vblk = nvm_vblk_alloc(dev, NULL, 0);
+	if (!vblk)
+		return NULL;	// Propagate errno
 
-			addrs[i].ppa = vblk->blks[idx].ppa;
-			addrs[i].g.pl = i % geo->nplanes;
-		}
+	// Channel-first: consecutive members on different channels, LUN-first:
+	// consecutive members on different LUNs of the same channel
+	for (int i = 0; i < nchs * nluns; ++i) {
+		int ch = ch_bgn + (i % nchs);
+		int lun = lun_bgn + (i / nchs);
 
-		err = nvm_addr_erase(vblk->dev, addrs, naddrs, 0, &ret);
-		if (err)
-			++nerr;
+		if (layout & NVM_VBLK_LAYOUT_LUN_FIRST) {
+			ch = ch_bgn + (i / nluns);
+			lun = lun_bgn + (i % nluns);
+		}
 
-		#pragma omp ordered
-		{}
+		vblk->blks[vblk->nblks].ppa = 0;
+		vblk->blks[vblk->nblks].g.ch = ch;
+		vblk->blks[vblk->nblks].g.lun = lun;
+		vblk->blks[vblk->nblks].g.blk = blk;
+		++(vblk->nblks);
 	}
 
-	if (nerr) {
-		errno = EIO;
-		return -1;
-	}
+	vblk->nbytes = vblk->nblks * geo->nplanes * geo->npages *
+		       geo->nsectors * geo->sector_nbytes;
 
-	vblk->pos_write = 0;
-	vblk->pos_read = 0;
+	if (_vblk_set_layout(vblk, layout, width)) {
+		nvm_vblk_free(vblk);
+		return NULL;	// Propagate errno
+	}
 
-	return vblk->nbytes;
+	return vblk;
 }
 
-static inline int _cmd_nspages(int nblks, int cmd_nspages_max)
+struct nvm_vblk *nvm_vblk_alloc_placed(struct nvm_dev *dev, int nluns,
+				       int blk)
 {
-	int cmd_nspages = cmd_nspages_max;
-
-	while(nblks % cmd_nspages && cmd_nspages > 1) --cmd_nspages;
+	struct nvm_addr addrs[128];
 
-	return cmd_nspages;
-}
+	if ((nluns < 1) || (nluns > 128)) {
+		errno = EINVAL;
+		return NULL;
+	}
 
-ssize_t nvm_vblk_pwrite(struct nvm_vblk *vblk, const void *buf, size_t count,
-			size_t offset)
-{
-	size_t nerr = 0;
-	const int PMODE = nvm_dev_get_pmode(vblk->dev);
-	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+	if (nvm_dev_place_luns(dev, addrs, nluns))
+		return NULL;	// Propagate errno
 
-	const int SPAGE_NADDRS = geo->nplanes * geo->nsectors;
-	const int CMD_NSPAGES = _cmd_nspages(vblk->nblks,
-				vblk->dev->write_naddrs_max / SPAGE_NADDRS);
+	for (int i = 0; i < nluns; ++i)
+		addrs[i].g.blk = blk;
 
-	const int ALIGN = SPAGE_NADDRS * geo->sector_nbytes;
-	const int NTHREADS = vblk->nblks < CMD_NSPAGES ? 1 : vblk->nblks / CMD_NSPAGES;
+	return nvm_vblk_alloc(dev, addrs, nluns);
+}
 
-	const size_t bgn = offset / ALIGN;
-	const size_t end = bgn + (count / ALIGN);
+struct nvm_vblk *nvm_vblk_alloc_line(struct nvm_dev *dev, int ch_bgn,
+				     int ch_end, int lun_bgn, int lun_end,
+				     int blk)
+{
+	return nvm_vblk_alloc_line_layout(dev, ch_bgn, ch_end, lun_bgn,
+					  lun_end, blk, NVM_VBLK_LAYOUT_PAGE,
+					  0);
+}
 
-	char *padding_buf = NULL;
+void nvm_vblk_free(struct nvm_vblk *vblk)
+{
+	if (!vblk)
+		return;
 
-	const size_t meta_tbytes = CMD_NSPAGES * SPAGE_NADDRS * geo->meta_nbytes;
-	char *meta = NULL;
+	nvm_vblk_set_readahead(vblk, 0);
+	nvm_vblk_set_hedge(vblk, 0);
+	nvm_buf_free(vblk->wbuf);
+	free(vblk);
+}
 
-	if (offset + count > vblk->nbytes) {		// Check bounds
+static inline ssize_t _addr_cmd(struct nvm_dev *dev, uint16_t opcode,
+				struct nvm_addr addrs[], int naddrs, char *data,
+				char *meta, uint16_t flags, struct nvm_ret *ret)
+{
+	switch (opcode) {
+	case NVM_S12_OPC_ERASE:
+		return nvm_addr_erase(dev, addrs, naddrs, flags, ret);
+	case NVM_S12_OPC_WRITE:
+		return nvm_addr_write(dev, addrs, naddrs, data, meta, flags, ret);
+	case NVM_S12_OPC_READ:
+		return nvm_addr_read(dev, addrs, naddrs, data, meta, flags, ret);
+
+	default:
 		errno = EINVAL;
 		return -1;
 	}
+}
 
-	if ((count % ALIGN) || (offset % ALIGN)) {	// Check align
-		errno = EINVAL;
-		return -1;
-	}
+/**
+ * Whether a failed command is worth re-submitting, that is, the error is not
+ * flagged "Do Not Retry" and is not an empty page
+ */
+static inline int _cmd_retryable(const struct nvm_ret *ret)
+{
+	if (errno != EIO)
+		return 0;
+	if (ret->result & NVM_S12_STATUS_DNR)
+		return 0;
+	if ((ret->result & ~NVM_S12_STATUS_DNR) == NVM_S12_STATUS_EMPTY_PAGE)
+		return 0;
+
+	return 1;
+}
 
-	if (!buf) {	// Allocate and use a padding buffer
-		const size_t nbytes = CMD_NSPAGES * SPAGE_NADDRS * geo->sector_nbytes;
+/**
+ * Whether the given addresses must be erased together, that is, they address
+ * the same block of a LUN
+ */
+static inline int _cmd_same_blk(struct nvm_addr a, struct nvm_addr b)
+{
+	return (a.g.ch == b.g.ch) && (a.g.lun == b.g.lun) &&
+	       (a.g.blk == b.g.blk);
+}
 
-		padding_buf = nvm_buf_alloc(geo, nbytes);
-		if (!padding_buf) {
-			errno = ENOMEM;
-			return -1;
+/**
+ * Submit the given command, on error, re-submit the addresses reported as
+ * failed in the completion bitmap, at most `dev->nretries` times
+ *
+ * Reads re-submit the failed addresses only, in single-plane mode, data and
+ * meta are scattered from bounce buffers. Erases re-submit every address of a
+ * block with a failed address, in the plane-mode of the command, as an erase
+ * must cover all planes of the block. Writes are not re-submitted, a page
+ * cannot be programmed twice without an erase, the failure is returned for the
+ * caller to relocate the data.
+ *
+ * On error, `status`, when given, is set to the addresses still failed, one
+ * bit per address of the first 64
+ */
+static ssize_t _cmd_retry_status(struct nvm_vblk *vblk, uint16_t opcode,
+				 struct nvm_addr addrs[], int naddrs,
+				 char *data, char *meta, uint16_t flags,
+				 uint64_t *status)
+{
+	struct nvm_dev *dev = vblk->dev;
+	const struct nvm_geo *geo = nvm_dev_get_geo(dev);
+	const int io_class = nvm_sched_io_class_set(vblk->io_class);
+	const int GROUPED = opcode == NVM_S12_OPC_ERASE;
+	const uint16_t rflags = GROUPED ? flags :
+		flags & ~(NVM_FLAG_PMODE_DUAL | NVM_FLAG_PMODE_QUAD);
+	struct nvm_ret ret = {0,0};
+	struct nvm_addr raddrs[naddrs];
+	int ridx[naddrs];
+	uint8_t failed[naddrs];
+	int nretry = naddrs;
+	char *rdata = NULL;
+	char *rmeta = NULL;
+	ssize_t err;
+
+	err = _addr_cmd(dev, opcode, addrs, naddrs, data, meta, flags, &ret);
+
+	for (int i = 0; i < naddrs; ++i)
+		ridx[i] = i;
+
+	for (int attempt = 0; err && attempt < dev->nretries; ++attempt) {
+		int n = 0;
+
+		if ((opcode == NVM_S12_OPC_WRITE) || !_cmd_retryable(&ret))
+			break;
+
+		memset(failed, 0, sizeof(failed));
+		for (int i = 0; i < nretry; ++i) {	// Past bit 63: all or none
+			if ((i < 64) ? (ret.status >> i) & 1 :
+				       ret.status == ~0ULL)
+				failed[ridx[i]] = 1;
 		}
-		nvm_buf_fill(padding_buf, nbytes);
-	}
 
-	if (vblk->dev->meta_mode != NVM_META_MODE_NONE) {	// Meta
-		meta = nvm_buf_alloc(geo, meta_tbytes);		// Alloc buf
-		if (!meta) {
-			errno = ENOMEM;
-			return -1;
+		for (int i = 0; i < naddrs; ++i) {	// Keep the failed groups
+			int keep = failed[i];
+
+			for (int j = 0; GROUPED && !keep && (j < naddrs); ++j)
+				keep = failed[j] &&
+				       _cmd_same_blk(addrs[i], addrs[j]);
+			if (keep)
+				ridx[n++] = i;
 		}
+		nretry = n;
 
-		switch(vblk->dev->meta_mode) {			// Fill it
-			case NVM_META_MODE_ALPHA:
-				nvm_buf_fill(meta, meta_tbytes);
-				break;
-			case NVM_META_MODE_CONST:
-				for (size_t i = 0; i < meta_tbytes; ++i)
-					meta[i] = 65 + (meta_tbytes % 20);
+		if (data && !rdata) {
+			rdata = nvm_buf_alloc(geo, naddrs * geo->sector_nbytes);
+			if (!rdata) {
+				ret.status = ~0ULL;	// Kept failed
+				errno = ENOMEM;
 				break;
-			case NVM_META_MODE_NONE:
+			}
+		}
+		if (meta && !rmeta) {
+			rmeta = nvm_buf_alloc(geo, naddrs * geo->meta_nbytes);
+			if (!rmeta) {
+				ret.status = ~0ULL;	// Kept failed
+				errno = ENOMEM;
 				break;
+			}
 		}
-	}
-
-	#pragma omp parallel for num_threads(NTHREADS) schedule(static,1) reduction(+:nerr) ordered if(NTHREADS>1)
-	for (size_t off = bgn; off < end; off += CMD_NSPAGES) {
-		struct nvm_ret ret = {0,0};
 
-		const int nspages = NVM_MIN(CMD_NSPAGES, (int)(end - off));
-		const int naddrs = nspages * SPAGE_NADDRS;
+		for (int i = 0; i < nretry; ++i)
+			raddrs[i] = addrs[ridx[i]];
 
-		struct nvm_addr addrs[naddrs];
-		const char *buf_off;
+		NVM_DEBUG("retry: attempt(%d), nretry(%d)", attempt, nretry);
 
-		if (padding_buf)
-			buf_off = padding_buf;
-		else
-			buf_off = (const char*)buf + (off - bgn) * geo->sector_nbytes * SPAGE_NADDRS;
+		ret.status = 0;
+		ret.result = 0;
+		err = _addr_cmd(dev, opcode, raddrs, nretry, rdata, rmeta,
+				rflags, &ret);
 
-		for (int i = 0; i < naddrs; ++i) {
-			const int spg = off + (i / SPAGE_NADDRS);
-			const int idx = spg % vblk->nblks;
-			const int pg = (spg / vblk->nblks) % geo->npages;
+		for (int i = 0; (opcode == NVM_S12_OPC_READ) && (i < nretry); ++i) {
+			if (err && (i < 64) && ((ret.status >> i) & 1))
+				continue;			// Scatter
 
-			addrs[i].ppa = vblk->blks[idx].ppa;
-			addrs[i].g.pg = pg;
-			addrs[i].g.pl = (i / geo->nsectors) % geo->nplanes;
-			addrs[i].g.sec = i % geo->nsectors;
+			if (data)
+				memcpy(data + ridx[i] * geo->sector_nbytes,
+				       rdata + i * geo->sector_nbytes,
+				       geo->sector_nbytes);
+			if (meta)
+				memcpy(meta + ridx[i] * geo->meta_nbytes,
+				       rmeta + i * geo->meta_nbytes,
+				       geo->meta_nbytes);
 		}
+	}
 
-		const ssize_t err = nvm_addr_write(vblk->dev, addrs, naddrs,
-						   buf_off, meta, PMODE, &ret);
-		if (err)
-			++nerr;
-
-		#pragma omp ordered
-		{}
+	if (status)
+		*status = 0;
+	for (int i = 0; status && err && (i < nretry) && (ridx[i] < 64); ++i) {
+		if ((i < 64) ? (ret.status >> i) & 1 : ret.status == ~0ULL)
+			*status |= 1ULL << ridx[i];
 	}
 
-	nvm_buf_free(padding_buf);
-	nvm_buf_free(meta);
+	nvm_buf_free(rdata);
+	nvm_buf_free(rmeta);
 
-	if (nerr) {
-		errno = EIO;
-		return -1;
-	}
+	nvm_sched_io_class_set(io_class);
 
-	return count;
+	return err;
 }
 
-ssize_t nvm_vblk_write(struct nvm_vblk *vblk, const void *buf, size_t count)
+static inline ssize_t _cmd_retry(struct nvm_vblk *vblk, uint16_t opcode,
+				 struct nvm_addr addrs[], int naddrs,
+				 char *data, char *meta, uint16_t flags)
 {
-	ssize_t nbytes = nvm_vblk_pwrite(vblk, buf, count, vblk->pos_write);
-
-	if (nbytes < 0)
-		return nbytes;		// Propagate errno
-	
-	vblk->pos_write += nbytes;	// All is good, increment write position
-
-	return nbytes;			// Return number of bytes written
+	return _cmd_retry_status(vblk, opcode, addrs, naddrs, data, meta,
+				 flags, NULL);
 }
 
-ssize_t nvm_vblk_pad(struct nvm_vblk *vblk)
+static inline void _xor(char *dst, const char *src, size_t nbytes)
 {
-	return nvm_vblk_write(vblk, NULL, vblk->nbytes - vblk->pos_write);
+	for (size_t i = 0; i < nbytes; ++i)
+		dst[i] ^= src[i];
 }
 
-ssize_t nvm_vblk_pread(struct nvm_vblk *vblk, void *buf, size_t count,
-		       size_t offset)
+/**
+ * Find the member block of the vblk containing the given address
+ *
+ * @returns Index of the member, -1 when no member contains the address
+ */
+static inline int _vblk_member(const struct nvm_vblk *vblk,
+			       struct nvm_addr addr)
 {
-	size_t nerr = 0;
-	const int PMODE = nvm_dev_get_pmode(vblk->dev);
-	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
-
-	const int SPAGE_NADDRS = geo->nplanes * geo->nsectors;
-	const int CMD_NSPAGES = _cmd_nspages(vblk->nblks,
-				vblk->dev->read_naddrs_max / SPAGE_NADDRS);
+	for (int idx = 0; idx < vblk->nblks; ++idx) {
+		if ((vblk->blks[idx].g.ch == addr.g.ch) &&
+		    (vblk->blks[idx].g.lun == addr.g.lun) &&
+		    (vblk->blks[idx].g.blk == addr.g.blk))
+			return idx;
+	}
 
-	const int ALIGN = SPAGE_NADDRS * geo->sector_nbytes;
-	const int NTHREADS = vblk->nblks < CMD_NSPAGES ? 1 : vblk->nblks / CMD_NSPAGES;
+	return -1;
+}
 
-	const size_t bgn = offset / ALIGN;
-	const size_t end = bgn + (count / ALIGN);
+/**
+ * Reconstruct the given sectors of member blocks from the same sectors of all
+ * other members and of the parity block, see nvm_vblk_set_parity
+ *
+ * The peer sectors are read in single-plane mode and XOR'ed into `data`.
+ */
+static ssize_t _vblk_reconstruct(struct nvm_vblk *vblk, struct nvm_addr addrs[],
+				 int naddrs, char *data)
+{
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+	const int CMD_NADDRS = vblk->dev->read_naddrs_max;
+	const int NPEERS = vblk->nblks;		// The other members and parity
+	const size_t npeers = (size_t)naddrs * NPEERS;
+	int idx[naddrs];
+	char *buf;
 
-	if (offset + count > vblk->nbytes) {		// Check bounds
-		errno = EINVAL;
-		return -1;
+	for (int i = 0; i < naddrs; ++i) {
+		idx[i] = _vblk_member(vblk, addrs[i]);
+		if (idx[i] < 0) {
+			errno = EINVAL;
+			return -1;
+		}
 	}
 
-	if ((count % ALIGN) || (offset % ALIGN)) {	// Check align
-		errno = EINVAL;
+	buf = nvm_buf_alloc(geo, CMD_NADDRS * geo->sector_nbytes);
+	if (!buf) {
+		errno = ENOMEM;
 		return -1;
 	}
 
-	#pragma omp parallel for num_threads(NTHREADS) schedule(static,1) reduction(+:nerr) ordered if(NTHREADS>1)
-	for (size_t off = bgn; off < end; off += CMD_NSPAGES) {
-		struct nvm_ret ret = {0,0};
-
-		const int nspages = NVM_MIN(CMD_NSPAGES, (int)(end - off));
-		const int naddrs = nspages * SPAGE_NADDRS;
+	memset(data, 0, naddrs * geo->sector_nbytes);
 
-		struct nvm_addr addrs[naddrs];
-		char *buf_off;
+	for (size_t bgn = 0; bgn < npeers; bgn += CMD_NADDRS) {
+		const int n = NVM_MIN(CMD_NADDRS, (int)(npeers - bgn));
+		struct nvm_addr peers[n];
 
-		buf_off = (char*)buf + (off - bgn) * geo->sector_nbytes * SPAGE_NADDRS;
+		for (int j = 0; j < n; ++j) {
+			const int i = (bgn + j) / NPEERS;
+			const int peer = (bgn + j) % NPEERS;
 
-		for (int i = 0; i < naddrs; ++i) {
-			const int spg = off + (i / SPAGE_NADDRS);
-			const int idx = spg % vblk->nblks;
-			const int pg = (spg / vblk->nblks) % geo->npages;
+			if (peer == NPEERS - 1)
+				peers[j].ppa = vblk->pblk.ppa;
+			else if (peer < idx[i])
+				peers[j].ppa = vblk->blks[peer].ppa;
+			else
+				peers[j].ppa = vblk->blks[peer + 1].ppa;
 
-			addrs[i].ppa = vblk->blks[idx].ppa;
-			addrs[i].g.pg = pg;
-			addrs[i].g.pl = (i / geo->nsectors) % geo->nplanes;
-			addrs[i].g.sec = i % geo->nsectors;
+			peers[j].g.pg = addrs[i].g.pg;
+			peers[j].g.pl = addrs[i].g.pl;
+			peers[j].g.sec = addrs[i].g.sec;
 		}
 
-		const ssize_t err = nvm_addr_read(vblk->dev, addrs, naddrs,
-						  buf_off, NULL, PMODE, &ret);
-		if (err)
-			++nerr;
+		if (_cmd_retry(vblk, NVM_S12_OPC_READ, peers, n, buf, NULL,
+			       NVM_FLAG_PMODE_SNGL)) {
+			nvm_buf_free(buf);
+			errno = EIO;
+			return -1;
+		}
 
-		#pragma omp ordered
-		{}
+		for (int j = 0; j < n; ++j)
+			_xor(data + ((bgn + j) / NPEERS) * geo->sector_nbytes,
+			     buf + j * geo->sector_nbytes, geo->sector_nbytes);
 	}
 
-	if (nerr) {
-		errno = EIO;
-		return -1;
-	}
+	nvm_buf_free(buf);
 
-	return count;
+	return 0;
 }
 
-ssize_t nvm_vblk_read(struct nvm_vblk *vblk, void *buf, size_t count)
+/**
+ * Issue the reads queued to the slot of a member block, until stopped
+ */
+static void *_hedge_worker(void *arg)
 {
-	ssize_t nbytes = nvm_vblk_pread(vblk, buf, count, vblk->pos_read);
+	struct nvm_vblk_hedge_slot *slot = arg;
+	struct nvm_vblk_hedge *hedge = slot->hedge;
 
-	if (nbytes < 0)
-		return nbytes;		// Propagate `errno`
+	pthread_mutex_lock(&hedge->lock);
+	while (!hedge->stop || (slot->state == NVM_VBLK_HEDGE_QUEUED)) {
+		ssize_t err;
 
-	vblk->pos_read += nbytes;	// All is good, increment read position
+		if (slot->state != NVM_VBLK_HEDGE_QUEUED) {
+			pthread_cond_wait(&hedge->cond, &hedge->lock);
+			continue;
+		}
+		slot->state = NVM_VBLK_HEDGE_RUNNING;
+		pthread_mutex_unlock(&hedge->lock);
+
+		err = _cmd_retry(slot->vblk, NVM_S12_OPC_READ, slot->addrs,
+				 slot->naddrs, slot->buf, NULL, slot->flags);
+
+		pthread_mutex_lock(&hedge->lock);
+		slot->err = err;
+		slot->state = slot->abandoned ? NVM_VBLK_HEDGE_IDLE :
+						NVM_VBLK_HEDGE_DONE;
+		slot->abandoned = 0;
+		pthread_cond_broadcast(&hedge->cond);
+	}
+	pthread_mutex_unlock(&hedge->lock);
 
-	return nbytes;			// Return number of bytes read
+	return NULL;
 }
 
-struct nvm_addr *nvm_vblk_get_addrs(struct nvm_vblk *vblk)
+/**
+ * Copy the sectors of member `m`, read into `buf` in command order, to their
+ * place in `data`
+ */
+static inline void _hedge_scatter(const struct nvm_geo *geo, const int idx[],
+				  int naddrs, int m, const char *buf,
+				  char *data)
 {
-	return vblk->blks;
-}
+	for (int i = 0, j = 0; i < naddrs; ++i) {
+		if (idx[i] != m)
+			continue;
 
-int nvm_vblk_get_naddrs(struct nvm_vblk *vblk)
-{
-	return vblk->nblks;
+		memcpy(data + i * geo->sector_nbytes,
+		       buf + (j++) * geo->sector_nbytes, geo->sector_nbytes);
+	}
 }
 
-size_t nvm_vblk_get_nbytes(struct nvm_vblk *vblk)
+/**
+ * Read the sectors of each member block via the worker of the member, and
+ * reconstruct the sectors of the members which have not completed within the
+ * hedging threshold, or failed, from their peers. The first to finish
+ * provides the data, a late member read is left to complete in the
+ * background, or dropped when not yet issued.
+ *
+ * A member whose worker is still busy with an earlier read when the threshold
+ * passes is reconstructed without being read.
+ */
+static ssize_t _cmd_read_hedged(struct nvm_vblk *vblk, struct nvm_addr addrs[],
+				int naddrs, char *data, uint16_t flags)
 {
-	return vblk->nbytes;
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+	const size_t SECTOR_NBYTES = geo->sector_nbytes;
+	const int NBLKS = vblk->nblks;
+	struct nvm_vblk_hedge *hedge = vblk->hedge;
+	struct nvm_addr raddrs[naddrs];
+	int ridx[naddrs];
+	int idx[naddrs];
+	int nsecs[NBLKS];	// # of sectors of the command per member
+	int sent[NBLKS];	// Whether the member read went to its slot
+	int got[NBLKS];		// Whether the member's sectors are in `data`
+	struct timespec deadline;
+	int nmembers = 0;
+	int nrecon = 0;
+	char *rbuf = NULL;
+	ssize_t err = 0;
+
+	memset(nsecs, 0, sizeof(nsecs));
+	memset(sent, 0, sizeof(sent));
+	for (int i = 0; i < naddrs; ++i) {
+		idx[i] = _vblk_member(vblk, addrs[i]);
+		if (idx[i] < 0) {
+			errno = EINVAL;
+			return -1;
+		}
+		if (!nsecs[idx[i]]++)
+			++nmembers;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_nsec += (hedge->threshold_us % 1000000) * 1000L;
+	deadline.tv_sec += hedge->threshold_us / 1000000 +
+			   deadline.tv_nsec / 1000000000L;
+	deadline.tv_nsec %= 1000000000L;
+
+	pthread_mutex_lock(&hedge->lock);
+	for (;;) {			// Queue the member reads and wait
+		int nqueued = 0, ndone = 0;
+
+		for (int m = 0; m < NBLKS; ++m) {
+			struct nvm_vblk_hedge_slot *slot = &hedge->slots[m];
+
+			if (nsecs[m] && !sent[m] &&
+			    (slot->state == NVM_VBLK_HEDGE_IDLE)) {
+				slot->naddrs = 0;
+				for (int i = 0; i < naddrs; ++i) {
+					if (idx[i] == m)
+						slot->addrs[slot->naddrs++] =
+							addrs[i];
+				}
+				slot->flags = flags;
+				slot->state = NVM_VBLK_HEDGE_QUEUED;
+				sent[m] = 1;
+				++nqueued;
+			}
+			if (sent[m] && (slot->state == NVM_VBLK_HEDGE_DONE))
+				++ndone;
+		}
+		if (nqueued)
+			pthread_cond_broadcast(&hedge->cond);
+		if ((ndone == nmembers) ||
+		    (pthread_cond_timedwait(&hedge->cond, &hedge->lock,
+					    &deadline) == ETIMEDOUT))
+			break;
+	}
+	for (int m = 0; m < NBLKS; ++m)
+		got[m] = sent[m] &&
+			 (hedge->slots[m].state == NVM_VBLK_HEDGE_DONE) &&
+			 !hedge->slots[m].err;
+	pthread_mutex_unlock(&hedge->lock);
+
+	for (int m = 0; m < NBLKS; ++m) {	// Completed slots are ours
+		if (got[m])
+			_hedge_scatter(geo, idx, naddrs, m,
+				       hedge->slots[m].buf, data);
+	}
+
+	for (int i = 0; i < naddrs; ++i) {	// Late, failed or not sent
+		if (got[idx[i]])
+			continue;
+
+		ridx[nrecon] = i;
+		raddrs[nrecon++] = addrs[i];
+	}
+
+	if (nrecon) {
+		NVM_DEBUG("hedge: reconstructing naddrs(%d)", nrecon);
+
+		rbuf = nvm_buf_alloc(geo, nrecon * SECTOR_NBYTES);
+		err = rbuf ? _vblk_reconstruct(vblk, raddrs, nrecon, rbuf) : -1;
+		for (int k = 0; !err && (k < nrecon); ++k)
+			memcpy(data + ridx[k] * SECTOR_NBYTES,
+			       rbuf + k * SECTOR_NBYTES, SECTOR_NBYTES);
+	}
+
+	pthread_mutex_lock(&hedge->lock);
+	for (int m = 0; m < NBLKS; ++m) {	// Release the slots
+		struct nvm_vblk_hedge_slot *slot = &hedge->slots[m];
+
+		if (!sent[m])
+			continue;
+
+		if (got[m] || !err) {		// Drop what is not needed
+			if (slot->state == NVM_VBLK_HEDGE_RUNNING)
+				slot->abandoned = 1;
+			else
+				slot->state = NVM_VBLK_HEDGE_IDLE;
+			continue;
+		}
+
+		while ((slot->state == NVM_VBLK_HEDGE_QUEUED) ||
+		       (slot->state == NVM_VBLK_HEDGE_RUNNING))
+			pthread_cond_wait(&hedge->cond, &hedge->lock);
+
+		got[m] = !slot->err;		// Fall back on the member read
+		if (got[m])
+			_hedge_scatter(geo, idx, naddrs, m, slot->buf, data);
+		slot->state = NVM_VBLK_HEDGE_IDLE;
+	}
+	pthread_cond_broadcast(&hedge->cond);
+	pthread_mutex_unlock(&hedge->lock);
+
+	for (int m = 0; err && rbuf && (m < NBLKS); ++m) {	// Not sent
+		int n = 0;
+
+		if (!nsecs[m] || sent[m])
+			continue;
+
+		for (int i = 0; i < naddrs; ++i) {
+			if (idx[i] == m)
+				raddrs[n++] = addrs[i];
+		}
+		got[m] = !_cmd_retry(vblk, NVM_S12_OPC_READ, raddrs, n, rbuf,
+				     NULL, flags);
+		if (got[m])
+			_hedge_scatter(geo, idx, naddrs, m, rbuf, data);
+	}
+
+	nvm_buf_free(rbuf);
+
+	for (int m = 0; err && (m < NBLKS); ++m) {
+		if (nsecs[m] && !got[m]) {
+			errno = EIO;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Read the given sectors, on a vblk with parity, sectors which cannot be read
+ * are reconstructed, as are, when hedging, those read slower than the hedging
+ * threshold, see nvm_vblk_set_hedge
+ */
+static ssize_t _cmd_read(struct nvm_vblk *vblk, struct nvm_addr addrs[],
+			 int naddrs, char *data, uint16_t flags)
+{
+	if (!vblk->parity)
+		return _cmd_retry(vblk, NVM_S12_OPC_READ, addrs, naddrs, data,
+				  NULL, flags);
+
+	if (vblk->hedge && (naddrs <= NVM_NADDR_MAX))
+		return _cmd_read_hedged(vblk, addrs, naddrs, data, flags);
+
+	if (!_cmd_retry(vblk, NVM_S12_OPC_READ, addrs, naddrs, data, NULL,
+			flags))
+		return 0;
+
+	NVM_DEBUG("parity: reconstructing naddrs(%d)", naddrs);
+
+	return _vblk_reconstruct(vblk, addrs, naddrs, data);
+}
+
+static inline int _cmd_nblks(int nblks, int cmd_nblks_max)
+{
+	int cmd_nblks = cmd_nblks_max;
+
+	while(nblks % cmd_nblks && cmd_nblks > 1) --cmd_nblks;
+
+	return cmd_nblks;
+}
+
+/**
+ * Wait for the prefetch of the given window, if any, to finish
+ */
+static inline void _ra_wait(struct nvm_vblk_ra *ra, struct nvm_vblk_ra_win *win)
+{
+	pthread_mutex_lock(&ra->lock);
+	while (win->pending)
+		pthread_cond_wait(&ra->cond, &ra->lock);
+	pthread_mutex_unlock(&ra->lock);
+}
+
+/**
+ * Wait for all prefetches and empty the windows
+ */
+static void _ra_drop(struct nvm_vblk_ra *ra)
+{
+	if (!ra)
+		return;
+
+	for (int i = 0; i < 2; ++i) {
+		_ra_wait(ra, &ra->wins[i]);
+		ra->wins[i].len = 0;
+	}
+	ra->pos_expect = 0;
+}
+
+ssize_t nvm_vblk_erase(struct nvm_vblk *vblk)
+{
+	size_t nerr = 0;
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+
+	const int BLK_NADDRS = geo->nplanes;
+	const int CMD_NBLKS = _cmd_nblks(vblk->nblks,
+				vblk->dev->erase_naddrs_max / BLK_NADDRS);
+	//const int NTHREADS = vblk->nblks < CMD_NBLKS ? 1 : vblk->nblks / CMD_NBLKS;
+	const int NTHREADS = 1;
+
+	#pragma omp parallel for num_threads(NTHREADS) schedule(static,1) reduction(+:nerr) ordered if (NTHREADS>1)
+	for (int off = 0; off < vblk->nblks; off += CMD_NBLKS) {
+		ssize_t err;
+
+		const int nblks = NVM_MIN(CMD_NBLKS, vblk->nblks - off);
+		const int naddrs = nblks * BLK_NADDRS;
+
+		struct nvm_addr addrs[naddrs];
+
+		for (int i = 0; i < naddrs; ++i) {
+			const int idx = off + (i / BLK_NADDRS);
+
+			addrs[i].ppa = vblk->blks[idx].ppa;
+			addrs[i].g.pl = i % geo->nplanes;
+		}
+
+		err = _cmd_retry(vblk, NVM_S12_OPC_ERASE, addrs, naddrs,
+				 NULL, NULL, 0);
+		if (err)
+			++nerr;
+
+		#pragma omp ordered
+		{}
+	}
+
+	if (vblk->parity) {
+		struct nvm_addr addrs[BLK_NADDRS];
+
+		for (int i = 0; i < BLK_NADDRS; ++i) {
+			addrs[i].ppa = vblk->pblk.ppa;
+			addrs[i].g.pl = i % geo->nplanes;
+		}
+
+		if (_cmd_retry(vblk, NVM_S12_OPC_ERASE, addrs, BLK_NADDRS,
+			       NULL, NULL, 0))
+			++nerr;
+	}
+
+	if (nerr) {
+		errno = EIO;
+		return -1;
+	}
+
+	vblk->pos_write = 0;
+	vblk->pos_read = 0;
+	vblk->wbuf_len = 0;
+	_ra_drop(vblk->ra);
+
+	return vblk->nbytes;
+}
+
+static inline int _cmd_nspages(int nblks, int cmd_nspages_max)
+{
+	int cmd_nspages = cmd_nspages_max;
+
+	while(nblks % cmd_nspages && cmd_nspages > 1) --cmd_nspages;
+
+	return cmd_nspages;
+}
+
+static inline int _vblk_width(const struct nvm_vblk *vblk)
+{
+	return vblk->width ? vblk->width : vblk->nblks;
+}
+
+/**
+ * Map the given super-page, that is, a multi-plane page counted in vblk
+ * striping order, to the member block `idx` and page `pg`
+ *
+ * Super-pages are striped round-robin over groups of `width` members, a group
+ * is filled before the next, with `width` equal to `nblks` this is plain
+ * page-interleaving and with `width` one it is block-sequential
+ */
+static inline void _vblk_spg2blk(const struct nvm_vblk *vblk,
+				 const struct nvm_geo *geo, size_t spg,
+				 int *idx, int *pg)
+{
+	const size_t WIDTH = _vblk_width(vblk);
+	const size_t GROUP = WIDTH * geo->npages;
+	const size_t r = spg % GROUP;
+
+	*idx = (spg / GROUP) * WIDTH + r % WIDTH;
+	*pg = r / WIDTH;
+}
+
+/**
+ * Inverse of _vblk_spg2blk
+ */
+static inline size_t _vblk_blk2spg(const struct nvm_vblk *vblk,
+				   const struct nvm_geo *geo, int idx, int pg)
+{
+	const size_t WIDTH = _vblk_width(vblk);
+
+	return (idx / WIDTH) * WIDTH * geo->npages + pg * WIDTH + idx % WIDTH;
+}
+
+/**
+ * Check that the first super-page written to each member of a chunked vblk,
+ * within super-pages [bgn, end), is at the write pointer of its chunk
+ */
+static int _vblk_check_wp(struct nvm_vblk *vblk, const struct nvm_geo *geo,
+			  size_t bgn, size_t end)
+{
+	const uint64_t SPAGE_NADDRS = geo->nplanes * geo->nsectors;
+	uint8_t seen[128] = {0};
+	int nseen = 0;
+
+	for (size_t spg = bgn; (spg < end) && (nseen < vblk->nblks); ++spg) {
+		struct nvm_spec_chunk chunk;
+		int idx, pg;
+
+		_vblk_spg2blk(vblk, geo, spg, &idx, &pg);
+		if (seen[idx])
+			continue;
+
+		seen[idx] = 1;
+		++nseen;
+
+		if (nvm_chunk_get(vblk->dev, vblk->blks[idx], &chunk, NULL))
+			return -1;		// Propagate errno
+
+		if (chunk.wp != pg * SPAGE_NADDRS) {
+			NVM_DEBUG("FAILED: write of pg(%d) at wp(%"PRIu64")",
+				  pg, chunk.wp);
+			errno = EINVAL;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Determine the # of super-pages per command and the # of threads for the
+ * layout of the vblk
+ *
+ * Commands never span two groups of members, and all commands addressing the
+ * same members are issued, in order, by the same thread
+ */
+static inline void _cmd_layout(const struct nvm_vblk *vblk,
+			       const struct nvm_geo *geo, int cmd_nspages_max,
+			       int *cmd_nspages, int *nthreads)
+{
+	const int WIDTH = _vblk_width(vblk);
+
+	if (WIDTH >= cmd_nspages_max) {
+		*cmd_nspages = _cmd_nspages(WIDTH, cmd_nspages_max);
+		*nthreads = WIDTH / *cmd_nspages;
+		return;
+	}
+
+	// Commands span several pages of the group members
+	*cmd_nspages = WIDTH * _cmd_nspages(geo->npages,
+					    cmd_nspages_max / WIDTH);
+	*nthreads = 1;
+}
+
+/**
+ * Map the given sector, counted in vblk striping order, to its address
+ */
+static inline struct nvm_addr _vblk_sec2addr(const struct nvm_vblk *vblk,
+					     const struct nvm_geo *geo,
+					     size_t sec)
+{
+	const size_t SPAGE_NADDRS = geo->nplanes * geo->nsectors;
+	const size_t spg = sec / SPAGE_NADDRS;
+	const int i = sec % SPAGE_NADDRS;
+	struct nvm_addr addr;
+	int idx, pg;
+
+	_vblk_spg2blk(vblk, geo, spg, &idx, &pg);
+
+	addr.ppa = vblk->blks[idx].ppa;
+	addr.g.pg = pg;
+	addr.g.pl = (i / geo->nsectors) % geo->nplanes;
+	addr.g.sec = i % geo->nsectors;
+
+	return addr;
+}
+
+/**
+ * Setup the start offsets of the io-vector segments, `seg_bgn[iovcnt]` is the
+ * total number of bytes
+ *
+ * @returns 0 when all segments are multiples of the sector size, -1 otherwise
+ */
+static inline int _iov_setup(const struct nvm_geo *geo, const struct iovec *iov,
+			     int iovcnt, size_t *seg_bgn)
+{
+	seg_bgn[0] = 0;
+	for (int i = 0; i < iovcnt; ++i) {
+		if (iov[i].iov_len % geo->sector_nbytes)
+			return -1;
+
+		seg_bgn[i + 1] = seg_bgn[i] + iov[i].iov_len;
+	}
+
+	return 0;
+}
+
+/**
+ * Find the segment containing byte `off` of the io-vector
+ */
+static inline int _iov_seg(const size_t *seg_bgn, int iovcnt, size_t off)
+{
+	int bgn = 0, end = iovcnt - 1;
+
+	while (bgn < end) {
+		const int mid = bgn + (end - bgn + 1) / 2;
+
+		if (seg_bgn[mid] <= off)
+			bgn = mid;
+		else
+			end = mid - 1;
+	}
+
+	return bgn;
+}
+
+/**
+ * Setup `slice` to describe `len` bytes of the io-vector starting at `off`,
+ * skipping empty segments
+ *
+ * @returns The number of segments in the slice
+ */
+static inline int _iov_slice(const struct iovec *iov, const size_t *seg_bgn,
+			     int iovcnt, size_t off, size_t len,
+			     struct iovec *slice)
+{
+	int nslice = 0;
+
+	for (int seg = _iov_seg(seg_bgn, iovcnt, off); len; ++seg) {
+		const size_t seg_off = off - seg_bgn[seg];
+		size_t seg_len = iov[seg].iov_len - seg_off;
+
+		if (!iov[seg].iov_len)
+			continue;
+
+		seg_len = seg_len < len ? seg_len : len;
+		if (slice) {
+			slice[nslice].iov_base = (char *)iov[seg].iov_base + seg_off;
+			slice[nslice].iov_len = seg_len;
+		}
+		++nslice;
+
+		off += seg_len;
+		len -= seg_len;
+	}
+
+	return nslice;
+}
+
+/**
+ * Write the command addresses from the io-vector slice starting at `off`, the
+ * segments are handed to nvm_addr_writev, which bounces only the plane-mode
+ * groups straddling segments. Writes are not retried, see _cmd_retry.
+ */
+static inline ssize_t _cmd_writev(struct nvm_vblk *vblk,
+				  struct nvm_addr addrs[], int naddrs,
+				  const struct iovec *iov, const size_t *seg_bgn,
+				  int iovcnt, size_t off, char *meta,
+				  uint16_t flags)
+{
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+	const size_t len = naddrs * geo->sector_nbytes;
+	const int nslice = _iov_slice(iov, seg_bgn, iovcnt, off, len, NULL);
+	const int io_class = nvm_sched_io_class_set(vblk->io_class);
+	struct nvm_ret ret = {0,0};
+	struct iovec slice[nslice];
+	ssize_t err;
+
+	_iov_slice(iov, seg_bgn, iovcnt, off, len, slice);
+
+	err = nvm_addr_writev(vblk->dev, addrs, naddrs, slice, nslice, meta,
+			      flags, &ret);
+
+	nvm_sched_io_class_set(io_class);
+
+	return err;
+}
+
+/**
+ * Read the command addresses into the io-vector slice starting at `off`
+ *
+ * The command is split at the segments, the super-pages within a segment are
+ * read in place, a super-page straddling segments is read into a bounce buffer
+ * and scattered. Each piece goes through _cmd_read for retries and parity
+ * reconstruction.
+ */
+static inline ssize_t _cmd_readv(struct nvm_vblk *vblk,
+				 struct nvm_addr addrs[], int naddrs,
+				 const struct iovec *iov, const size_t *seg_bgn,
+				 int iovcnt, size_t off, uint16_t flags)
+{
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+	const int SPAGE_NADDRS = geo->nplanes * geo->nsectors;
+	const size_t SPAGE = SPAGE_NADDRS * geo->sector_nbytes;
+	char *bounce = NULL;
+	ssize_t err = 0;
+
+	for (int i = 0; !err && (i < naddrs); ) {
+		const size_t pos = off + i * geo->sector_nbytes;
+		const int seg = _iov_seg(seg_bgn, iovcnt, pos);
+		const size_t avail = seg_bgn[seg + 1] - pos;
+		struct iovec slice[SPAGE_NADDRS];
+		int nslice, n;
+
+		if ((naddrs - i) * geo->sector_nbytes <= avail)
+			n = naddrs - i;
+		else
+			n = (avail / SPAGE) * SPAGE_NADDRS;
+
+		if (n) {				// In the segment
+			err = _cmd_read(vblk, addrs + i, n,
+					(char *)iov[seg].iov_base +
+					(pos - seg_bgn[seg]), flags);
+			i += n;
+			continue;
+		}
+
+		if (!bounce) {				// Straddling super-page
+			bounce = nvm_buf_alloc(geo, SPAGE);
+			if (!bounce) {
+				errno = ENOMEM;
+				return -1;
+			}
+		}
+
+		n = NVM_MIN(SPAGE_NADDRS, naddrs - i);
+
+		err = _cmd_read(vblk, addrs + i, n, bounce, flags);
+
+		nslice = _iov_slice(iov, seg_bgn, iovcnt, pos,
+				    n * geo->sector_nbytes, slice);
+		for (int k = 0, o = 0; !err && (k < nslice); ++k) {
+			memcpy(slice[k].iov_base, bounce + o, slice[k].iov_len);
+			o += slice[k].iov_len;
+		}
+		i += n;
+	}
+
+	nvm_buf_free(bounce);
+
+	return err;
+}
+
+/**
+ * Write the parity of the stripes in [offset, offset + count) of the vblk to
+ * its parity block, from the io-vector holding those stripes or, when NULL,
+ * from padding
+ *
+ * A vblk with parity is page-interleaved over all members, stripe `pg` thus
+ * consists of page `pg` of each member and its parity is page `pg` of the
+ * parity block.
+ */
+static ssize_t _vblk_write_parity(struct nvm_vblk *vblk,
+				  const struct iovec *iov, int iovcnt,
+				  const size_t *seg_bgn, size_t count,
+				  size_t offset, char *meta, uint16_t flags)
+{
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+	const int SPAGE_NADDRS = geo->nplanes * geo->nsectors;
+	const size_t ALIGN = SPAGE_NADDRS * geo->sector_nbytes;
+	const size_t STRIPE = ALIGN * vblk->nblks;
+	const int CMD_NSPAGES = _cmd_nspages(geo->npages,
+				vblk->dev->write_naddrs_max / SPAGE_NADDRS);
+
+	const size_t bgn = offset / STRIPE;
+	const size_t end = bgn + (count / STRIPE);
+
+	char *buf;
+
+	buf = nvm_buf_alloc(geo, CMD_NSPAGES * ALIGN);
+	if (!buf) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	for (size_t pg = bgn; pg < end; pg += CMD_NSPAGES) {
+		const int npages = NVM_MIN(CMD_NSPAGES, (int)(end - pg));
+		const int naddrs = npages * SPAGE_NADDRS;
+
+		struct nvm_addr addrs[naddrs];
+
+		memset(buf, 0, npages * ALIGN);
+		for (int j = 0; j < npages; ++j) {
+			for (int idx = 0; idx < vblk->nblks; ++idx) {
+				const size_t off = ((pg + j - bgn) *
+						    vblk->nblks + idx) * ALIGN;
+				struct iovec slice[SPAGE_NADDRS];
+				int nslice;
+
+				if (!iov) {
+					_xor(buf + j * ALIGN,
+					     vblk->dev->pad_buf, ALIGN);
+					continue;
+				}
+
+				nslice = _iov_slice(iov, seg_bgn, iovcnt, off,
+						    ALIGN, slice);
+				for (int k = 0, o = 0; k < nslice; ++k) {
+					_xor(buf + j * ALIGN + o,
+					     slice[k].iov_base,
+					     slice[k].iov_len);
+					o += slice[k].iov_len;
+				}
+			}
+		}
+
+		for (int i = 0; i < naddrs; ++i) {
+			addrs[i].ppa = vblk->pblk.ppa;
+			addrs[i].g.pg = pg + (i / SPAGE_NADDRS);
+			addrs[i].g.pl = (i / geo->nsectors) % geo->nplanes;
+			addrs[i].g.sec = i % geo->nsectors;
+		}
+
+		if (_cmd_retry(vblk, NVM_S12_OPC_WRITE, addrs, naddrs, buf,
+			       meta, flags)) {
+			nvm_buf_free(buf);
+			errno = EIO;
+			return -1;
+		}
+	}
+
+	nvm_buf_free(buf);
+
+	return 0;
+}
+
+/**
+ * Write `count` bytes from the io-vector to the vblk at `offset`, a NULL
+ * io-vector writes padding
+ */
+static ssize_t _vblk_pwritev(struct nvm_vblk *vblk, const struct iovec *iov,
+			     int iovcnt, size_t count, size_t offset)
+{
+	size_t nerr = 0;
+	const int PMODE = nvm_dev_get_pmode(vblk->dev);
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+
+	const int SPAGE_NADDRS = geo->nplanes * geo->nsectors;
+	int CMD_NSPAGES, NTHREADS;
+
+	const int ALIGN = SPAGE_NADDRS * geo->sector_nbytes;
+
+	const size_t bgn = offset / ALIGN;
+	const size_t end = bgn + (count / ALIGN);
+
+	const int NSEGS = iov ? iovcnt : 1;
+	size_t seg_bgn[NSEGS + 1];
+
+	// Shared, pre-filled, padding and meta, see nvm_dev_fillers_alloc
+	char *padding_buf = iov ? NULL : vblk->dev->pad_buf;
+	char *meta = vblk->dev->meta_bufs[vblk->dev->meta_mode];
+
+	if (offset + count > vblk->nbytes) {		// Check bounds
+		errno = EINVAL;
+		return -1;
+	}
+
+	if ((count % ALIGN) || (offset % ALIGN)) {	// Check align
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (vblk->parity && ((count % (ALIGN * vblk->nblks)) ||
+			     (offset % (ALIGN * vblk->nblks)))) {
+		errno = EINVAL;				// Whole stripes
+		return -1;
+	}
+
+	if (iov && _iov_setup(geo, iov, iovcnt, seg_bgn)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (vblk->chunked && _vblk_check_wp(vblk, geo, bgn, end))
+		return -1;				// Propagate errno
+
+	_cmd_layout(vblk, geo, vblk->dev->write_naddrs_max / SPAGE_NADDRS,
+		    &CMD_NSPAGES, &NTHREADS);
+
+	#pragma omp parallel for num_threads(NTHREADS) schedule(static,1) reduction(+:nerr) ordered if(NTHREADS>1)
+	for (size_t off = bgn; off < end; off += CMD_NSPAGES) {
+		const int nspages = NVM_MIN(CMD_NSPAGES, (int)(end - off));
+		const int naddrs = nspages * SPAGE_NADDRS;
+
+		struct nvm_addr addrs[naddrs];
+		ssize_t err;
+
+		for (int i = 0; i < naddrs; ++i) {
+			const size_t spg = off + (i / SPAGE_NADDRS);
+			int idx, pg;
+
+			_vblk_spg2blk(vblk, geo, spg, &idx, &pg);
+
+			addrs[i].ppa = vblk->blks[idx].ppa;
+			addrs[i].g.pg = pg;
+			addrs[i].g.pl = (i / geo->nsectors) % geo->nplanes;
+			addrs[i].g.sec = i % geo->nsectors;
+		}
+
+		if (padding_buf)
+			err = _cmd_retry(vblk, NVM_S12_OPC_WRITE, addrs,
+					 naddrs, padding_buf, meta, PMODE);
+		else
+			err = _cmd_writev(vblk, addrs, naddrs, iov, seg_bgn,
+					  iovcnt, (off - bgn) * ALIGN, meta,
+					  PMODE);
+		if (err)
+			++nerr;
+
+		#pragma omp ordered
+		{}
+	}
+
+	if (!nerr && vblk->parity &&
+	    _vblk_write_parity(vblk, iov, iovcnt, seg_bgn, count, offset, meta,
+			       PMODE))
+		++nerr;
+
+	if (nerr) {
+		errno = EIO;
+		return -1;
+	}
+
+	return count;
+}
+
+ssize_t nvm_vblk_pwritev(struct nvm_vblk *vblk, const struct iovec *iov,
+			 int iovcnt, size_t offset)
+{
+	size_t count = 0;
+
+	if (!iov || (iovcnt < 1)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (int i = 0; i < iovcnt; ++i)
+		count += iov[i].iov_len;
+
+	return _vblk_pwritev(vblk, iov, iovcnt, count, offset);
+}
+
+ssize_t nvm_vblk_pwrite(struct nvm_vblk *vblk, const void *buf, size_t count,
+			size_t offset)
+{
+	struct iovec iov = { .iov_base = (void *)buf, .iov_len = count };
+
+	return _vblk_pwritev(vblk, buf ? &iov : NULL, 1, count, offset);
+}
+
+ssize_t nvm_vblk_write(struct nvm_vblk *vblk, const void *buf, size_t count)
+{
+	ssize_t nbytes;
+
+	if (vblk->wbuf_len) {	// Appended bytes must be flushed first
+		errno = EINVAL;
+		return -1;
+	}
+
+	nbytes = nvm_vblk_pwrite(vblk, buf, count, vblk->pos_write);
+
+	if (nbytes < 0)
+		return nbytes;		// Propagate errno
+	
+	vblk->pos_write += nbytes;	// All is good, increment write position
+
+	return nbytes;			// Return number of bytes written
+}
+
+ssize_t nvm_vblk_pad(struct nvm_vblk *vblk)
+{
+	if (nvm_vblk_flush(vblk) < 0)
+		return -1;	// Propagate errno
+
+	return nvm_vblk_write(vblk, NULL, vblk->nbytes - vblk->pos_write);
+}
+
+ssize_t nvm_vblk_append(struct nvm_vblk *vblk, const void *buf, size_t count)
+{
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+	const size_t ALIGN = geo->nplanes * geo->nsectors * geo->sector_nbytes;
+	const size_t STRIPE = ALIGN * vblk->nblks;
+	const char *cbuf = buf;
+	size_t left = count;
+
+	if (vblk->pos_write + vblk->wbuf_len + count > vblk->nbytes) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (count && !buf) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (!vblk->wbuf) {
+		vblk->wbuf = nvm_buf_alloc(geo, STRIPE);
+		if (!vblk->wbuf) {
+			errno = ENOMEM;
+			return -1;
+		}
+	}
+
+	while (left) {
+		// Bytes until the write cursor reaches a stripe boundary
+		const size_t fill = STRIPE - (vblk->pos_write % STRIPE);
+		size_t n;
+
+		if (!vblk->wbuf_len && left >= fill) {	// Directly from buf
+			n = fill + ((left - fill) / STRIPE) * STRIPE;
+
+			if (nvm_vblk_pwrite(vblk, cbuf, n, vblk->pos_write) < 0)
+				break;
+
+			vblk->pos_write += n;
+			cbuf += n;
+			left -= n;
+			continue;
+		}
+
+		n = left < fill - vblk->wbuf_len ? left : fill - vblk->wbuf_len;
+
+		memcpy(vblk->wbuf + vblk->wbuf_len, cbuf, n);
+		vblk->wbuf_len += n;
+		cbuf += n;
+		left -= n;
+
+		if (vblk->wbuf_len < fill)
+			continue;
+
+		if (nvm_vblk_pwrite(vblk, vblk->wbuf, fill,
+				    vblk->pos_write) < 0) {
+			vblk->wbuf_len -= n;	// Drop the part of this call
+			left += n;
+			break;
+		}
+
+		vblk->pos_write += fill;
+		vblk->wbuf_len = 0;
+	}
+
+	if (left == count && count)
+		return -1;		// Propagate errno
+
+	return count - left;
+}
+
+ssize_t nvm_vblk_flush(struct nvm_vblk *vblk)
+{
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+	const size_t ALIGN = geo->nplanes * geo->nsectors * geo->sector_nbytes *
+			     (vblk->parity ? vblk->nblks : 1);
+	size_t nbytes;
+
+	if (!vblk->wbuf_len)
+		return 0;
+
+	nbytes = ((vblk->wbuf_len + ALIGN - 1) / ALIGN) * ALIGN;
+	memset(vblk->wbuf + vblk->wbuf_len, 0, nbytes - vblk->wbuf_len);
+
+	if (nvm_vblk_pwrite(vblk, vblk->wbuf, nbytes, vblk->pos_write) < 0)
+		return -1;	// Propagate errno
+
+	vblk->pos_write += nbytes;
+	vblk->wbuf_len = 0;
+
+	return nbytes;
+}
+
+static ssize_t _vblk_preadv(struct nvm_vblk *vblk, const struct iovec *iov,
+			    int iovcnt, size_t count, size_t offset)
+{
+	size_t nerr = 0;
+	const int PMODE = nvm_dev_get_pmode(vblk->dev);
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+
+	const int SPAGE_NADDRS = geo->nplanes * geo->nsectors;
+	int CMD_NSPAGES, NTHREADS;
+
+	const int ALIGN = SPAGE_NADDRS * geo->sector_nbytes;
+
+	const size_t bgn = offset / ALIGN;
+	const size_t end = bgn + (count / ALIGN);
+
+	size_t seg_bgn[iovcnt + 1];
+
+	if (offset + count > vblk->nbytes) {		// Check bounds
+		errno = EINVAL;
+		return -1;
+	}
+
+	if ((count % ALIGN) || (offset % ALIGN)) {	// Check align
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (_iov_setup(geo, iov, iovcnt, seg_bgn)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	_cmd_layout(vblk, geo, vblk->dev->read_naddrs_max / SPAGE_NADDRS,
+		    &CMD_NSPAGES, &NTHREADS);
+
+	#pragma omp parallel for num_threads(NTHREADS) schedule(static,1) reduction(+:nerr) ordered if(NTHREADS>1)
+	for (size_t off = bgn; off < end; off += CMD_NSPAGES) {
+		const int nspages = NVM_MIN(CMD_NSPAGES, (int)(end - off));
+		const int naddrs = nspages * SPAGE_NADDRS;
+
+		struct nvm_addr addrs[naddrs];
+
+		for (int i = 0; i < naddrs; ++i) {
+			const size_t spg = off + (i / SPAGE_NADDRS);
+			int idx, pg;
+
+			_vblk_spg2blk(vblk, geo, spg, &idx, &pg);
+
+			addrs[i].ppa = vblk->blks[idx].ppa;
+			addrs[i].g.pg = pg;
+			addrs[i].g.pl = (i / geo->nsectors) % geo->nplanes;
+			addrs[i].g.sec = i % geo->nsectors;
+		}
+
+		const ssize_t err = _cmd_readv(vblk, addrs, naddrs, iov,
+					       seg_bgn, iovcnt,
+					       (off - bgn) * ALIGN, PMODE);
+		if (err)
+			++nerr;
+
+		#pragma omp ordered
+		{}
+	}
+
+	if (nerr) {
+		errno = EIO;
+		return -1;
+	}
+
+	return count;
+}
+
+ssize_t nvm_vblk_preadv(struct nvm_vblk *vblk, const struct iovec *iov,
+			int iovcnt, size_t offset)
+{
+	size_t count = 0;
+
+	if (!iov || (iovcnt < 1)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (int i = 0; i < iovcnt; ++i)
+		count += iov[i].iov_len;
+
+	return _vblk_preadv(vblk, iov, iovcnt, count, offset);
+}
+
+/**
+ * Read an arbitrary byte-range using single-sector addressing, only the sectors
+ * covering the range are read. Whole sectors are read directly into `buf`, the
+ * partial head and tail sectors via a bounce buffer.
+ */
+static ssize_t _vblk_pread_sectors(struct nvm_vblk *vblk, char *buf,
+				   size_t count, size_t offset)
+{
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+	const size_t SECTOR_NBYTES = geo->sector_nbytes;
+	const int CMD_NADDRS = vblk->dev->read_naddrs_max;
+
+	const size_t sec_bgn = offset / SECTOR_NBYTES;
+	const size_t sec_end = (offset + count + SECTOR_NBYTES - 1) / SECTOR_NBYTES;
+
+	size_t full_bgn = sec_bgn + ((offset % SECTOR_NBYTES) ? 1 : 0);
+	size_t full_end = sec_end - (((offset + count) % SECTOR_NBYTES) ? 1 : 0);
+
+	struct nvm_addr addrs[2];	// Partial sectors
+	size_t part[2];
+	int npart = 0;
+
+	if (full_bgn > full_end)	// Range within a single sector
+		full_bgn = full_end = sec_end;
+
+	if (sec_bgn < full_bgn)
+		part[npart++] = sec_bgn;
+	if (full_end < sec_end)
+		part[npart++] = full_end;
+
+	for (size_t bgn = full_bgn; bgn < full_end; bgn += CMD_NADDRS) {
+		const int naddrs = NVM_MIN(CMD_NADDRS, (int)(full_end - bgn));
+		struct nvm_addr cmd_addrs[naddrs];
+
+		for (int i = 0; i < naddrs; ++i)
+			cmd_addrs[i] = _vblk_sec2addr(vblk, geo, bgn + i);
+
+		if (_cmd_read(vblk, cmd_addrs, naddrs,
+			      buf + (bgn * SECTOR_NBYTES - offset),
+			      NVM_FLAG_PMODE_SNGL)) {
+			errno = EIO;
+			return -1;
+		}
+	}
+
+	if (npart) {
+		char *bounce = nvm_buf_alloc(geo, npart * SECTOR_NBYTES);
+
+		if (!bounce) {
+			errno = ENOMEM;
+			return -1;
+		}
+
+		for (int i = 0; i < npart; ++i)
+			addrs[i] = _vblk_sec2addr(vblk, geo, part[i]);
+
+		if (_cmd_read(vblk, addrs, npart, bounce,
+			      NVM_FLAG_PMODE_SNGL)) {
+			nvm_buf_free(bounce);
+			errno = EIO;
+			return -1;
+		}
+
+		for (int i = 0; i < npart; ++i) {
+			const size_t sec_off = part[i] * SECTOR_NBYTES;
+			const size_t bgn = sec_off > offset ? sec_off : offset;
+			const size_t end = NVM_MIN_SZ(sec_off + SECTOR_NBYTES,
+						      offset + count);
+
+			memcpy(buf + (bgn - offset),
+			       bounce + i * SECTOR_NBYTES + (bgn - sec_off),
+			       end - bgn);
+		}
+
+		nvm_buf_free(bounce);
+	}
+
+	return count;
+}
+
+static ssize_t _vblk_pread(struct nvm_vblk *vblk, void *buf, size_t count,
+			   size_t offset)
+{
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+	const size_t ALIGN = geo->nplanes * geo->nsectors * geo->sector_nbytes;
+	struct iovec iov = { .iov_base = buf, .iov_len = count };
+	size_t mid_bgn, mid_end;
+
+	if (!((count % ALIGN) || (offset % ALIGN)))
+		return _vblk_preadv(vblk, &iov, 1, count, offset);
+
+	if (offset + count > vblk->nbytes) {		// Check bounds
+		errno = EINVAL;
+		return -1;
+	}
+	if (!count)
+		return 0;
+
+	// Aligned middle via the multi-plane path, the rest sector by sector
+	mid_bgn = ((offset + ALIGN - 1) / ALIGN) * ALIGN;
+	mid_end = ((offset + count) / ALIGN) * ALIGN;
+
+	if (mid_end <= mid_bgn)
+		return _vblk_pread_sectors(vblk, buf, count, offset);
+
+	if (_vblk_pread_sectors(vblk, buf, mid_bgn - offset, offset) < 0)
+		return -1;
+
+	iov.iov_base = (char *)buf + (mid_bgn - offset);
+	iov.iov_len = mid_end - mid_bgn;
+	if (_vblk_preadv(vblk, &iov, 1, mid_end - mid_bgn, mid_bgn) < 0)
+		return -1;
+
+	if (_vblk_pread_sectors(vblk, (char *)buf + (mid_end - offset),
+				offset + count - mid_end, mid_end) < 0)
+		return -1;
+
+	return count;
+}
+
+/**
+ * A sector of a batched read
+ */
+struct _batch_sec {
+	struct nvm_addr addr;	///< Address of the sector
+	char *dst;		///< Where to store the sector
+	int req;		///< Request which the sector belongs to
+};
+
+ssize_t nvm_vblk_pread_batch(struct nvm_vblk_pread_req *reqs, int nreqs)
+{
+	struct nvm_dev *dev;
+	const struct nvm_geo *geo;
+	int NLUNS, CMD_NADDRS;
+	struct _batch_sec *secs = NULL;		// Sectors, sorted by LUN
+	size_t *lun_bgn = NULL;			// Index of first sector of LUN
+	int *luns = NULL;			// LUNs with sectors to read
+	int nluns = 0;
+	int width = 1;
+	size_t nsecs = 0;
+	size_t nerr = 0;
+
+	if (!reqs || (nreqs < 1) || !reqs[0].vblk) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	dev = reqs[0].vblk->dev;
+	geo = nvm_dev_get_geo(dev);
+	NLUNS = geo->nchannels * geo->nluns;
+	CMD_NADDRS = dev->read_naddrs_max;
+
+	for (int r = 0; r < nreqs; ++r) {		// Check requests
+		if (!reqs[r].vblk || (reqs[r].vblk->dev != dev) ||
+		    (reqs[r].count && !reqs[r].buf) ||
+		    (reqs[r].offset % geo->sector_nbytes) ||
+		    (reqs[r].count % geo->sector_nbytes) ||
+		    (reqs[r].offset + reqs[r].count > reqs[r].vblk->nbytes)) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		reqs[r].res = reqs[r].count;
+		nsecs += reqs[r].count / geo->sector_nbytes;
+	}
+	if (!nsecs)
+		return 0;
+
+	secs = malloc(sizeof(*secs) * nsecs);
+	lun_bgn = calloc(NLUNS + 1, sizeof(*lun_bgn));
+	luns = malloc(sizeof(*luns) * NLUNS);
+	if (!secs || !lun_bgn || !luns) {
+		free(secs);
+		free(lun_bgn);
+		free(luns);
+		errno = ENOMEM;
+		return -1;
+	}
+
+	for (int r = 0; r < nreqs; ++r) {		// Count sectors per LUN
+		const size_t sec = reqs[r].offset / geo->sector_nbytes;
+		const size_t n = reqs[r].count / geo->sector_nbytes;
+
+		for (size_t i = 0; i < n; ++i) {
+			struct nvm_addr addr;
+
+			addr = _vblk_sec2addr(reqs[r].vblk, geo, sec + i);
+			++lun_bgn[addr.g.ch * geo->nluns + addr.g.lun + 1];
+		}
+	}
+	for (int lun = 0; lun < NLUNS; ++lun) {
+		if (lun_bgn[lun + 1])
+			luns[nluns++] = lun;
+		lun_bgn[lun + 1] += lun_bgn[lun];
+	}
+
+	for (int r = 0; r < nreqs; ++r) {		// Sort sectors by LUN
+		const size_t sec = reqs[r].offset / geo->sector_nbytes;
+		const size_t n = reqs[r].count / geo->sector_nbytes;
+
+		for (size_t i = 0; i < n; ++i) {
+			struct nvm_addr addr;
+			int lun;
+
+			addr = _vblk_sec2addr(reqs[r].vblk, geo, sec + i);
+			lun = addr.g.ch * geo->nluns + addr.g.lun;
+
+			secs[lun_bgn[lun]].addr = addr;
+			secs[lun_bgn[lun]].dst = (char *)reqs[r].buf +
+						 i * geo->sector_nbytes;
+			secs[lun_bgn[lun]].req = r;
+			++lun_bgn[lun];
+		}
+	}
+	for (int lun = NLUNS; lun > 0; --lun)		// Restore the offsets
+		lun_bgn[lun] = lun_bgn[lun - 1];
+	lun_bgn[0] = 0;
+
+	for (int r = 0; r < nreqs; ++r)		// Bounded as a single vblk
+		if (_vblk_width(reqs[r].vblk) > width)
+			width = _vblk_width(reqs[r].vblk);
+
+	const int NTHREADS = NVM_MIN(nluns, width);
+
+	#pragma omp parallel for num_threads(NTHREADS) schedule(dynamic,1) reduction(+:nerr) if(NTHREADS>1)
+	for (int l = 0; l < nluns; ++l) {
+		const size_t bgn = lun_bgn[luns[l]];
+		const size_t end = lun_bgn[luns[l] + 1];
+		int naddrs;
+		char *buf;
+
+		buf = nvm_buf_alloc(geo, CMD_NADDRS * geo->sector_nbytes);
+		if (!buf) {
+			for (size_t s = bgn; s < end; ++s) {
+				#pragma omp atomic write
+				reqs[secs[s].req].res = -1;
+			}
+			++nerr;
+			continue;
+		}
+
+		for (size_t off = bgn; off < end; off += naddrs) {
+			struct nvm_vblk *vblk = reqs[secs[off].req].vblk;
+			struct nvm_addr addrs[CMD_NADDRS];
+			uint64_t status = ~0ULL;
+			ssize_t err;
+
+			// Sectors of a vblk with parity are read on their own
+			for (naddrs = 0; (naddrs < CMD_NADDRS) &&
+			     (off + naddrs < end); ++naddrs) {
+				struct nvm_vblk *sec_vblk;
+
+				sec_vblk = reqs[secs[off + naddrs].req].vblk;
+				if ((sec_vblk != vblk) &&
+				    (sec_vblk->parity || vblk->parity))
+					break;
+
+				addrs[naddrs] = secs[off + naddrs].addr;
+			}
+
+			if (vblk->parity)	// Reconstructed when unreadable
+				err = _cmd_read(vblk, addrs, naddrs, buf,
+						NVM_FLAG_PMODE_SNGL);
+			else
+				err = _cmd_retry_status(vblk, NVM_S12_OPC_READ,
+							addrs, naddrs, buf,
+							NULL,
+							NVM_FLAG_PMODE_SNGL,
+							&status);
+			if (err)
+				++nerr;
+
+			for (int i = 0; i < naddrs; ++i) {
+				if (err && ((status >> i) & 1)) {
+					#pragma omp atomic write
+					reqs[secs[off + i].req].res = -1;
+					continue;
+				}
+
+				memcpy(secs[off + i].dst,
+				       buf + i * geo->sector_nbytes,
+				       geo->sector_nbytes);
+			}
+		}
+
+		nvm_buf_free(buf);
+	}
+
+	free(secs);
+	free(lun_bgn);
+	free(luns);
+
+	if (nerr) {
+		errno = EIO;
+		return -1;
+	}
+
+	return 0;
+}
+
+ssize_t nvm_vblk_pread(struct nvm_vblk *vblk, void *buf, size_t count,
+		       size_t offset)
+{
+	const size_t wbgn = vblk->pos_write;
+	const size_t wend = wbgn + vblk->wbuf_len;
+	size_t bgn, end;
+
+	if (!vblk->wbuf_len || (offset >= wend) || (offset + count <= wbgn))
+		return _vblk_pread(vblk, buf, count, offset);
+
+	if (offset + count > vblk->nbytes) {		// Check bounds
+		errno = EINVAL;
+		return -1;
+	}
+
+	// Serve the range overlapping the unflushed appends from the buffer
+	bgn = offset > wbgn ? offset : wbgn;
+	end = NVM_MIN_SZ(offset + count, wend);
+
+	if ((offset < bgn) && (_vblk_pread(vblk, buf, bgn - offset, offset) < 0))
+		return -1;
+
+	memcpy((char *)buf + (bgn - offset), vblk->wbuf + (bgn - wbgn),
+	       end - bgn);
+
+	if ((end < offset + count) &&
+	    (_vblk_pread(vblk, (char *)buf + (end - offset),
+			 offset + count - end, end) < 0))
+		return -1;
+
+	return count;
+}
+
+/**
+ * Read the valid sectors of a copy window, compacted, into its buffer
+ *
+ * A window without invalid sectors is read via the multi-plane path, others
+ * sector by sector
+ */
+static void *_copy_read(void *arg)
+{
+	struct nvm_vblk_copy_win *win = arg;
+	struct nvm_vblk *vblk = win->vblk;
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+	const int CMD_NADDRS = vblk->dev->read_naddrs_max;
+	struct nvm_addr addrs[CMD_NADDRS];
+	size_t nvalid = 0;
+	int naddrs = 0;
+
+	win->len = 0;
+	win->err = 0;
+
+	for (size_t i = 0; win->valid && (i < win->nsecs); ++i) {
+		const size_t bit = win->bit + i;
+
+		nvalid += (win->valid[bit / 8] >> (bit % 8)) & 1;
+	}
+
+	if (!win->valid || (nvalid == win->nsecs)) {
+		if (_vblk_pread(vblk, win->buf, win->nsecs * geo->sector_nbytes,
+				win->sec * geo->sector_nbytes) < 0)
+			win->err = 1;
+		else
+			win->len = win->nsecs * geo->sector_nbytes;
+
+		return NULL;
+	}
+
+	for (size_t i = 0; i < win->nsecs; ++i) {
+		const size_t bit = win->bit + i;
+
+		if ((win->valid[bit / 8] >> (bit % 8)) & 1)
+			addrs[naddrs++] = _vblk_sec2addr(vblk, geo,
+							 win->sec + i);
+
+		if ((naddrs < CMD_NADDRS) && ((i + 1 < win->nsecs) || !naddrs))
+			continue;
+
+		if (_cmd_read(vblk, addrs, naddrs, win->buf + win->len,
+			      NVM_FLAG_PMODE_SNGL)) {
+			win->err = 1;
+			return NULL;
+		}
+		win->len += naddrs * geo->sector_nbytes;
+		naddrs = 0;
+	}
+
+	return NULL;
+}
+
+/**
+ * Start reading the given copy window, in the background when possible
+ */
+static void _copy_start(struct nvm_vblk_copy_win *win)
+{
+	win->pending = !pthread_create(&win->thread, NULL, _copy_read, win);
+	if (!win->pending)
+		_copy_read(win);
+}
+
+static void _copy_wait(struct nvm_vblk_copy_win *win)
+{
+	if (!win->pending)
+		return;
+
+	pthread_join(win->thread, NULL);
+	win->pending = 0;
+}
+
+/**
+ * Copy the valid sectors of [sec_bgn, sec_end) of `src` to `dst`, on the same
+ * device, with nvm_addr_copy. Whole super-pages are copied by the device, the
+ * remaining sectors are appended via the write-combining buffer of `dst`.
+ */
+static ssize_t _vblk_vcopy(struct nvm_vblk *dst, struct nvm_vblk *src,
+			   size_t sec_bgn, size_t sec_end, const uint8_t *valid)
+{
+	const struct nvm_geo *geo = nvm_dev_get_geo(src->dev);
+	const size_t SPAGE_NADDRS = geo->nplanes * geo->nsectors;
+	const size_t CMD_NADDRS = NVM_NADDR_MAX < SPAGE_NADDRS ? SPAGE_NADDRS :
+				  (NVM_NADDR_MAX / SPAGE_NADDRS) * SPAGE_NADDRS;
+	const size_t dst_sec = dst->pos_write / geo->sector_nbytes;
+	struct nvm_addr *src_addrs;
+	size_t nvalid = 0, ncopy;
+	int io_class;
+
+	src_addrs = malloc(sizeof(*src_addrs) * (sec_end - sec_bgn));
+	if (!src_addrs) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	for (size_t sec = sec_bgn; sec < sec_end; ++sec) {
+		const size_t bit = sec - sec_bgn;
+
+		if (valid && !((valid[bit / 8] >> (bit % 8)) & 1))
+			continue;
+
+		src_addrs[nvalid++] = _vblk_sec2addr(src, geo, sec);
+	}
+
+	if (dst->pos_write + nvalid * geo->sector_nbytes > dst->nbytes) {
+		free(src_addrs);
+		errno = EINVAL;
+		return -1;
+	}
+
+	ncopy = (nvalid / SPAGE_NADDRS) * SPAGE_NADDRS;
+
+	io_class = nvm_sched_io_class_set(dst->io_class);
+	for (size_t bgn = 0; bgn < ncopy; bgn += CMD_NADDRS) {
+		const int naddrs = NVM_MIN_SZ(CMD_NADDRS, ncopy - bgn);
+		struct nvm_addr dst_addrs[naddrs];
+		struct nvm_ret ret = {0,0};
+
+		for (int i = 0; i < naddrs; ++i)
+			dst_addrs[i] = _vblk_sec2addr(dst, geo,
+						      dst_sec + bgn + i);
+
+		if (nvm_addr_copy(dst->dev, src_addrs + bgn, dst_addrs, naddrs,
+				  NVM_FLAG_PMODE_SNGL, &ret)) {
+			nvm_sched_io_class_set(io_class);
+			free(src_addrs);
+			return -1;	// Propagate errno
+		}
+		dst->pos_write += naddrs * geo->sector_nbytes;
+	}
+	nvm_sched_io_class_set(io_class);
+
+	if (ncopy < nvalid) {		// The rest via the host
+		const int naddrs = nvalid - ncopy;
+		char *buf = nvm_buf_alloc(geo, naddrs * geo->sector_nbytes);
+
+		if (!buf) {
+			free(src_addrs);
+			errno = ENOMEM;
+			return -1;
+		}
+
+		if (_cmd_read(src, src_addrs + ncopy, naddrs, buf,
+			      NVM_FLAG_PMODE_SNGL) ||
+		    (nvm_vblk_append(dst, buf,
+				     naddrs * geo->sector_nbytes) < 0)) {
+			nvm_buf_free(buf);
+			free(src_addrs);
+			errno = EIO;
+			return -1;
+		}
+
+		nvm_buf_free(buf);
+	}
+
+	free(src_addrs);
+
+	return nvalid * geo->sector_nbytes;
+}
+
+ssize_t nvm_vblk_copy(struct nvm_vblk *dst, struct nvm_vblk *src,
+		      size_t offset, size_t count, const uint8_t *valid)
+{
+	const struct nvm_geo *geo = nvm_dev_get_geo(src->dev);
+	const size_t SECTOR_NBYTES = geo->sector_nbytes;
+	const size_t STRIPE = geo->nplanes * geo->nsectors * SECTOR_NBYTES *
+			      src->nblks;
+	const size_t WIN_NSECS = (2 * STRIPE) / SECTOR_NBYTES;
+	const size_t sec_bgn = offset / SECTOR_NBYTES;
+	const size_t sec_end = sec_bgn + count / SECTOR_NBYTES;
+	struct nvm_vblk_copy_win wins[2];
+	size_t nbytes = 0;
+	int err = 0;
+
+	if ((dst == src) || (offset + count > src->nbytes) ||
+	    (offset % SECTOR_NBYTES) || (count % SECTOR_NBYTES) ||
+	    (nvm_dev_get_geo(dst->dev)->sector_nbytes != SECTOR_NBYTES)) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (!count)
+		return 0;
+
+	if ((dst->dev == src->dev) && nvm_dev_get_vcopy(src->dev) &&
+	    !dst->wbuf_len && !dst->parity &&
+	    !(dst->pos_write % (geo->nplanes * geo->nsectors * SECTOR_NBYTES)))
+		return _vblk_vcopy(dst, src, sec_bgn, sec_end, valid);
+
+	memset(wins, 0, sizeof(wins));
+	for (int i = 0; i < 2; ++i) {
+		wins[i].vblk = src;
+		wins[i].valid = valid;
+		wins[i].buf = nvm_buf_alloc(geo, WIN_NSECS * SECTOR_NBYTES);
+		if (!wins[i].buf) {
+			nvm_buf_free(wins[0].buf);
+			errno = ENOMEM;
+			return -1;
+		}
+	}
+
+	// Read window `w + 1` while writing window `w`
+	wins[0].sec = sec_bgn;
+	wins[0].nsecs = NVM_MIN_SZ(WIN_NSECS, sec_end - sec_bgn);
+	_copy_start(&wins[0]);
+
+	for (size_t sec = sec_bgn, w = 0; sec < sec_end; sec += WIN_NSECS, ++w) {
+		struct nvm_vblk_copy_win *cur = &wins[w % 2];
+		struct nvm_vblk_copy_win *next = &wins[(w + 1) % 2];
+
+		_copy_wait(cur);
+		if (cur->err) {
+			err = EIO;
+			break;
+		}
+
+		if (sec + WIN_NSECS < sec_end) {
+			next->sec = sec + WIN_NSECS;
+			next->bit = next->sec - sec_bgn;
+			next->nsecs = NVM_MIN_SZ(WIN_NSECS,
+						 sec_end - next->sec);
+			_copy_start(next);
+		}
+
+		if (nvm_vblk_append(dst, cur->buf, cur->len) < 0) {
+			err = errno;
+			break;
+		}
+		nbytes += cur->len;
+	}
+
+	for (int i = 0; i < 2; ++i) {
+		_copy_wait(&wins[i]);
+		nvm_buf_free(wins[i].buf);
+	}
+
+	if (err) {
+		errno = err;
+		return -1;
+	}
+
+	return nbytes;
+}
+
+/**
+ * Prefetch the pending windows, lowest offset first, until told to stop.
+ *
+ * Windows only cover bytes below the write cursor, as sampled when they were
+ * queued, so they are read from the device without touching the
+ * write-combining buffer of the vblk.
+ */
+static void *_ra_worker(void *arg)
+{
+	struct nvm_vblk_ra *ra = arg;
+
+	pthread_mutex_lock(&ra->lock);
+	while (!ra->stop) {
+		struct nvm_vblk_ra_win *win = NULL;
+		int err;
+
+		for (int i = 0; i < 2; ++i) {
+			if (ra->wins[i].pending &&
+			    (!win || (ra->wins[i].off < win->off)))
+				win = &ra->wins[i];
+		}
+		if (!win) {
+			pthread_cond_wait(&ra->cond, &ra->lock);
+			continue;
+		}
+		pthread_mutex_unlock(&ra->lock);
+
+		err = _vblk_pread(win->vblk, win->buf, win->len, win->off) < 0;
+
+		pthread_mutex_lock(&ra->lock);
+		win->err = err;
+		win->pending = 0;
+		pthread_cond_broadcast(&ra->cond);
+	}
+	pthread_mutex_unlock(&ra->lock);
+
+	return NULL;
+}
+
+/**
+ * Find the window holding offset `pos`, waiting for its prefetch to finish
+ *
+ * @returns The window on success, NULL when no window holds `pos` or when its
+ * prefetch failed
+ */
+static struct nvm_vblk_ra_win *_ra_find(struct nvm_vblk_ra *ra, size_t pos)
+{
+	for (int i = 0; i < 2; ++i) {
+		struct nvm_vblk_ra_win *win = &ra->wins[i];
+
+		if (!win->len || (pos < win->off) || (pos >= win->off + win->len))
+			continue;
+
+		_ra_wait(ra, win);
+		if (win->err) {
+			win->len = 0;
+			return NULL;
+		}
+
+		return win;
+	}
+
+	return NULL;
+}
+
+/**
+ * Queue the prefetch of the window following `pos` and the one after it, into
+ * the windows which do not hold either of them. Windows are clamped to the
+ * write cursor, unwritten bytes are never prefetched.
+ */
+static void _ra_fill(struct nvm_vblk *vblk, size_t pos)
+{
+	struct nvm_vblk_ra *ra = vblk->ra;
+	const size_t end = vblk->pos_write;
+	size_t want[2];
+
+	want[0] = (pos / ra->nbytes) * ra->nbytes;
+	want[1] = want[0] + ra->nbytes;
+
+	for (int w = 0; w < 2; ++w) {
+		struct nvm_vblk_ra_win *win = NULL;
+		int held = 0;
+
+		if (want[w] >= end)
+			break;
+
+		for (int i = 0; i < 2; ++i) {
+			if (ra->wins[i].len && ra->wins[i].off == want[w])
+				held = 1;
+		}
+		if (held)
+			continue;
+
+		for (int i = 0; i < 2 && !win; ++i) {	// Window not wanted
+			const size_t off = ra->wins[i].off;
+
+			if (!ra->wins[i].len || ((off != want[0]) && (off != want[1])))
+				win = &ra->wins[i];
+		}
+		if (!win)
+			break;
+
+		_ra_wait(ra, win);
+
+		win->off = want[w];
+		win->len = NVM_MIN_SZ(ra->nbytes, end - want[w]);
+		win->err = 0;
+
+		pthread_mutex_lock(&ra->lock);
+		win->pending = 1;
+		pthread_cond_broadcast(&ra->cond);
+		pthread_mutex_unlock(&ra->lock);
+	}
+}
+
+/**
+ * Read via the read-ahead windows, bytes not held by a window are read
+ * synchronously. Prefetching is started when the read continues the previous
+ * one.
+ */
+static ssize_t _ra_read(struct nvm_vblk *vblk, char *buf, size_t count,
+			size_t offset)
+{
+	struct nvm_vblk_ra *ra = vblk->ra;
+	const int seq = offset == ra->pos_expect;
+	size_t pos = offset;
+
+	if (offset + count > vblk->nbytes) {		// Check bounds
+		errno = EINVAL;
+		return -1;
+	}
+
+	while (pos < offset + count) {			// Served by windows
+		struct nvm_vblk_ra_win *win = _ra_find(ra, pos);
+		size_t nbytes;
+
+		if (!win)
+			break;
+
+		nbytes = NVM_MIN_SZ(offset + count, win->off + win->len) - pos;
+		memcpy(buf + (pos - offset), win->buf + (pos - win->off),
+		       nbytes);
+		pos += nbytes;
+	}
+
+	if (!seq)					// Random access
+		_ra_drop(ra);
+
+	if ((pos < offset + count) &&
+	    (nvm_vblk_pread(vblk, buf + (pos - offset), offset + count - pos,
+			    pos) < 0))
+		return -1;	// Propagate errno
+
+	ra->pos_expect = offset + count;
+	if (seq)
+		_ra_fill(vblk, offset + count);
+
+	return count;
+}
+
+ssize_t nvm_vblk_read(struct nvm_vblk *vblk, void *buf, size_t count)
+{
+	ssize_t nbytes;
+
+	if (vblk->ra)
+		nbytes = _ra_read(vblk, buf, count, vblk->pos_read);
+	else
+		nbytes = nvm_vblk_pread(vblk, buf, count, vblk->pos_read);
+
+	if (nbytes < 0)
+		return nbytes;		// Propagate `errno`
+
+	vblk->pos_read += nbytes;	// All is good, increment read position
+
+	return nbytes;			// Return number of bytes read
+}
+
+int nvm_vblk_off2addr(struct nvm_vblk *vblk, size_t off,
+		      struct nvm_addr *addr)
+{
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+
+	if (!addr || (off >= vblk->nbytes)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	*addr = _vblk_sec2addr(vblk, geo, off / geo->sector_nbytes);
+
+	return 0;
+}
+
+int nvm_vblk_get_layout(struct nvm_vblk *vblk)
+{
+	return vblk->layout;
+}
+
+int nvm_vblk_get_width(struct nvm_vblk *vblk)
+{
+	return _vblk_width(vblk);
+}
+
+int nvm_vblk_get_io_class(struct nvm_vblk *vblk)
+{
+	return vblk->io_class;
+}
+
+int nvm_vblk_set_io_class(struct nvm_vblk *vblk, int io_class)
+{
+	if ((io_class < 0) || (io_class >= NVM_IO_NCLASSES)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	vblk->io_class = io_class;
+
+	return 0;
+}
+
+struct nvm_addr *nvm_vblk_get_parity(struct nvm_vblk *vblk)
+{
+	return vblk->parity ? &vblk->pblk : NULL;
+}
+
+int nvm_vblk_set_parity(struct nvm_vblk *vblk, const struct nvm_addr *blk)
+{
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+
+	if (!blk) {
+		nvm_vblk_set_hedge(vblk, 0);
+		vblk->parity = 0;
+		return 0;
+	}
+
+	if ((vblk->nblks < 1) || nvm_addr_check(*blk, geo) ||
+	    ((vblk->layout & ~NVM_VBLK_LAYOUT_LUN_FIRST) !=
+	     NVM_VBLK_LAYOUT_PAGE) || (_vblk_width(vblk) != vblk->nblks) ||
+	    vblk->pos_write || vblk->wbuf_len) {	// Written without parity
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (int idx = 0; idx < vblk->nblks; ++idx) {	// Separate LUN
+		if ((vblk->blks[idx].g.ch == blk->g.ch) &&
+		    (vblk->blks[idx].g.lun == blk->g.lun)) {
+			errno = EINVAL;
+			return -1;
+		}
+	}
+
+	vblk->pblk.ppa = 0;
+	vblk->pblk.g.ch = blk->g.ch;
+	vblk->pblk.g.lun = blk->g.lun;
+	vblk->pblk.g.blk = blk->g.blk;
+	vblk->parity = 1;
+
+	return 0;
+}
+
+int nvm_vblk_get_hedge(struct nvm_vblk *vblk)
+{
+	return vblk->hedge ? vblk->hedge->threshold_us : 0;
+}
+
+/**
+ * Stop the workers of the first `nslots` slots and free the hedging state
+ */
+static void _hedge_free(struct nvm_vblk_hedge *hedge, int nslots)
+{
+	pthread_mutex_lock(&hedge->lock);
+	hedge->stop = 1;
+	pthread_cond_broadcast(&hedge->cond);
+	pthread_mutex_unlock(&hedge->lock);
+
+	for (int m = 0; m < nslots; ++m)	// Late reads complete first
+		pthread_join(hedge->slots[m].worker, NULL);
+
+	pthread_cond_destroy(&hedge->cond);
+	pthread_mutex_destroy(&hedge->lock);
+	for (int m = 0; m < hedge->nslots; ++m)
+		nvm_buf_free(hedge->slots[m].buf);
+	free(hedge->slots);
+	free(hedge);
+}
+
+int nvm_vblk_set_hedge(struct nvm_vblk *vblk, int threshold_us)
+{
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+	struct nvm_vblk_hedge *hedge;
+	int err = 0;
+
+	if ((threshold_us < 0) || (threshold_us && !vblk->parity)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (vblk->hedge) {				// Tear down
+		_hedge_free(vblk->hedge, vblk->hedge->nslots);
+		vblk->hedge = NULL;
+	}
+	if (!threshold_us)
+		return 0;
+
+	hedge = calloc(1, sizeof(*hedge));
+	if (!hedge) {
+		errno = ENOMEM;
+		return -1;
+	}
+	hedge->threshold_us = threshold_us;
+	hedge->nslots = vblk->nblks;
+	hedge->slots = calloc(hedge->nslots, sizeof(*hedge->slots));
+	if (!hedge->slots) {
+		free(hedge);
+		errno = ENOMEM;
+		return -1;
+	}
+	for (int m = 0; m < hedge->nslots; ++m) {
+		hedge->slots[m].vblk = vblk;
+		hedge->slots[m].hedge = hedge;
+		hedge->slots[m].buf = nvm_buf_alloc(geo, NVM_NADDR_MAX *
+						    geo->sector_nbytes);
+		if (!hedge->slots[m].buf)
+			err = ENOMEM;
+	}
+
+	if (!err && pthread_mutex_init(&hedge->lock, NULL)) {
+		err = ENOMEM;
+	} else if (!err && pthread_cond_init(&hedge->cond, NULL)) {
+		pthread_mutex_destroy(&hedge->lock);
+		err = ENOMEM;
+	}
+	if (err) {
+		for (int m = 0; m < hedge->nslots; ++m)
+			nvm_buf_free(hedge->slots[m].buf);
+		free(hedge->slots);
+		free(hedge);
+		errno = err;
+		return -1;
+	}
+
+	for (int m = 0; m < hedge->nslots; ++m) {
+		if (pthread_create(&hedge->slots[m].worker, NULL,
+				   _hedge_worker, &hedge->slots[m])) {
+			_hedge_free(hedge, m);
+			errno = EAGAIN;
+			return -1;
+		}
+	}
+	vblk->hedge = hedge;
+
+	return 0;
+}
+
+struct nvm_addr *nvm_vblk_get_addrs(struct nvm_vblk *vblk)
+{
+	return vblk->blks;
+}
+
+int nvm_vblk_get_naddrs(struct nvm_vblk *vblk)
+{
+	return vblk->nblks;
+}
+
+size_t nvm_vblk_get_nbytes(struct nvm_vblk *vblk)
+{
+	return vblk->nbytes;
+}
+
+int nvm_vblk_get_readahead(struct nvm_vblk *vblk)
+{
+	return vblk->ra ? vblk->ra->nstripes : 0;
+}
+
+int nvm_vblk_set_readahead(struct nvm_vblk *vblk, int nstripes)
+{
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+	const size_t STRIPE = geo->nplanes * geo->nsectors *
+			      geo->sector_nbytes * vblk->nblks;
+	struct nvm_vblk_ra *ra;
+	int err = 0;
+
+	if (nstripes < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (vblk->ra) {					// Tear down
+		ra = vblk->ra;
+
+		_ra_drop(ra);
+
+		pthread_mutex_lock(&ra->lock);
+		ra->stop = 1;
+		pthread_cond_broadcast(&ra->cond);
+		pthread_mutex_unlock(&ra->lock);
+		pthread_join(ra->worker, NULL);
+
+		pthread_cond_destroy(&ra->cond);
+		pthread_mutex_destroy(&ra->lock);
+		for (int i = 0; i < 2; ++i)
+			nvm_buf_free(ra->wins[i].buf);
+		free(ra);
+		vblk->ra = NULL;
+	}
+	if (!nstripes)
+		return 0;
+
+	ra = calloc(1, sizeof(*ra));
+	if (!ra) {
+		errno = ENOMEM;
+		return -1;
+	}
+	ra->nstripes = nstripes;
+	ra->nbytes = nstripes * STRIPE;
+
+	for (int i = 0; i < 2; ++i) {
+		ra->wins[i].vblk = vblk;
+		ra->wins[i].buf = nvm_buf_alloc(geo, ra->nbytes);
+		if (!ra->wins[i].buf) {
+			nvm_buf_free(ra->wins[0].buf);
+			free(ra);
+			errno = ENOMEM;
+			return -1;
+		}
+	}
+
+	if (pthread_mutex_init(&ra->lock, NULL)) {
+		err = ENOMEM;
+	} else if (pthread_cond_init(&ra->cond, NULL)) {
+		pthread_mutex_destroy(&ra->lock);
+		err = ENOMEM;
+	} else if (pthread_create(&ra->worker, NULL, _ra_worker, ra)) {
+		pthread_cond_destroy(&ra->cond);
+		pthread_mutex_destroy(&ra->lock);
+		err = EAGAIN;
+	}
+	if (err) {
+		for (int i = 0; i < 2; ++i)
+			nvm_buf_free(ra->wins[i].buf);
+		free(ra);
+		errno = err;
+		return -1;
+	}
+	vblk->ra = ra;
+
+	return 0;
 }
 
 size_t nvm_vblk_get_pos_read(struct nvm_vblk *vblk)
@@ -409,6 +2610,11 @@ size_t nvm_vblk_get_pos_write(struct nvm_vblk *vblk)
 	return vblk->pos_write;
 }
 
+size_t nvm_vblk_get_pos_append(struct nvm_vblk *vblk)
+{
+	return vblk->pos_write + vblk->wbuf_len;
+}
+
 int nvm_vblk_set_pos_read(struct nvm_vblk *vblk, size_t pos)
 {
 	if (pos > vblk->nbytes) {
@@ -423,7 +2629,7 @@ int nvm_vblk_set_pos_read(struct nvm_vblk *vblk, size_t pos)
 
 int nvm_vblk_set_pos_write(struct nvm_vblk *vblk, size_t pos)
 {
-	if (pos > vblk->nbytes) {
+	if ((pos > vblk->nbytes) || vblk->wbuf_len) {
 		errno = EINVAL;
 		return -1;
 	}
@@ -433,15 +2639,342 @@ int nvm_vblk_set_pos_write(struct nvm_vblk *vblk, size_t pos)
 	return 0;
 }
 
+/**
+ * Probe whether the page `pg` of member block `idx` has been written, by
+ * reading the first sector of its first plane
+ *
+ * @returns 1 when written, 0 when empty or unreadable, -1 on error
+ */
+static inline int _pg_written(struct nvm_vblk *vblk, int idx, int pg,
+			      void *buf)
+{
+	struct nvm_ret ret = {0,0};
+	struct nvm_addr addr;
+	int io_class;
+	ssize_t err;
+
+	addr.ppa = vblk->blks[idx].ppa;
+	addr.g.pg = pg;
+	addr.g.pl = 0;
+	addr.g.sec = 0;
+
+	io_class = nvm_sched_io_class_set(vblk->io_class);
+	err = nvm_addr_read(vblk->dev, &addr, 1, buf, NULL,
+			    NVM_FLAG_PMODE_SNGL, &ret);
+	nvm_sched_io_class_set(io_class);
+	if (!err)
+		return 1;
+
+	if ((ret.result & ~NVM_S12_STATUS_DNR) == NVM_S12_STATUS_EMPTY_PAGE)
+		return 0;
+
+	return errno == EIO ? 0 : -1;	// Read-error: treat as not written
+}
+
+ssize_t nvm_vblk_recover_pos(struct nvm_vblk *vblk)
+{
+	size_t nerr = 0;
+	const struct nvm_geo *geo = nvm_dev_get_geo(vblk->dev);
+
+	const int SPAGE_NADDRS = geo->nplanes * geo->nsectors;
+	const size_t ALIGN = SPAGE_NADDRS * geo->sector_nbytes;
+	const int NTHREADS = vblk->nblks < 1 ? 1 : vblk->nblks;
+
+	int npgs[NTHREADS];
+	size_t spg;
+
+	#pragma omp parallel for num_threads(NTHREADS) schedule(static,1) reduction(+:nerr) if(NTHREADS>1)
+	for (int idx = 0; idx < vblk->nblks; ++idx) {
+		int bgn = 0;		// First unwritten page is in [bgn, end]
+		int end = geo->npages;
+		struct nvm_spec_chunk chunk;
+		char *buf;
+
+		// Use the write pointer when reported, probe the pages otherwise
+		if (!nvm_chunk_get(vblk->dev, vblk->blks[idx], &chunk, NULL)) {
+			npgs[idx] = (chunk.wp + SPAGE_NADDRS - 1) / SPAGE_NADDRS;
+			continue;
+		}
+
+		buf = nvm_buf_alloc(geo, geo->sector_nbytes);
+		if (!buf) {
+			++nerr;
+			continue;
+		}
+
+		while (bgn < end) {
+			const int pg = bgn + (end - bgn) / 2;
+			const int written = _pg_written(vblk, idx, pg, buf);
+
+			if (written < 0) {
+				++nerr;
+				break;
+			}
+
+			if (written)
+				bgn = pg + 1;
+			else
+				end = pg;
+		}
+		npgs[idx] = bgn;
+
+		nvm_buf_free(buf);
+	}
+
+	if (nerr) {
+		errno = EIO;
+		return -1;
+	}
+
+	// The write position is the first super-page, in striping order, not
+	// yet written, see _vblk_spg2blk
+	spg = vblk->nblks * geo->npages;
+	for (int idx = 0; idx < vblk->nblks; ++idx) {
+		const size_t cand = _vblk_blk2spg(vblk, geo, idx, npgs[idx]);
+
+		if (npgs[idx] < (int)geo->npages && cand < spg)
+			spg = cand;
+	}
+
+	vblk->pos_write = spg * ALIGN;
+	vblk->wbuf_len = 0;		// Unflushed appends are lost
+
+	return vblk->pos_write;
+}
+
+static void _fifo_push(struct nvm_vblk_eahead_fifo *fifo,
+		       struct nvm_vblk_eahead_ent *ent)
+{
+	ent->next = NULL;
+	if (fifo->tail)
+		fifo->tail->next = ent;
+	else
+		fifo->head = ent;
+	fifo->tail = ent;
+	++(fifo->len);
+}
+
+static struct nvm_vblk_eahead_ent *_fifo_pop(struct nvm_vblk_eahead_fifo *fifo)
+{
+	struct nvm_vblk_eahead_ent *ent = fifo->head;
+
+	if (!ent)
+		return NULL;
+
+	fifo->head = ent->next;
+	if (!fifo->head)
+		fifo->tail = NULL;
+	--(fifo->len);
+
+	return ent;
+}
+
+static void _fifo_free(struct nvm_vblk_eahead_fifo *fifo)
+{
+	struct nvm_vblk_eahead_ent *ent;
+
+	while ((ent = _fifo_pop(fifo))) {
+		nvm_vblk_free(ent->vblk);
+		free(ent);
+	}
+}
+
+static void *_eahead_worker(void *arg)
+{
+	struct nvm_vblk_eahead *ea = arg;
+
+	pthread_mutex_lock(&ea->lock);
+	while (!ea->stop) {
+		struct nvm_vblk_eahead_ent *ent;
+		ssize_t err;
+
+		if (!ea->pending.len || (ea->ready.len >= ea->depth)) {
+			pthread_cond_wait(&ea->cond, &ea->lock);
+			continue;
+		}
+
+		ent = _fifo_pop(&ea->pending);
+		ea->erasing = 1;
+		pthread_mutex_unlock(&ea->lock);
+
+		err = nvm_vblk_erase(ent->vblk);
+
+		pthread_mutex_lock(&ea->lock);
+		_fifo_push(err < 0 ? &ea->failed : &ea->ready, ent);
+		ea->erasing = 0;
+		pthread_cond_broadcast(&ea->cond);
+	}
+	pthread_mutex_unlock(&ea->lock);
+
+	return NULL;
+}
+
+struct nvm_vblk_eahead *nvm_vblk_eahead_create(int depth)
+{
+	struct nvm_vblk_eahead *ea;
+
+	if (depth < 1) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	ea = calloc(1, sizeof(*ea));
+	if (!ea) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	ea->depth = depth;
+
+	if (pthread_mutex_init(&ea->lock, NULL)) {
+		free(ea);
+		errno = ENOMEM;
+		return NULL;
+	}
+	if (pthread_cond_init(&ea->cond, NULL)) {
+		pthread_mutex_destroy(&ea->lock);
+		free(ea);
+		errno = ENOMEM;
+		return NULL;
+	}
+	if (pthread_create(&ea->worker, NULL, _eahead_worker, ea)) {
+		pthread_cond_destroy(&ea->cond);
+		pthread_mutex_destroy(&ea->lock);
+		free(ea);
+		errno = EAGAIN;
+		return NULL;
+	}
+
+	return ea;
+}
+
+void nvm_vblk_eahead_destroy(struct nvm_vblk_eahead *ea)
+{
+	if (!ea)
+		return;
+
+	pthread_mutex_lock(&ea->lock);
+	ea->stop = 1;
+	pthread_cond_broadcast(&ea->cond);
+	pthread_mutex_unlock(&ea->lock);
+
+	pthread_join(ea->worker, NULL);
+
+	_fifo_free(&ea->pending);
+	_fifo_free(&ea->ready);
+	_fifo_free(&ea->failed);
+
+	pthread_cond_destroy(&ea->cond);
+	pthread_mutex_destroy(&ea->lock);
+	free(ea);
+}
+
+int nvm_vblk_eahead_put(struct nvm_vblk_eahead *ea, struct nvm_vblk *vblk)
+{
+	struct nvm_vblk_eahead_ent *ent;
+
+	if (!ea || !vblk) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	ent = malloc(sizeof(*ent));
+	if (!ent) {
+		errno = ENOMEM;
+		return -1;
+	}
+	ent->vblk = vblk;
+
+	pthread_mutex_lock(&ea->lock);
+	_fifo_push(&ea->pending, ent);
+	pthread_cond_broadcast(&ea->cond);
+	pthread_mutex_unlock(&ea->lock);
+
+	return 0;
+}
+
+struct nvm_vblk *nvm_vblk_eahead_get(struct nvm_vblk_eahead *ea)
+{
+	struct nvm_vblk_eahead_ent *ent;
+	struct nvm_vblk *vblk;
+
+	if (!ea) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	pthread_mutex_lock(&ea->lock);
+	while (!ea->ready.len && (ea->pending.len || ea->erasing))
+		pthread_cond_wait(&ea->cond, &ea->lock);
+
+	ent = _fifo_pop(&ea->ready);
+	if (ent)
+		pthread_cond_broadcast(&ea->cond);	// Room for another
+	pthread_mutex_unlock(&ea->lock);
+
+	if (!ent) {
+		errno = ENOENT;
+		return NULL;
+	}
+
+	vblk = ent->vblk;
+	free(ent);
+
+	return vblk;
+}
+
+struct nvm_vblk *nvm_vblk_eahead_get_failed(struct nvm_vblk_eahead *ea)
+{
+	struct nvm_vblk_eahead_ent *ent;
+	struct nvm_vblk *vblk;
+
+	if (!ea) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	pthread_mutex_lock(&ea->lock);
+	ent = _fifo_pop(&ea->failed);
+	pthread_mutex_unlock(&ea->lock);
+
+	if (!ent) {
+		errno = ENOENT;
+		return NULL;
+	}
+
+	vblk = ent->vblk;
+	free(ent);
+
+	return vblk;
+}
+
+int nvm_vblk_eahead_nready(struct nvm_vblk_eahead *ea)
+{
+	int nready;
+
+	pthread_mutex_lock(&ea->lock);
+	nready = ea->ready.len;
+	pthread_mutex_unlock(&ea->lock);
+
+	return nready;
+}
+
 void nvm_vblk_pr(struct nvm_vblk *vblk)
 {
 	printf("vblk:\n");
 	printf("  dev: {pmode: '%s'}\n", nvm_pmode_str(nvm_dev_get_pmode(vblk->dev)));
 	printf("  nblks: %"PRIi32"\n", vblk->nblks);
+	printf("  layout: {id: %d, width: %d}\n", vblk->layout,
+	       _vblk_width(vblk));
+	printf("  hedge_us: %d\n", nvm_vblk_get_hedge(vblk));
+	printf("  chunked: %d\n", vblk->chunked);
 	printf("  nmbytes: %zu\n", vblk->nbytes >> 20);
 	printf("  pos_write: %zu\n", vblk->pos_write);
 	printf("  pos_read: %zu\n", vblk->pos_read);
 	printf("  struct_nbytes: %zu\n", sizeof(*vblk));
         nvm_addr_prn(vblk->blks, vblk->nblks);
+	if (vblk->parity) {
+		printf("  parity:\n");
+		nvm_addr_prn(&vblk->pblk, 1);
+	}
 }
 
@@ -3,6 +3,7 @@
 #include <errno.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
 #include <liblightnvm.h>
 
 #include <CUnit/Basic.h>
@@ -419,6 +420,586 @@ void test_NADDR_META1_QUAD(void)
 	}
 }
 
+void test_NADDR_SPLIT(void)
+{
+	const int pmode = nvm_dev_get_pmode(dev);
+	const int naddrs = geo->npages * geo->nplanes * geo->nsectors;
+	const size_t buf_nbytes = naddrs * geo->sector_nbytes;
+	struct nvm_addr *addrs = NULL;
+	char *buf_w = NULL, *buf_r = NULL;
+	struct nvm_ret ret;
+	ssize_t res;
+
+	++blk_addr.g.blk;
+
+	printf("INFO: SPLIT naddrs(%d) on ", naddrs);
+	nvm_addr_pr(blk_addr);
+
+	addrs = malloc(sizeof(*addrs) * naddrs);
+	buf_w = nvm_buf_alloc(geo, buf_nbytes);
+	buf_r = nvm_buf_alloc(geo, buf_nbytes);
+	if (!addrs || !buf_w || !buf_r) {
+		CU_FAIL("Allocation failure");
+		goto exit_split;
+	}
+	nvm_buf_fill(buf_w, buf_nbytes);
+
+	for (size_t pl = 0; pl < geo->nplanes; ++pl) {	// Erase
+		addrs[pl].ppa = blk_addr.ppa;
+		addrs[pl].g.pl = pl;
+	}
+	res = nvm_addr_erase(dev, addrs, geo->nplanes, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Erase failure");
+		goto exit_split;
+	}
+
+	for (int i = 0; i < naddrs; ++i) {		// Entire block
+		addrs[i].ppa = blk_addr.ppa;
+		addrs[i].g.pg = i / (geo->nplanes * geo->nsectors);
+		addrs[i].g.pl = (i / geo->nsectors) % geo->nplanes;
+		addrs[i].g.sec = i % geo->nsectors;
+	}
+
+	res = nvm_addr_write(dev, addrs, naddrs, buf_w, NULL, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Write failure");
+		goto exit_split;
+	}
+
+	res = nvm_addr_read(dev, addrs, naddrs, buf_r, NULL, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Read failure: command error");
+		goto exit_split;
+	}
+
+	if (compare_buffers(buf_r, buf_w, buf_nbytes))
+		CU_FAIL("Read failure: buffer mismatch");
+
+exit_split:
+	nvm_buf_free(buf_r);
+	nvm_buf_free(buf_w);
+	free(addrs);
+}
+
+void test_STATUS(void)
+{
+	const int pmode = nvm_dev_get_pmode(dev);
+	const int spage = geo->nplanes * geo->nsectors;
+	const int naddrs = 2 * spage;
+	const size_t buf_nbytes = naddrs * geo->sector_nbytes;
+	struct nvm_addr addrs[naddrs];
+	char *buf_w = NULL, *buf_r = NULL;
+	struct nvm_ret ret = {0,0};
+	uint64_t written, empty;
+	ssize_t res;
+
+	if (naddrs > 64) {
+		CU_PASS("Two pages exceed the completion bitmap");
+		return;
+	}
+	written = (1ULL << spage) - 1;
+	empty = ((naddrs < 64 ? 1ULL << naddrs : 0) - 1) & ~written;
+
+	++blk_addr.g.blk;
+
+	buf_w = nvm_buf_alloc(geo, buf_nbytes);
+	buf_r = nvm_buf_alloc(geo, buf_nbytes);
+	if (!buf_w || !buf_r) {
+		CU_FAIL("Allocation failure");
+		goto exit_status;
+	}
+	nvm_buf_fill(buf_w, buf_nbytes);
+
+	for (size_t pl = 0; pl < geo->nplanes; ++pl) {	// Erase
+		addrs[pl].ppa = blk_addr.ppa;
+		addrs[pl].g.pl = pl;
+	}
+	res = nvm_addr_erase(dev, addrs, geo->nplanes, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Erase failure");
+		goto exit_status;
+	}
+
+	for (int i = 0; i < naddrs; ++i) {		// First two pages
+		addrs[i].ppa = blk_addr.ppa;
+		addrs[i].g.pg = i / spage;
+		addrs[i].g.pl = (i / geo->nsectors) % geo->nplanes;
+		addrs[i].g.sec = i % geo->nsectors;
+	}
+
+	res = nvm_addr_write(dev, addrs, spage, buf_w, NULL, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Write failure");
+		goto exit_status;
+	}
+
+	// Reading the written and the empty page fails for the empty page only
+	ret.status = 0;
+	ret.result = 0;
+	res = nvm_addr_read(dev, addrs, naddrs, buf_r, NULL, pmode, &ret);
+	CU_ASSERT(res < 0);
+	CU_ASSERT((ret.status & empty) == empty);
+	CU_ASSERT(!(ret.status & ~(written | empty)));
+	if (ret.status & written)	// Backend does not report per address
+		CU_ASSERT((ret.status & written) == written);
+
+exit_status:
+	nvm_buf_free(buf_r);
+	nvm_buf_free(buf_w);
+}
+
+void test_COPY(void)
+{
+	const int pmode = nvm_dev_get_pmode(dev);
+	const int naddrs = geo->nplanes * geo->nsectors;
+	const size_t buf_nbytes = naddrs * geo->sector_nbytes;
+	struct nvm_addr src[naddrs], dst[naddrs];
+	char *buf_w = NULL, *buf_r = NULL;
+	struct nvm_ret ret;
+	ssize_t res;
+
+	++blk_addr.g.blk;
+
+	printf("INFO: COPY naddrs(%d), vcopy(%d) on ", naddrs,
+	       nvm_dev_get_vcopy(dev));
+	nvm_addr_pr(blk_addr);
+
+	buf_w = nvm_buf_alloc(geo, buf_nbytes);
+	buf_r = nvm_buf_alloc(geo, buf_nbytes);
+	if (!buf_w || !buf_r) {
+		CU_FAIL("Allocation failure");
+		goto exit_copy;
+	}
+	nvm_buf_fill(buf_w, buf_nbytes);
+
+	for (int i = 0; i < naddrs; ++i) {		// First page of blocks
+		src[i].ppa = blk_addr.ppa;
+		src[i].g.pl = (i / geo->nsectors) % geo->nplanes;
+		src[i].g.sec = i % geo->nsectors;
+
+		dst[i] = src[i];
+		dst[i].g.blk = blk_addr.g.blk + 1;
+	}
+
+	res = nvm_addr_erase(dev, src, geo->nplanes, pmode, &ret);
+	res |= nvm_addr_erase(dev, dst, geo->nplanes, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Erase failure");
+		goto exit_copy;
+	}
+
+	res = nvm_addr_write(dev, src, naddrs, buf_w, NULL, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Write failure");
+		goto exit_copy;
+	}
+
+	CU_ASSERT(nvm_addr_copy(dev, src, dst, 0, NVM_FLAG_PMODE_SNGL, &ret));
+
+	res = nvm_addr_copy(dev, src, dst, naddrs, NVM_FLAG_PMODE_SNGL, &ret);
+	if (res < 0) {
+		CU_FAIL("Copy failure");
+		goto exit_copy;
+	}
+
+	res = nvm_addr_read(dev, dst, naddrs, buf_r, NULL, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Read failure: command error");
+		goto exit_copy;
+	}
+
+	if (compare_buffers(buf_r, buf_w, buf_nbytes))
+		CU_FAIL("Read failure: buffer mismatch");
+
+exit_copy:
+	++blk_addr.g.blk;
+	nvm_buf_free(buf_r);
+	nvm_buf_free(buf_w);
+}
+
+void test_SQ_PMODE(void)
+{
+	const int pmode = nvm_dev_get_pmode(dev);
+	const int naddrs = geo->nplanes * geo->nsectors;
+	const size_t buf_nbytes = naddrs * geo->sector_nbytes;
+	struct nvm_addr addrs[naddrs];
+	char *buf_w = NULL, *buf_r = NULL;
+	struct nvm_ret ret;
+	ssize_t res;
+	int nerr = 0;
+
+	++blk_addr.g.blk;
+
+	buf_w = nvm_buf_alloc(geo, buf_nbytes);
+	buf_r = nvm_buf_alloc(geo, buf_nbytes);
+	if (!buf_w || !buf_r) {
+		CU_FAIL("Allocation failure");
+		goto exit_sq;
+	}
+	nvm_buf_fill(buf_w, buf_nbytes);
+
+	for (size_t pl = 0; pl < geo->nplanes; ++pl) {	// Erase
+		addrs[pl].ppa = blk_addr.ppa;
+		addrs[pl].g.pl = pl;
+	}
+	res = nvm_addr_erase(dev, addrs, geo->nplanes, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Erase failure");
+		goto exit_sq;
+	}
+
+	for (int i = 0; i < naddrs; ++i) {		// First page
+		addrs[i].ppa = blk_addr.ppa;
+		addrs[i].g.pl = (i / geo->nsectors) % geo->nplanes;
+		addrs[i].g.sec = i % geo->nsectors;
+	}
+
+	CU_ASSERT(!nvm_dev_set_sq(dev, NVM_SQ_PMODE, 1000));
+
+	// Each plane written by an independent single-plane command
+	#pragma omp parallel for num_threads(geo->nplanes) reduction(+:nerr)
+	for (int pl = 0; pl < (int)geo->nplanes; ++pl) {
+		struct nvm_ret pl_ret;
+		const int bgn = pl * geo->nsectors;
+
+		if (nvm_addr_write(dev, addrs + bgn, geo->nsectors,
+				   buf_w + bgn * geo->sector_nbytes, NULL,
+				   NVM_FLAG_PMODE_SNGL, &pl_ret) < 0)
+			++nerr;
+	}
+
+	CU_ASSERT(!nvm_dev_set_sq(dev, NVM_SQ_NONE, 0));
+	if (nerr) {
+		CU_FAIL("Write failure");
+		goto exit_sq;
+	}
+
+	res = nvm_addr_read(dev, addrs, naddrs, buf_r, NULL, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Read failure: command error");
+		goto exit_sq;
+	}
+
+	if (compare_buffers(buf_r, buf_w, buf_nbytes))
+		CU_FAIL("Read failure: buffer mismatch");
+
+exit_sq:
+	nvm_buf_free(buf_r);
+	nvm_buf_free(buf_w);
+}
+
+void test_SQ_MERGE(void)
+{
+	const int pmode = nvm_dev_get_pmode(dev);
+	const int naddrs = geo->nplanes * geo->nsectors;
+	const size_t buf_nbytes = naddrs * geo->sector_nbytes;
+	struct nvm_addr addrs[naddrs];
+	char *buf_w = NULL, *buf_r = NULL;
+	struct nvm_ret ret;
+	ssize_t res;
+	int nerr = 0;
+
+	++blk_addr.g.blk;
+
+	buf_w = nvm_buf_alloc(geo, buf_nbytes);
+	buf_r = nvm_buf_alloc(geo, buf_nbytes);
+	if (!buf_w || !buf_r) {
+		CU_FAIL("Allocation failure");
+		goto exit_merge;
+	}
+	nvm_buf_fill(buf_w, buf_nbytes);
+	memset(buf_r, 0, buf_nbytes);
+
+	for (size_t pl = 0; pl < geo->nplanes; ++pl) {	// Erase
+		addrs[pl].ppa = blk_addr.ppa;
+		addrs[pl].g.pl = pl;
+	}
+	res = nvm_addr_erase(dev, addrs, geo->nplanes, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Erase failure");
+		goto exit_merge;
+	}
+
+	for (int i = 0; i < naddrs; ++i) {		// First page
+		addrs[i].ppa = blk_addr.ppa;
+		addrs[i].g.pl = (i / geo->nsectors) % geo->nplanes;
+		addrs[i].g.sec = i % geo->nsectors;
+	}
+
+	res = nvm_addr_write(dev, addrs, naddrs, buf_w, NULL, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Write failure");
+		goto exit_merge;
+	}
+
+	CU_ASSERT(!nvm_dev_set_sq(dev, NVM_SQ_MERGE, 1000));
+
+	// Each sector read by an independent single-address command
+	#pragma omp parallel for num_threads(naddrs) reduction(+:nerr)
+	for (int i = 0; i < naddrs; ++i) {
+		struct nvm_ret sec_ret;
+
+		if (nvm_addr_read(dev, addrs + i, 1,
+				  buf_r + i * geo->sector_nbytes, NULL,
+				  NVM_FLAG_PMODE_SNGL, &sec_ret) < 0)
+			++nerr;
+	}
+
+	CU_ASSERT(!nvm_dev_set_sq(dev, NVM_SQ_NONE, 0));
+	if (nerr) {
+		CU_FAIL("Read failure: command error");
+		goto exit_merge;
+	}
+
+	if (compare_buffers(buf_r, buf_w, buf_nbytes))
+		CU_FAIL("Read failure: buffer mismatch");
+
+exit_merge:
+	nvm_buf_free(buf_r);
+	nvm_buf_free(buf_w);
+}
+
+void test_SCHED(void)
+{
+	const int pmode = nvm_dev_get_pmode(dev);
+	const int naddrs = geo->nplanes * geo->nsectors;
+	const size_t buf_nbytes = naddrs * geo->sector_nbytes;
+	struct nvm_addr addrs[naddrs];
+	char *buf_w = NULL, *buf_r = NULL;
+	struct nvm_ret ret;
+	ssize_t res;
+	int nerr = 0;
+
+	++blk_addr.g.blk;
+
+	buf_w = nvm_buf_alloc(geo, buf_nbytes);
+	buf_r = nvm_buf_alloc(geo, buf_nbytes);
+	if (!buf_w || !buf_r) {
+		CU_FAIL("Allocation failure");
+		goto exit_sched;
+	}
+	nvm_buf_fill(buf_w, buf_nbytes);
+	memset(buf_r, 0, buf_nbytes);
+
+	for (size_t pl = 0; pl < geo->nplanes; ++pl) {	// Erase
+		addrs[pl].ppa = blk_addr.ppa;
+		addrs[pl].g.pl = pl;
+	}
+	res = nvm_addr_erase(dev, addrs, geo->nplanes, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Erase failure");
+		goto exit_sched;
+	}
+
+	for (int i = 0; i < naddrs; ++i) {		// First page
+		addrs[i].ppa = blk_addr.ppa;
+		addrs[i].g.pl = (i / geo->nsectors) % geo->nplanes;
+		addrs[i].g.sec = i % geo->nsectors;
+	}
+
+	res = nvm_addr_write(dev, addrs, naddrs, buf_w, NULL, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Write failure");
+		goto exit_sched;
+	}
+
+	CU_ASSERT(!nvm_dev_set_sched(dev, 1, 1000));
+	CU_ASSERT(nvm_dev_get_sched(dev) == 1);
+
+	// Sectors read concurrently, admitted one at a time
+	#pragma omp parallel for num_threads(naddrs) reduction(+:nerr)
+	for (int i = 0; i < naddrs; ++i) {
+		struct nvm_ret sec_ret;
+
+		if (nvm_addr_read(dev, addrs + i, 1,
+				  buf_r + i * geo->sector_nbytes, NULL,
+				  NVM_FLAG_PMODE_SNGL, &sec_ret) < 0)
+			++nerr;
+	}
+
+	CU_ASSERT(!nvm_dev_set_sched(dev, 0, 0));
+	if (nerr) {
+		CU_FAIL("Read failure: command error");
+		goto exit_sched;
+	}
+
+	if (compare_buffers(buf_r, buf_w, buf_nbytes))
+		CU_FAIL("Read failure: buffer mismatch");
+
+exit_sched:
+	nvm_buf_free(buf_r);
+	nvm_buf_free(buf_w);
+}
+
+void test_SCHED_SUSPEND(void)
+{
+	const int pmode = nvm_dev_get_pmode(dev);
+	const uint16_t control = NVM_FLAG_PMODE_SNGL | NVM_FLAG_SCRBL;
+	const int naddrs = geo->nplanes * geo->nsectors;
+	const size_t buf_nbytes = naddrs * geo->sector_nbytes;
+	struct nvm_addr addrs[naddrs], addrs_pg1[naddrs];
+	uint64_t dev_addrs[geo->nplanes];
+	struct nvm_cmd cmd = {.cdw={0}};
+	char *buf_w = NULL, *buf_r = NULL;
+	struct nvm_ret ret;
+	ssize_t res;
+	int nerr = 0;
+
+	++blk_addr.g.blk;
+
+	buf_w = nvm_buf_alloc(geo, buf_nbytes);
+	buf_r = nvm_buf_alloc(geo, buf_nbytes);
+	if (!buf_w || !buf_r) {
+		CU_FAIL("Allocation failure");
+		goto exit_suspend;
+	}
+	nvm_buf_fill(buf_w, buf_nbytes);
+	memset(buf_r, 0, buf_nbytes);
+
+	CU_ASSERT(!nvm_dev_set_sched(dev, 1, 1000));
+
+	for (size_t pl = 0; pl < geo->nplanes; ++pl) {	// Erase
+		addrs[pl].ppa = blk_addr.ppa;
+		addrs[pl].g.pl = pl;
+		dev_addrs[pl] = nvm_addr_gen2dev(dev, addrs[pl]);
+	}
+
+	// Flagged suspendable by the scheduler, the caller's command unchanged
+	cmd.vuser.opcode = NVM_S12_OPC_ERASE;
+	cmd.vuser.control = control;
+	cmd.vuser.nppas = geo->nplanes - 1;
+	cmd.vuser.ppa_list = geo->nplanes == 1 ? dev_addrs[0] :
+						 (uint64_t)dev_addrs;
+	if (nvm_cmd_vuser(dev, &cmd, &ret)) {
+		CU_FAIL("Erase failure");
+		goto exit_suspend;
+	}
+	CU_ASSERT_EQUAL(cmd.vuser.control, control);
+
+	for (int i = 0; i < naddrs; ++i) {		// First two pages
+		addrs[i].ppa = blk_addr.ppa;
+		addrs[i].g.pl = (i / geo->nsectors) % geo->nplanes;
+		addrs[i].g.sec = i % geo->nsectors;
+
+		addrs_pg1[i].ppa = addrs[i].ppa;
+		addrs_pg1[i].g.pg = 1;
+	}
+
+	res = nvm_addr_write(dev, addrs, naddrs, buf_w, NULL, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Write failure");
+		goto exit_suspend;
+	}
+
+	// Sectors of the first page read while the second page is programmed
+	#pragma omp parallel for num_threads(naddrs + 1) reduction(+:nerr)
+	for (int i = 0; i <= naddrs; ++i) {
+		struct nvm_ret io_ret;
+
+		if (i == naddrs) {
+			if (nvm_addr_write(dev, addrs_pg1, naddrs, buf_w, NULL,
+					   pmode, &io_ret) < 0)
+				++nerr;
+			continue;
+		}
+
+		if (nvm_addr_read(dev, addrs + i, 1,
+				  buf_r + i * geo->sector_nbytes, NULL,
+				  NVM_FLAG_PMODE_SNGL, &io_ret) < 0)
+			++nerr;
+	}
+
+	if (nerr) {
+		CU_FAIL("Read/write failure: command error");
+		goto exit_suspend;
+	}
+
+	if (compare_buffers(buf_r, buf_w, buf_nbytes))
+		CU_FAIL("Read failure: buffer mismatch");
+
+exit_suspend:
+	CU_ASSERT(!nvm_dev_set_sched(dev, 0, 0));
+	nvm_buf_free(buf_r);
+	nvm_buf_free(buf_w);
+}
+
+void test_IO_LIMIT(void)
+{
+	const int pmode = nvm_dev_get_pmode(dev);
+	const int naddrs = geo->nplanes * geo->nsectors;
+	const size_t buf_nbytes = naddrs * geo->sector_nbytes;
+	struct nvm_addr addrs[naddrs];
+	char *buf_w = NULL, *buf_r = NULL;
+	struct timespec t_bgn, t_end;
+	struct nvm_ret ret;
+	ssize_t res;
+	int nerr = 0;
+
+	++blk_addr.g.blk;
+
+	buf_w = nvm_buf_alloc(geo, buf_nbytes);
+	buf_r = nvm_buf_alloc(geo, buf_nbytes);
+	if (!buf_w || !buf_r) {
+		CU_FAIL("Allocation failure");
+		goto exit_limit;
+	}
+	nvm_buf_fill(buf_w, buf_nbytes);
+	memset(buf_r, 0, buf_nbytes);
+
+	for (size_t pl = 0; pl < geo->nplanes; ++pl) {	// Erase
+		addrs[pl].ppa = blk_addr.ppa;
+		addrs[pl].g.pl = pl;
+	}
+	res = nvm_addr_erase(dev, addrs, geo->nplanes, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Erase failure");
+		goto exit_limit;
+	}
+
+	for (int i = 0; i < naddrs; ++i) {		// First page
+		addrs[i].ppa = blk_addr.ppa;
+		addrs[i].g.pl = (i / geo->nsectors) % geo->nplanes;
+		addrs[i].g.sec = i % geo->nsectors;
+	}
+
+	res = nvm_addr_write(dev, addrs, naddrs, buf_w, NULL, pmode, &ret);
+	if (res < 0) {
+		CU_FAIL("Write failure");
+		goto exit_limit;
+	}
+
+	// Twenty commands per second on the LUN, with a burst of two
+	CU_ASSERT(!nvm_dev_set_io_limit(dev, NVM_IO_CLASS_BACKGROUND, 0, 20));
+	CU_ASSERT(!nvm_dev_set_io_class(dev, NVM_IO_CLASS_BACKGROUND));
+
+	clock_gettime(CLOCK_MONOTONIC, &t_bgn);
+	for (int i = 0; i < 5; ++i) {
+		if (nvm_addr_read(dev, addrs, naddrs, buf_r, NULL, pmode,
+				  &ret) < 0)
+			++nerr;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t_end);
+
+	CU_ASSERT(!nvm_dev_set_io_class(dev, NVM_IO_CLASS_LATENCY));
+	CU_ASSERT(!nvm_dev_set_io_limit(dev, NVM_IO_CLASS_BACKGROUND, 0, 0));
+	if (nerr) {
+		CU_FAIL("Read failure: command error");
+		goto exit_limit;
+	}
+
+	// Beyond the burst of two, each command waits for 1/20th of a second
+	CU_ASSERT((t_end.tv_sec - t_bgn.tv_sec) * 1000000000L +
+		  (t_end.tv_nsec - t_bgn.tv_nsec) >= 100000000L);
+
+	if (compare_buffers(buf_r, buf_w, buf_nbytes))
+		CU_FAIL("Read failure: buffer mismatch");
+
+exit_limit:
+	nvm_buf_free(buf_r);
+	nvm_buf_free(buf_w);
+}
+
 int main(int argc, char **argv)
 {
 	switch(argc) {
@@ -458,6 +1039,14 @@ int main(int argc, char **argv)
 	(NULL == CU_add_test(pSuite, "NADDR META0 DUAL", test_NADDR_META0_DUAL)) ||
 	(NULL == CU_add_test(pSuite, "NADDR META0 SNGL", test_NADDR_META0_SNGL)) ||
 	(NULL == CU_add_test(pSuite, "1ADDR META0 SNGL", test_1ADDR_META0_SNGL)) ||
+	(NULL == CU_add_test(pSuite, "NADDR SPLIT", test_NADDR_SPLIT)) ||
+	(NULL == CU_add_test(pSuite, "STATUS", test_STATUS)) ||
+	(NULL == CU_add_test(pSuite, "COPY", test_COPY)) ||
+	(NULL == CU_add_test(pSuite, "SQ PMODE", test_SQ_PMODE)) ||
+	(NULL == CU_add_test(pSuite, "SQ MERGE", test_SQ_MERGE)) ||
+	(NULL == CU_add_test(pSuite, "SCHED", test_SCHED)) ||
+	(NULL == CU_add_test(pSuite, "SCHED SUSPEND", test_SCHED_SUSPEND)) ||
+	(NULL == CU_add_test(pSuite, "IO LIMIT", test_IO_LIMIT)) ||
 	0)
 	{
 		CU_cleanup_registry();
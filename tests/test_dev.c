@@ -1,6 +1,8 @@
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <stdio.h>
+#include <unistd.h>
 #include <liblightnvm.h>
 
 #include <CUnit/Basic.h>
@@ -60,6 +62,331 @@ void test_DEV_OPENF_IOCTL_CLOSE(void)
 	nvm_dev_close(dev);
 }
 
+void test_DEV_PARTITION(void)
+{
+	const struct nvm_geo *geo, *part_geo;
+	struct nvm_dev *dev, *part;
+	struct nvm_addr dev_addr, part_addr;
+	int ch, lun;
+
+	dev = nvm_dev_open(nvm_dev_path);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dev);
+	geo = nvm_dev_get_geo(dev);
+
+	ch = geo->nchannels - 1;			// Last LUN of device
+	lun = geo->nluns - 1;
+
+	part = nvm_dev_partition(dev, ch, ch, lun, lun);
+	CU_ASSERT_PTR_NOT_NULL(part);
+	if (!part)
+		goto exit;
+	part_geo = nvm_dev_get_geo(part);
+
+	CU_ASSERT_EQUAL(part_geo->nchannels, 1);
+	CU_ASSERT_EQUAL(part_geo->nluns, 1);
+	CU_ASSERT_EQUAL(part_geo->nblocks, geo->nblocks);
+	CU_ASSERT_EQUAL(part_geo->tbytes,
+			geo->tbytes / (geo->nchannels * geo->nluns));
+
+	part_addr.ppa = 0;
+	part_addr.g.blk = 1;
+	dev_addr = part_addr;
+	dev_addr.g.ch = ch;
+	dev_addr.g.lun = lun;
+
+	CU_ASSERT(!nvm_addr_check(part_addr, part_geo));
+	part_addr.g.lun = 1;
+	CU_ASSERT(nvm_addr_check(part_addr, part_geo));
+	part_addr.g.lun = 0;
+
+	CU_ASSERT_EQUAL(nvm_addr_gen2dev(part, part_addr),
+			nvm_addr_gen2dev(dev, dev_addr));
+	CU_ASSERT_EQUAL(nvm_addr_dev2gen(part,
+					 nvm_addr_gen2dev(dev, dev_addr)).ppa,
+			part_addr.ppa);
+
+	CU_ASSERT_PTR_NULL(nvm_dev_partition(dev, ch, ch + 1, 0, 0));
+
+	nvm_dev_close(part);
+
+exit:
+	nvm_dev_close(dev);
+}
+
+void test_DEV_PLACE_LUNS(void)
+{
+	const struct nvm_geo *geo;
+	struct nvm_dev *dev;
+	struct nvm_addr *addrs;
+	struct nvm_addr addr;
+	struct nvm_lun_stats stats;
+	char *buf;
+	int nprobed = 0;
+	int nluns;
+
+	dev = nvm_dev_open(nvm_dev_path);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dev);
+	geo = nvm_dev_get_geo(dev);
+	nluns = geo->nchannels * geo->nluns;
+
+	addrs = malloc(sizeof(*addrs) * nluns);
+	CU_ASSERT_PTR_NOT_NULL(addrs);
+	if (!addrs)
+		goto exit;
+
+	addrs[0].ppa = 0;
+	CU_ASSERT(nvm_dev_get_lun_stats(dev, addrs[0], &stats));
+	CU_ASSERT(!nvm_dev_set_lun_stats(dev, 1));
+	CU_ASSERT(nvm_dev_get_lun_stats_enabled(dev));
+
+	// Without load, LUNs are suggested channel-first
+	CU_ASSERT(!nvm_dev_place_luns(dev, addrs, nluns));
+	for (int i = 0; i < nluns; ++i) {
+		CU_ASSERT_EQUAL(addrs[i].g.ch, i % geo->nchannels);
+		CU_ASSERT_EQUAL(addrs[i].g.lun, i / geo->nchannels);
+	}
+
+	CU_ASSERT(!nvm_dev_get_lun_stats(dev, addrs[0], &stats));
+	CU_ASSERT_EQUAL(stats.outstanding, 0);
+	CU_ASSERT_EQUAL(stats.ncmds, 0);
+
+	CU_ASSERT(nvm_dev_place_luns(dev, addrs, nluns + 1));
+
+	// Commands completed on the first LUN rank it after the idle ones
+	buf = nvm_buf_alloc(geo, geo->sector_nbytes);
+	CU_ASSERT_PTR_NOT_NULL(buf);
+	if (!buf)
+		goto exit_free;
+
+	addr.ppa = 0;
+	for (int i = 0; i < 4; ++i) {	// Outcome does not matter, load does
+		struct nvm_ret ret;
+
+		nvm_addr_read(dev, &addr, 1, buf, NULL, NVM_FLAG_PMODE_SNGL,
+			      &ret);
+	}
+	nvm_buf_free(buf);
+
+	CU_ASSERT(!nvm_dev_get_lun_stats(dev, addr, &stats));
+	CU_ASSERT_EQUAL(stats.ncmds, 4);
+	CU_ASSERT(stats.lat_us > 0);
+
+	CU_ASSERT(!nvm_dev_place_luns(dev, addrs, nluns));
+	CU_ASSERT_EQUAL(addrs[nluns - 1].g.ch, 0);
+	CU_ASSERT_EQUAL(addrs[nluns - 1].g.lun, 0);
+	for (int i = 0; i < nluns - 1; ++i) {
+		CU_ASSERT_EQUAL(addrs[i].g.ch, (i + 1) % geo->nchannels);
+		CU_ASSERT_EQUAL(addrs[i].g.lun, (i + 1) / geo->nchannels);
+	}
+
+	// Excluding slow LUNs still leaves all of them when none are slow
+	CU_ASSERT(!nvm_dev_set_slow_luns(dev, 4, 1));
+	CU_ASSERT(!nvm_dev_place_luns(dev, addrs, nluns));
+
+	// Read percentiles of the loaded LUN
+	CU_ASSERT(!nvm_dev_get_lun_stats(dev, addr, &stats));
+	CU_ASSERT_EQUAL(stats.nreads, 4);
+	CU_ASSERT(stats.read_p50_us > 0);
+	CU_ASSERT(stats.read_p99_us >= stats.read_p50_us);
+
+	// A running probe reads every LUN
+	CU_ASSERT(!nvm_dev_set_lun_probe(dev, 10, geo->nblocks - 1));
+	for (int t = 0; (t < 10) && (nprobed < nluns); ++t) {
+		sleep(1);
+
+		nprobed = 0;
+		for (int i = 0; i < nluns; ++i) {
+			addr.g.ch = i / geo->nluns;
+			addr.g.lun = i % geo->nluns;
+			if (!nvm_dev_get_lun_stats(dev, addr, &stats) &&
+			    stats.nreads)
+				++nprobed;
+		}
+	}
+	CU_ASSERT_EQUAL(nprobed, nluns);
+	CU_ASSERT(!nvm_dev_set_lun_probe(dev, 0, 0));
+
+	// Below a factor of one, LUNs at the median latency and above are slow
+	if (nluns > 2) {
+		int slow[nluns];
+		int nslow = 0;
+
+		CU_ASSERT(!nvm_dev_set_slow_luns(dev, 0.5, 1));
+		for (int i = 0; i < nluns; ++i) {
+			addr.g.ch = i / geo->nluns;
+			addr.g.lun = i % geo->nluns;
+			CU_ASSERT(!nvm_dev_get_lun_stats(dev, addr, &stats));
+			slow[i] = stats.slow;
+			nslow += stats.slow;
+		}
+		CU_ASSERT(nslow >= (nluns + 1) / 2);
+
+		CU_ASSERT(nvm_dev_place_luns(dev, addrs, nluns));
+		CU_ASSERT_EQUAL(errno, EBUSY);
+
+		CU_ASSERT(!nvm_dev_set_slow_luns(dev, 0.5, 0));
+		CU_ASSERT(!nvm_dev_place_luns(dev, addrs, nluns));
+		for (int i = 0; i < nluns; ++i) {
+			const int lun = addrs[i].g.ch * geo->nluns +
+					addrs[i].g.lun;
+
+			CU_ASSERT_EQUAL(slow[lun], i >= nluns - nslow);
+		}
+	}
+
+	CU_ASSERT(!nvm_dev_set_lun_stats(dev, 0));
+	CU_ASSERT(nvm_dev_set_slow_luns(dev, 4, 1));
+
+exit_free:
+	free(addrs);
+
+exit:
+	nvm_dev_close(dev);
+}
+
+void test_DEV_CHUNKS(void)
+{
+	const struct nvm_geo *geo;
+	struct nvm_dev *dev;
+	struct nvm_spec_chunk chunk;
+	struct nvm_addr addrs[NVM_NADDR_MAX];
+	struct nvm_addr addr = {.ppa = 0};
+	int pmode, naddrs = 0;
+	char *buf;
+
+	dev = nvm_dev_open(nvm_dev_path);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dev);
+	geo = nvm_dev_get_geo(dev);
+	pmode = nvm_dev_get_pmode(dev);
+
+	if (nvm_dev_get_verid(dev) != NVM_SPEC_VERID_20) {
+		CU_ASSERT(nvm_chunk_get(dev, addr, &chunk, NULL));
+		CU_ASSERT_EQUAL(errno, ENOSYS);
+		goto exit;
+	}
+
+	addr.g.blk = geo->nblocks;
+	CU_ASSERT(nvm_chunk_get(dev, addr, &chunk, NULL));
+	CU_ASSERT_EQUAL(errno, EINVAL);
+
+	// Reset the last chunk and write its first page, tracking the cache
+	addr.g.blk = geo->nblocks - 1;
+	CU_ASSERT(!nvm_chunk_get(dev, addr, &chunk, NULL));
+	if (chunk.cs == NVM_S20_CHUNK_OFFLINE)
+		goto exit;
+
+	for (size_t pl = 0; pl < geo->nplanes; ++pl) {
+		addrs[pl] = addr;
+		addrs[pl].g.pl = pl;
+	}
+	CU_ASSERT(!nvm_addr_erase(dev, addrs, geo->nplanes, pmode, NULL));
+	CU_ASSERT(!nvm_chunk_get(dev, addr, &chunk, NULL));
+	CU_ASSERT_EQUAL(chunk.cs, NVM_S20_CHUNK_FREE);
+	CU_ASSERT_EQUAL(chunk.wp, 0);
+
+	for (size_t pl = 0; pl < geo->nplanes; ++pl) {
+		for (size_t sec = 0; sec < geo->nsectors; ++sec) {
+			addrs[naddrs] = addr;
+			addrs[naddrs].g.pl = pl;
+			addrs[naddrs].g.sec = sec;
+			++naddrs;
+		}
+	}
+	buf = nvm_buf_alloc(geo, naddrs * geo->sector_nbytes);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(buf);
+	CU_ASSERT(!nvm_addr_write(dev, addrs, naddrs, buf, NULL, pmode, NULL));
+	nvm_buf_free(buf);
+
+	CU_ASSERT(!nvm_chunk_get(dev, addr, &chunk, NULL));
+	CU_ASSERT_EQUAL(chunk.cs, NVM_S20_CHUNK_OPEN);
+	CU_ASSERT_EQUAL(chunk.wp, (uint64_t)naddrs);
+
+	// The device agrees with the cache
+	CU_ASSERT(!nvm_chunk_refresh(dev, addr, NULL));
+	CU_ASSERT(!nvm_chunk_get(dev, addr, &chunk, NULL));
+	CU_ASSERT_EQUAL(chunk.wp, (uint64_t)naddrs);
+
+exit:
+	nvm_dev_close(dev);
+}
+
+void test_DEV_WCACHE(void)
+{
+	const struct nvm_geo *geo;
+	struct nvm_dev *dev;
+	struct nvm_addr addrs[NVM_NADDR_MAX];
+	struct nvm_addr addr = {.ppa = 0};
+	struct nvm_cmd cmd = {.cdw={0}};
+	int pmode, naddrs, ncached;
+	char *buf_w, *buf_r;
+
+	dev = nvm_dev_open(nvm_dev_path);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dev);
+	geo = nvm_dev_get_geo(dev);
+	pmode = nvm_dev_get_pmode(dev);
+
+	if (!nvm_dev_get_mw_cunits(dev)) {
+		CU_ASSERT(!nvm_dev_get_wcache(dev));
+		CU_ASSERT(nvm_dev_set_wcache(dev, 1));
+		CU_ASSERT_EQUAL(errno, ENOSYS);
+		goto exit;
+	}
+
+	CU_ASSERT(nvm_dev_get_wcache(dev));		// Enabled by default
+	CU_ASSERT(nvm_dev_set_wcache(dev, 2));
+
+	// Sectors within mw_cunits of the write pointer read back at once
+	naddrs = geo->nsectors;
+	addr.g.blk = geo->nblocks - 1;
+	for (int i = 0; i < naddrs; ++i) {
+		addrs[i] = addr;
+		addrs[i].g.sec = i;
+	}
+
+	buf_w = nvm_buf_alloc(geo, naddrs * geo->sector_nbytes);
+	buf_r = nvm_buf_alloc(geo, naddrs * geo->sector_nbytes);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(buf_w);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(buf_r);
+	nvm_buf_fill(buf_w, naddrs * geo->sector_nbytes);
+
+	CU_ASSERT(!nvm_addr_erase(dev, addrs, 1, pmode, NULL));
+	CU_ASSERT(!nvm_addr_write(dev, addrs, naddrs, buf_w, NULL, pmode,
+				  NULL));
+	CU_ASSERT(!nvm_addr_read(dev, addrs, naddrs, buf_r, NULL, pmode,
+				 NULL));
+	CU_ASSERT_NSTRING_EQUAL(buf_w, buf_r, naddrs * geo->sector_nbytes);
+
+	// Reset the chunk behind the back of the cache, via a raw command
+	cmd.vuser.opcode = NVM_S12_OPC_ERASE;
+	cmd.vuser.control = NVM_FLAG_PMODE_SNGL;
+	cmd.vuser.ppa_list = nvm_addr_gen2dev(dev, addrs[0]);
+	CU_ASSERT(!nvm_cmd_vuser(dev, &cmd, NULL));
+
+	// The cached sectors are still served, thus not read from the media
+	ncached = naddrs < nvm_dev_get_mw_cunits(dev) ? naddrs :
+		  nvm_dev_get_mw_cunits(dev);
+	memset(buf_r, 0, naddrs * geo->sector_nbytes);
+	CU_ASSERT(!nvm_addr_read(dev, addrs + naddrs - ncached, ncached,
+				 buf_r, NULL, NVM_FLAG_PMODE_SNGL, NULL));
+	CU_ASSERT_NSTRING_EQUAL(buf_w + (naddrs - ncached) * geo->sector_nbytes,
+				buf_r, ncached * geo->sector_nbytes);
+
+	CU_ASSERT(!nvm_dev_set_wcache(dev, 0));
+	CU_ASSERT(!nvm_dev_get_wcache(dev));
+
+	// Without the cache, the reset chunk reads back empty
+	CU_ASSERT(nvm_addr_read(dev, addrs + naddrs - ncached, ncached,
+				buf_r, NULL, NVM_FLAG_PMODE_SNGL, NULL));
+
+	CU_ASSERT(!nvm_dev_set_wcache(dev, 1));
+
+	nvm_buf_free(buf_w);
+	nvm_buf_free(buf_r);
+
+exit:
+	nvm_dev_close(dev);
+}
+
 int main(int argc, char **argv)
 {
 	if (argc > 1) {
@@ -89,6 +416,10 @@ int main(int argc, char **argv)
 	(NULL == CU_add_test(pSuite, "nvm_dev_[open|close] n", test_DEV_OPEN_CLOSE_N)) ||
 	(NULL == CU_add_test(pSuite, "nvm_dev_[openf(sysfs)|close] ", test_DEV_OPENF_SYSFS_CLOSE)) ||
 	(NULL == CU_add_test(pSuite, "nvm_dev_[openf(ioctl)|close] ", test_DEV_OPENF_IOCTL_CLOSE)) ||
+	(NULL == CU_add_test(pSuite, "nvm_dev_partition", test_DEV_PARTITION)) ||
+	(NULL == CU_add_test(pSuite, "nvm_dev_place_luns", test_DEV_PLACE_LUNS)) ||
+	(NULL == CU_add_test(pSuite, "nvm_chunk_[get|refresh]", test_DEV_CHUNKS)) ||
+	(NULL == CU_add_test(pSuite, "nvm_dev_[get|set]_wcache", test_DEV_WCACHE)) ||
 	0
 	)
 	{
@@ -3,6 +3,7 @@
 #include <errno.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/uio.h>
 #include <liblightnvm.h>
 
 #include <CUnit/Basic.h>
@@ -216,6 +217,520 @@ void test_VBLK_RAND(void)
 	}
 }
 
+void test_VBLK_RECOVER_POS(void)
+{
+	const size_t align = geo->nplanes * geo->nsectors * geo->sector_nbytes;
+	const size_t count = align * (nvm_vblk_get_naddrs(vblk) + 1);
+	ssize_t res = 0;
+
+	res = nvm_vblk_erase(vblk);			// EXPECT: OK
+	CU_ASSERT(res >= 0);
+	if (res < 0) {
+		CU_FAIL("FAILED: Erasing vblk");
+		return;
+	}
+
+	res = nvm_vblk_write(vblk, buf_w, count);	// EXPECT: OK
+	CU_ASSERT(res >= 0);
+	if (res < 0) {
+		CU_FAIL("FAILED: nvm_vblk_write");
+		return;
+	}
+
+	CU_ASSERT(!nvm_vblk_set_pos_write(vblk, 0));	// Forget the cursor
+
+	res = nvm_vblk_recover_pos(vblk);		// EXPECT: OK
+	CU_ASSERT(res == (ssize_t)count);
+	CU_ASSERT(nvm_vblk_get_pos_write(vblk) == count);
+}
+
+void test_VBLK_CHUNKS(void)
+{
+	const size_t align = geo->nplanes * geo->nsectors * geo->sector_nbytes;
+	const size_t count = align * nvm_vblk_get_naddrs(vblk);
+	struct nvm_vblk *chunks;
+	ssize_t res = 0;
+
+	if (nvm_dev_get_verid(dev) != NVM_SPEC_VERID_20) {
+		chunks = nvm_vblk_alloc_chunks(dev, nvm_vblk_get_addrs(vblk),
+					       nvm_vblk_get_naddrs(vblk));
+		CU_ASSERT_PTR_NULL(chunks);
+		CU_ASSERT_EQUAL(errno, ENOSYS);
+		return;
+	}
+
+	res = nvm_vblk_erase(vblk);			// EXPECT: OK
+	CU_ASSERT_FATAL(res >= 0);
+	res = nvm_vblk_write(vblk, buf_w, count);	// EXPECT: OK
+	CU_ASSERT_FATAL(res >= 0);
+
+	// The cursor of the chunks starts at their write pointers
+	chunks = nvm_vblk_alloc_chunks(dev, nvm_vblk_get_addrs(vblk),
+				       nvm_vblk_get_naddrs(vblk));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(chunks);
+	CU_ASSERT(nvm_vblk_get_pos_write(chunks) == count);
+
+	res = nvm_vblk_pwrite(chunks, buf_w, count, 0);	// EXPECT: Fail
+	CU_ASSERT(res < 0);
+	CU_ASSERT_EQUAL(errno, EINVAL);
+
+	res = nvm_vblk_write(chunks, buf_w + count, count);	// EXPECT: OK
+	CU_ASSERT(res >= 0);
+
+	res = nvm_vblk_pread(chunks, buf_r, 2 * count, 0);	// EXPECT: OK
+	CU_ASSERT(res >= 0);
+	CU_ASSERT_NSTRING_EQUAL(buf_w, buf_r, 2 * count);
+
+	res = nvm_vblk_erase(chunks);			// EXPECT: OK
+	CU_ASSERT(res >= 0);
+	CU_ASSERT(!nvm_vblk_set_pos_write(chunks, 0));
+	res = nvm_vblk_write(chunks, buf_w, count);	// EXPECT: OK
+	CU_ASSERT(res >= 0);
+
+	nvm_vblk_free(chunks);
+}
+
+void test_VBLK_RETRY(void)
+{
+	const size_t align = geo->nplanes * geo->nsectors * geo->sector_nbytes;
+	const int nretries = nvm_dev_get_nretries(dev);
+	struct nvm_addr addr = nvm_vblk_get_addrs(vblk)[0];
+	struct nvm_lun_stats bgn, end;
+	ssize_t res = 0;
+
+	res = nvm_vblk_erase(vblk);			// EXPECT: OK
+	CU_ASSERT_FATAL(res >= 0);
+	res = nvm_vblk_pwrite(vblk, buf_w, align, 0);	// EXPECT: OK
+	CU_ASSERT_FATAL(res >= 0);
+
+	// Re-programming fails, and is reported without being re-submitted
+	CU_ASSERT_FATAL(!nvm_dev_set_lun_stats(dev, 1));
+	CU_ASSERT(!nvm_dev_set_nretries(dev, 2));
+	CU_ASSERT(!nvm_dev_get_lun_stats(dev, addr, &bgn));
+	res = nvm_vblk_pwrite(vblk, buf_w + align, align, 0);	// EXPECT: Fail
+	CU_ASSERT(res < 0);
+	CU_ASSERT_EQUAL(errno, EIO);
+	CU_ASSERT(!nvm_dev_get_lun_stats(dev, addr, &end));
+	CU_ASSERT_EQUAL(end.ncmds - bgn.ncmds, 1);
+	CU_ASSERT(!nvm_dev_set_nretries(dev, nretries));
+	CU_ASSERT(!nvm_dev_set_lun_stats(dev, 0));
+
+	memset(buf_r, 0, align);
+	res = nvm_vblk_pread(vblk, buf_r, align, 0);	// EXPECT: OK
+	CU_ASSERT(res >= 0);
+	CU_ASSERT_NSTRING_EQUAL(buf_w, buf_r, align);
+}
+
+void test_VBLK_PWRITEV_PREADV(void)
+{
+	const size_t sector = geo->sector_nbytes;
+	struct iovec iov_w[3], iov_r[2];
+	ssize_t res = 0;
+
+	// Segments which do not line up with the plane-mode groups
+	iov_w[0].iov_base = buf_w;
+	iov_w[0].iov_len = sector;
+	iov_w[1].iov_base = buf_w + sector;
+	iov_w[1].iov_len = nbytes / 2 - sector;
+	iov_w[2].iov_base = buf_w + nbytes / 2;
+	iov_w[2].iov_len = nbytes - nbytes / 2;
+
+	iov_r[0].iov_base = buf_r;
+	iov_r[0].iov_len = nbytes - 3 * sector;
+	iov_r[1].iov_base = buf_r + nbytes - 3 * sector;
+	iov_r[1].iov_len = 3 * sector;
+
+	memset(buf_r, 0, nbytes);
+
+	res = nvm_vblk_erase(vblk);				// EXPECT: OK
+	CU_ASSERT(res >= 0);
+	if (res < 0) {
+		CU_FAIL("FAILED: Erasing vblk");
+		return;
+	}
+
+	res = nvm_vblk_pwritev(vblk, iov_w, 3, 0);		// EXPECT: OK
+	CU_ASSERT(res == (ssize_t)nbytes);
+	if (res < 0) {
+		CU_FAIL("FAILED: nvm_vblk_pwritev");
+		return;
+	}
+
+	res = nvm_vblk_preadv(vblk, iov_r, 2, 0);		// EXPECT: OK
+	CU_ASSERT(res == (ssize_t)nbytes);
+	if (res < 0) {
+		CU_FAIL("FAILED: nvm_vblk_preadv");
+		return;
+	}
+
+	CU_ASSERT(!compare_buffers(buf_w, buf_r, nbytes));
+}
+
+void test_VBLK_PREAD_BATCH(void)
+{
+	const int nreqs = 32;
+	const size_t sector = geo->sector_nbytes;
+	struct nvm_vblk_pread_req reqs[nreqs];
+	ssize_t res = 0;
+
+	res = nvm_vblk_erase(vblk);				// EXPECT: OK
+	CU_ASSERT(res >= 0);
+	if (res < 0) {
+		CU_FAIL("FAILED: Erasing vblk");
+		return;
+	}
+
+	res = nvm_vblk_write(vblk, buf_w, nbytes);		// EXPECT: OK
+	CU_ASSERT(res >= 0);
+	if (res < 0) {
+		CU_FAIL("FAILED: nvm_vblk_write");
+		return;
+	}
+
+	memset(buf_r, 0, nbytes);
+
+	for (int i = 0; i < nreqs; ++i) {	// Small reads scattered over vblk
+		const size_t count = sector * (1 + (rand() % 4));
+		const size_t offset = rand_offset(nbytes, count, sector);
+
+		reqs[i].vblk = vblk;
+		reqs[i].buf = buf_r + offset;
+		reqs[i].count = count;
+		reqs[i].offset = offset;
+		reqs[i].res = 0;
+	}
+
+	res = nvm_vblk_pread_batch(reqs, nreqs);		// EXPECT: OK
+	CU_ASSERT(res == 0);
+
+	for (int i = 0; i < nreqs; ++i) {
+		CU_ASSERT(reqs[i].res == (ssize_t)reqs[i].count);
+		CU_ASSERT(!compare_buffers(buf_w + reqs[i].offset,
+					   buf_r + reqs[i].offset,
+					   reqs[i].count));
+	}
+}
+
+void test_VBLK_PREAD_UNALIGNED(void)
+{
+	ssize_t res = 0;
+
+	res = nvm_vblk_erase(vblk);				// EXPECT: OK
+	CU_ASSERT(res >= 0);
+	if (res < 0) {
+		CU_FAIL("FAILED: Erasing vblk");
+		return;
+	}
+
+	res = nvm_vblk_write(vblk, buf_w, nbytes);		// EXPECT: OK
+	CU_ASSERT(res >= 0);
+	if (res < 0) {
+		CU_FAIL("FAILED: nvm_vblk_write");
+		return;
+	}
+
+	for (int i = 0; i < 64; ++i) {				// EXPECT: OK
+		const size_t count = 1 + (rand() % (4 * geo->sector_nbytes));
+		const size_t offset = rand_offset(nbytes, count, 1);
+
+		memset(buf_r, 0, count);
+
+		res = nvm_vblk_pread(vblk, buf_r, count, offset);
+		CU_ASSERT(res == (ssize_t)count);
+		if (res < 0) {
+			CU_FAIL("FAILED: nvm_vblk_pread");
+			return;
+		}
+
+		if (compare_buffers(buf_w + offset, buf_r, count)) {
+			if (VERBOSE)
+				print_mismatch(buf_w + offset, buf_r, count);
+			CU_FAIL("FAILED: buffer mismatch");
+			return;
+		}
+	}
+}
+
+void test_VBLK_APPEND_FLUSH(void)
+{
+	const size_t align = geo->nplanes * geo->nsectors * geo->sector_nbytes;
+	const size_t count = nvm_vblk_get_naddrs(vblk) * align + align / 2;
+	size_t nappended = 0;
+	ssize_t res = 0;
+
+	res = nvm_vblk_erase(vblk);				// EXPECT: OK
+	CU_ASSERT(res >= 0);
+	if (res < 0) {
+		CU_FAIL("FAILED: Erasing vblk");
+		return;
+	}
+
+	while (nappended < count) {				// EXPECT: OK
+		size_t n = 1 + (rand() % geo->sector_nbytes);
+
+		n = n < count - nappended ? n : count - nappended;
+
+		res = nvm_vblk_append(vblk, buf_w + nappended, n);
+		CU_ASSERT(res == (ssize_t)n);
+		if (res < 0) {
+			CU_FAIL("FAILED: nvm_vblk_append");
+			return;
+		}
+		nappended += n;
+	}
+	CU_ASSERT(nvm_vblk_get_pos_append(vblk) == count);
+	CU_ASSERT(nvm_vblk_get_pos_write(vblk) < count);
+
+	memset(buf_r, 0, count);				// Partly buffered
+	res = nvm_vblk_pread(vblk, buf_r, count, 0);
+	CU_ASSERT(res == (ssize_t)count);
+	CU_ASSERT(!compare_buffers(buf_w, buf_r, count));
+
+	res = nvm_vblk_flush(vblk);				// EXPECT: OK
+	CU_ASSERT(res > 0);
+	CU_ASSERT(nvm_vblk_get_pos_write(vblk) % align == 0);
+
+	memset(buf_r, 0, count);				// All on media
+	res = nvm_vblk_pread(vblk, buf_r, count, 0);
+	CU_ASSERT(res == (ssize_t)count);
+	CU_ASSERT(!compare_buffers(buf_w, buf_r, count));
+}
+
+void test_VBLK_READAHEAD(void)
+{
+	const size_t align = geo->nplanes * geo->nsectors * geo->sector_nbytes;
+	const size_t count = align * 3;
+	size_t nread = 0;
+	ssize_t res = 0;
+
+	res = nvm_vblk_erase(vblk);				// EXPECT: OK
+	CU_ASSERT(res >= 0);
+	if (res < 0) {
+		CU_FAIL("FAILED: Erasing vblk");
+		return;
+	}
+
+	res = nvm_vblk_write(vblk, buf_w, nbytes);		// EXPECT: OK
+	CU_ASSERT(res >= 0);
+	if (res < 0) {
+		CU_FAIL("FAILED: nvm_vblk_write");
+		return;
+	}
+
+	CU_ASSERT(!nvm_vblk_set_readahead(vblk, 2));
+	CU_ASSERT(nvm_vblk_get_readahead(vblk) == 2);
+
+	memset(buf_r, 0, nbytes);
+
+	while (nread < nbytes) {				// EXPECT: OK
+		const size_t n = count < nbytes - nread ? count : nbytes - nread;
+
+		res = nvm_vblk_read(vblk, buf_r + nread, n);
+		CU_ASSERT(res == (ssize_t)n);
+		if (res < 0) {
+			CU_FAIL("FAILED: nvm_vblk_read");
+			break;
+		}
+		nread += n;
+	}
+
+	CU_ASSERT(!compare_buffers(buf_w, buf_r, nread));
+	CU_ASSERT(!nvm_vblk_set_readahead(vblk, 0));
+}
+
+void test_VBLK_EAHEAD(void)
+{
+	const int nvblks = 2;
+	struct nvm_vblk_eahead *ea;
+	struct nvm_vblk *ev;
+
+	ea = nvm_vblk_eahead_create(1);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(ea);
+
+	for (int i = 0; i < nvblks; ++i) {			// EXPECT: OK
+		ev = nvm_vblk_alloc_line(dev, ch_bgn, ch_end, lun_bgn, lun_end,
+					 blk);
+		CU_ASSERT_PTR_NOT_NULL(ev);
+		if (!ev)
+			break;
+
+		CU_ASSERT(!nvm_vblk_eahead_put(ea, ev));
+	}
+
+	for (int i = 0; i < nvblks; ++i) {			// EXPECT: OK
+		ev = nvm_vblk_eahead_get(ea);
+		CU_ASSERT_PTR_NOT_NULL(ev);
+		if (!ev)
+			continue;
+
+		CU_ASSERT(nvm_vblk_get_pos_write(ev) == 0);
+		nvm_vblk_free(ev);
+	}
+
+	ev = nvm_vblk_eahead_get(ea);				// EXPECT: Empty
+	CU_ASSERT_PTR_NULL(ev);
+	CU_ASSERT(errno == ENOENT);
+
+	nvm_vblk_eahead_destroy(ea);
+}
+
+void test_VBLK_LAYOUT_BLOCK(void)
+{
+	const size_t align = geo->nplanes * geo->nsectors * geo->sector_nbytes;
+	struct nvm_vblk *lvblk;
+	struct nvm_addr addr;
+	ssize_t res = 0;
+
+	lvblk = nvm_vblk_alloc_line_layout(dev, ch_bgn, ch_end, lun_bgn,
+					   lun_end, blk, NVM_VBLK_LAYOUT_BLOCK,
+					   0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(lvblk);
+	CU_ASSERT(nvm_vblk_get_width(lvblk) == 1);
+
+	CU_ASSERT(!nvm_vblk_off2addr(lvblk, align, &addr));	// Same block
+	CU_ASSERT(addr.g.blk == nvm_vblk_get_addrs(lvblk)[0].g.blk);
+	CU_ASSERT(addr.g.ch == nvm_vblk_get_addrs(lvblk)[0].g.ch);
+	CU_ASSERT(addr.g.lun == nvm_vblk_get_addrs(lvblk)[0].g.lun);
+	CU_ASSERT(addr.g.pg == 1);
+
+	res = nvm_vblk_erase(lvblk);				// EXPECT: OK
+	CU_ASSERT(res >= 0);
+
+	res = nvm_vblk_write(lvblk, buf_w, nbytes);		// EXPECT: OK
+	CU_ASSERT(res >= 0);
+
+	memset(buf_r, 0, nbytes);
+	res = nvm_vblk_read(lvblk, buf_r, nbytes);		// EXPECT: OK
+	CU_ASSERT(res >= 0);
+
+	CU_ASSERT(!compare_buffers(buf_w, buf_r, nbytes));
+
+	nvm_vblk_free(lvblk);
+}
+
+void test_VBLK_COPY(void)
+{
+	const size_t nsecs = nbytes / geo->sector_nbytes;
+	struct nvm_vblk *dvblk;
+	uint8_t valid[(nsecs + 7) / 8];
+	ssize_t res = 0;
+
+	dvblk = nvm_vblk_alloc_line(dev, ch_bgn, ch_end, lun_bgn, lun_end,
+				    blk + 1);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dvblk);
+
+	res = nvm_vblk_erase(vblk);				// EXPECT: OK
+	CU_ASSERT(res >= 0);
+	res = nvm_vblk_write(vblk, buf_w, nbytes);		// EXPECT: OK
+	CU_ASSERT(res >= 0);
+
+	CU_ASSERT(nvm_vblk_copy(vblk, vblk, 0, nbytes, NULL) < 0);
+
+	res = nvm_vblk_erase(dvblk);				// EXPECT: OK
+	CU_ASSERT(res >= 0);
+	res = nvm_vblk_copy(dvblk, vblk, 0, nbytes, NULL);	// All sectors
+	CU_ASSERT(res == (ssize_t)nbytes);
+
+	memset(buf_r, 0, nbytes);
+	res = nvm_vblk_pread(dvblk, buf_r, nbytes, 0);
+	CU_ASSERT(res >= 0);
+	CU_ASSERT(!compare_buffers(buf_w, buf_r, nbytes));
+
+	memset(valid, 0x55, sizeof(valid));			// Even sectors
+
+	res = nvm_vblk_erase(dvblk);				// EXPECT: OK
+	CU_ASSERT(res >= 0);
+	res = nvm_vblk_copy(dvblk, vblk, 0, nbytes, valid);
+	CU_ASSERT(res == (ssize_t)(nbytes / 2));
+	CU_ASSERT(nvm_vblk_flush(dvblk) >= 0);
+
+	memset(buf_r, 0, nbytes);
+	res = nvm_vblk_pread(dvblk, buf_r, nbytes / 2, 0);
+	CU_ASSERT(res >= 0);
+	for (size_t i = 0; i < nsecs / 2; ++i) {
+		CU_ASSERT(!compare_buffers(buf_w + 2 * i * geo->sector_nbytes,
+					   buf_r + i * geo->sector_nbytes,
+					   geo->sector_nbytes));
+	}
+
+	nvm_vblk_free(dvblk);
+}
+
+void test_VBLK_PARITY(void)
+{
+	const int pmode = nvm_dev_get_pmode(dev);
+	struct nvm_addr pblk, addrs[geo->nplanes];
+	struct nvm_vblk_pread_req reqs[2];
+	struct nvm_ret ret = {0,0};
+	ssize_t res = 0;
+
+	pblk.ppa = 0;
+	pblk.g.ch = ch_bgn;
+	pblk.g.lun = lun_bgn;
+	pblk.g.blk = blk;
+
+	CU_ASSERT(nvm_vblk_set_parity(vblk, &pblk));	// LUN of a member
+	CU_ASSERT(nvm_vblk_set_hedge(vblk, 100));	// Without parity
+
+	if (lun_end + 1 < (int)geo->nluns) {
+		pblk.g.lun = lun_end + 1;
+	} else if (ch_end + 1 < (int)geo->nchannels) {
+		pblk.g.ch = ch_end + 1;
+	} else {
+		CU_PASS("No LUN outside of the vblk for the parity block");
+		return;
+	}
+
+	// Data written without parity is rejected
+	CU_ASSERT(!nvm_vblk_set_pos_write(vblk, geo->sector_nbytes));
+	CU_ASSERT(nvm_vblk_set_parity(vblk, &pblk));
+	CU_ASSERT(!nvm_vblk_set_pos_write(vblk, 0));
+
+	CU_ASSERT_FATAL(!nvm_vblk_set_parity(vblk, &pblk));
+	CU_ASSERT(nvm_vblk_get_parity(vblk)->g.lun == pblk.g.lun);
+	CU_ASSERT(!nvm_vblk_set_hedge(vblk, 100));
+	CU_ASSERT(nvm_vblk_get_hedge(vblk) == 100);
+
+	res = nvm_vblk_erase(vblk);				// EXPECT: OK
+	CU_ASSERT(res >= 0);
+
+	res = nvm_vblk_write(vblk, buf_w, nbytes);		// EXPECT: OK
+	CU_ASSERT(res >= 0);
+
+	// Lose the first member, its sectors are reconstructed from parity
+	for (int i = 0; i < (int)geo->nplanes; ++i) {
+		addrs[i] = nvm_vblk_get_addrs(vblk)[0];
+		addrs[i].g.pl = i;
+	}
+	CU_ASSERT(!nvm_addr_erase(dev, addrs, geo->nplanes, pmode, &ret));
+
+	memset(buf_r, 0, nbytes);
+	res = nvm_vblk_pread(vblk, buf_r, nbytes, 0);		// EXPECT: OK
+	CU_ASSERT(res >= 0);
+
+	CU_ASSERT(!compare_buffers(buf_w, buf_r, nbytes));
+
+	// Batched reads of the lost member are reconstructed as well
+	for (int i = 0; i < 2; ++i) {
+		reqs[i].vblk = vblk;
+		reqs[i].count = geo->sector_nbytes;
+		reqs[i].offset = i * geo->sector_nbytes;
+		reqs[i].buf = buf_r + reqs[i].offset;
+	}
+	memset(buf_r, 0, nbytes);
+	CU_ASSERT(!nvm_vblk_pread_batch(reqs, 2));		// EXPECT: OK
+	for (int i = 0; i < 2; ++i) {
+		CU_ASSERT(reqs[i].res == (ssize_t)reqs[i].count);
+		CU_ASSERT(!compare_buffers(buf_w + reqs[i].offset,
+					   buf_r + reqs[i].offset,
+					   reqs[i].count));
+	}
+
+	CU_ASSERT(!nvm_vblk_set_parity(vblk, NULL));
+	CU_ASSERT(!nvm_vblk_get_hedge(vblk));
+	CU_ASSERT_PTR_NULL(nvm_vblk_get_parity(vblk));
+}
+
 int main(int argc, char **argv)
 {
 	switch(argc) {
@@ -255,6 +770,18 @@ int main(int argc, char **argv)
 	(NULL == CU_add_test(pSuite, "nvm_vblk_RAND", test_VBLK_RAND)) ||
 	(NULL == CU_add_test(pSuite, "nvm_vblk_PE_PW_PR", test_VBLK_PE_PW_PR)) ||
 	(NULL == CU_add_test(pSuite, "nvm_vblk_PE_PR_PW_PR", test_VBLK_PE_PR_PW_PR)) ||
+	(NULL == CU_add_test(pSuite, "nvm_vblk_RECOVER_POS", test_VBLK_RECOVER_POS)) ||
+	(NULL == CU_add_test(pSuite, "nvm_vblk_CHUNKS", test_VBLK_CHUNKS)) ||
+	(NULL == CU_add_test(pSuite, "nvm_vblk_RETRY", test_VBLK_RETRY)) ||
+	(NULL == CU_add_test(pSuite, "nvm_vblk_PWRITEV_PREADV", test_VBLK_PWRITEV_PREADV)) ||
+	(NULL == CU_add_test(pSuite, "nvm_vblk_PREAD_BATCH", test_VBLK_PREAD_BATCH)) ||
+	(NULL == CU_add_test(pSuite, "nvm_vblk_PREAD_UNALIGNED", test_VBLK_PREAD_UNALIGNED)) ||
+	(NULL == CU_add_test(pSuite, "nvm_vblk_APPEND_FLUSH", test_VBLK_APPEND_FLUSH)) ||
+	(NULL == CU_add_test(pSuite, "nvm_vblk_READAHEAD", test_VBLK_READAHEAD)) ||
+	(NULL == CU_add_test(pSuite, "nvm_vblk_EAHEAD", test_VBLK_EAHEAD)) ||
+	(NULL == CU_add_test(pSuite, "nvm_vblk_LAYOUT_BLOCK", test_VBLK_LAYOUT_BLOCK)) ||
+	(NULL == CU_add_test(pSuite, "nvm_vblk_COPY", test_VBLK_COPY)) ||
+	(NULL == CU_add_test(pSuite, "nvm_vblk_PARITY", test_VBLK_PARITY)) ||
 	0)
 	{
 		CU_cleanup_registry();